@@ -7,6 +7,12 @@
 //
 
 #import "AppDelegate.h"
+#import "CIOExtensions.h"
+#import "LaunchSnapshot.h"
+#import "PushUpdater.h"
+
+// Enough for the contacts fetch plus the messages fetch that usually follows it
+static const NSUInteger kPreconnectConnections = 2;
 
 @interface AppDelegate ()
 
@@ -14,9 +20,16 @@
 
 @implementation AppDelegate
 
+- (BOOL)application:(UIApplication *)application willFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
+    // before any screen interns a string
+    [[LaunchSnapshot sharedSnapshot] restore];
+    return YES;
+}
 
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
     // Override point for customization after application launch.
+    [[CIOV2Client sharedInstance] preconnectWithConnections:kPreconnectConnections];
+    [[PushUpdater sharedUpdater] start];
     return YES;
 }
 
@@ -28,10 +41,16 @@
 - (void)applicationDidEnterBackground:(UIApplication *)application {
     // Use this method to release shared resources, save user data, invalidate timers, and store enough application state information to restore your application to its current state in case it is terminated later.
     // If your application supports background execution, this method is called instead of applicationWillTerminate: when the user quits.
+    [[CIOV2Client sharedInstance].session stopKeepAlive];
+    [[LaunchSnapshot sharedSnapshot] save];
+    // a suspended app can't take callbacks
+    [[PushUpdater sharedUpdater] stop];
 }
 
 - (void)applicationWillEnterForeground:(UIApplication *)application {
     // Called as part of the transition from the background to the inactive state; here you can undo many of the changes made on entering the background.
+    [[CIOV2Client sharedInstance] preconnectWithConnections:kPreconnectConnections];
+    [[PushUpdater sharedUpdater] start];
 }
 
 - (void)applicationDidBecomeActive:(UIApplication *)application {
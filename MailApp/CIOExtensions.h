@@ -8,13 +8,30 @@
 
 #import <Foundation/Foundation.h>
 #import "CIOV2Client.h"
+#import "CIOLiteClient.h"
 #import "CIOAPIClientHeader.h"
 
 @interface CIOV2Client (Extensions)
 
+/**
+ *  Pool holding one client per account, all sharing one session.
+ */
++ (CIOClientPool *)sharedClientPool;
+
+/**
+ *  Client for the account configured in Constants.h, taken from `sharedClientPool`.
+ */
 + (instancetype)sharedInstance;
 
 
 
 @end
 
+@interface CIOLiteClient (Extensions)
+
+/**
+ *  Lite client for the user configured in Constants.h, scheduled by `+[CIOV2Client sharedClientPool]`.
+ */
++ (instancetype)sharedInstance;
+
+@end
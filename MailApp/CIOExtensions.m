@@ -13,14 +13,37 @@
 
 @implementation CIOV2Client (Extensions)
 
-+ (instancetype)sharedInstance {
-    static CIOV2Client *instance = nil;
++ (CIOClientPool *)sharedClientPool {
+    static CIOClientPool *pool = nil;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        instance = [[CIOV2Client alloc] initWithConsumerKey:kContextIOConsumerKey consumerSecret:kContextIOConsumerSecret token:kContextIOAuthToken tokenSecret:kContextIOAuthSecret accountID:kContextIOAccountID];
+        pool = [[CIOClientPool alloc] initWithConsumerKey:kContextIOConsumerKey consumerSecret:kContextIOConsumerSecret];
     });
-    return instance;
+    return pool;
+}
+
++ (instancetype)sharedInstance {
+    return [[self sharedClientPool] clientForAccountID:kContextIOAccountID token:kContextIOAuthToken tokenSecret:kContextIOAuthSecret];
 }
 
+@end
+
+@implementation CIOLiteClient (Extensions)
+
++ (instancetype)sharedInstance {
+    static CIOLiteClient *client = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        client = [[CIOLiteClient alloc] initWithConsumerKey:kContextIOConsumerKey
+                                             consumerSecret:kContextIOConsumerSecret
+                                                      token:kContextIOAuthToken
+                                                tokenSecret:kContextIOAuthSecret
+                                                  accountID:kContextIOLiteUserID];
+        // Its requests are queued with the account's by the pool, which adopts it on the first one
+        client.session = [CIOV2Client sharedClientPool].session;
+        client.clientPool = [CIOV2Client sharedClientPool];
+    });
+    return client;
+}
 
 @end
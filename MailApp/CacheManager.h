@@ -0,0 +1,103 @@
+//
+//  CacheManager.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  One memory budget for every cache in the app. Caches register with the shared manager and store objects
+//  with their cost in bytes; when the total goes over budget the least recently used objects are evicted, to
+//  disk for caches that spill. Memory held elsewhere that can be shed, like the model stores, registers its
+//  cost too. Under memory pressure and on entering the background whole caches are shed, lowest priority first.
+
+#import <Foundation/Foundation.h>
+
+// Lower priorities are shed first
+typedef NS_ENUM(NSInteger, CachePriority) {
+    CachePriorityRendered = 0,      // strings and layouts derived from models, cheap to rebuild
+    CachePriorityAttachments,       // large, and only needed again if the user reopens them
+    CachePriorityBodies,
+    CachePriorityModels,
+    CachePriorityResponses,         // what screens paint in their first frame
+};
+
+@interface ManagedCache : NSObject
+
+@property(nonatomic, readonly) NSString *name;
+@property(nonatomic, readonly) CachePriority priority;
+// Evicted objects are archived to disk and read back by the next objectForKey:. Objects must conform to NSCoding.
+@property(nonatomic, readonly) BOOL spillsToDisk;
+// Cost of the objects in the caches, not counting registered memory
+@property(nonatomic, readonly) NSUInteger totalCost;
+
+/**
+ *  Returns the object for key, reading it back from disk if it was spilled. Safe to call from any thread.
+ */
+-(id)objectForKey:(NSString *)key;
+
+/**
+ *  @param cost approximate size of object in bytes, counted against the manager's memoryBudget
+ */
+-(void)setObject:(id)object forKey:(NSString *)key cost:(NSUInteger)cost;
+
+-(void)removeObjectForKey:(NSString *)key;
+
+-(void)removeAllObjects;
+
+@end
+
+/**
+ *  Memory kept outside the manager's caches, e.g. a model store, that still counts against its budget. It is shed
+ *  along with the caches of the priority it was registered with.
+ */
+@protocol ManagedMemory <NSObject>
+
+// Bytes held now. Called on the manager's queue, so it must be safe from any thread.
+-(NSUInteger)managedMemoryCost;
+
+// Frees what can be read back or fetched again. Called on the main thread.
+-(void)shedManagedMemory;
+
+@end
+
+@interface CacheManager : NSObject
+
+// Total cost of all caches and registered memory. Defaults to 24 MB.
+@property(nonatomic) NSUInteger memoryBudget;
+// Total size of spilled objects. Defaults to 64 MB.
+@property(nonatomic) NSUInteger diskBudget;
+// What is left in memory once the app enters the background. Defaults to 1 MB.
+@property(nonatomic) NSUInteger backgroundBudget;
+@property(nonatomic, readonly) NSUInteger totalCost;
+
++ (instancetype)sharedManager;
+
+/**
+ *  Registers a cache, or returns the one already registered under name. Spilled objects don't outlive the process.
+ */
+-(ManagedCache *)cacheWithName:(NSString *)name priority:(CachePriority)priority spillsToDisk:(BOOL)spillsToDisk;
+
+/**
+ *  Counts memory against memoryBudget and sheds it like a cache of priority. Held weakly, so it needn't be
+ *  unregistered. Safe to call from any thread. Don't register memory that can't be shed: once it alone is over
+ *  budget, every object cached afterwards would be evicted right away.
+ */
+-(void)registerMemory:(id<ManagedMemory>)memory priority:(CachePriority)priority;
+
+/**
+ *  Checks the budget again after registered memory grew, evicting and shedding what is over it. Safe to call from
+ *  any thread.
+ */
+-(void)registeredMemoryDidGrow;
+
+/**
+ *  Sheds whole caches and registered memory, lowest priority first, until the total cost is at most cost. Called
+ *  on memory warnings and when the app enters the background.
+ */
+-(void)shedToCost:(NSUInteger)cost;
+
+/**
+ *  Rough size in bytes of a JSON object as returned by the API, for use as its cost.
+ */
++ (NSUInteger)costOfJSONObject:(id)object;
+
+@end
@@ -0,0 +1,450 @@
+//
+//  CacheManager.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "CacheManager.h"
+#import <UIKit/UIKit.h>
+
+#define kDefaultMemoryBudget            (24 * 1024 * 1024)
+#define kDefaultDiskBudget              (64 * 1024 * 1024)
+#define kDefaultBackgroundBudget        (1024 * 1024)
+#define kSpillDirectoryName             @"Spilled"
+// Approximate size of an object with no contents, used for JSON costs
+#define kObjectOverhead                 16
+
+// An object in memory, linked into the manager's recency list, or a spilled object on disk once object is nil
+@interface CacheEntry : NSObject
+
+@property(nonatomic, strong) NSString *key;
+@property(nonatomic, weak) ManagedCache *cache;
+@property(nonatomic, strong) id object;
+@property(nonatomic) NSUInteger cost;
+@property(nonatomic, strong) CacheEntry *older;
+@property(nonatomic, weak) CacheEntry *newer;
+
+@end
+
+@implementation CacheEntry
+
+@end
+
+@interface ManagedCache ()
+
+@property(nonatomic, weak) CacheManager *manager;
+@property(nonatomic, readwrite) NSString *name;
+@property(nonatomic, readwrite) CachePriority priority;
+@property(nonatomic, readwrite) BOOL spillsToDisk;
+@property(nonatomic, readwrite) NSUInteger totalCost;
+@property(nonatomic, strong) NSString *directoryPath;
+// Only touched on the manager's stateQueue
+@property(nonatomic, strong) NSMutableDictionary *entries;      // key -> CacheEntry in memory
+@property(nonatomic, strong) NSMutableDictionary *spilled;      // key -> CacheEntry on disk
+
+-(NSString *)pathForKey:(NSString *)key;
+
+@end
+
+@interface CacheManager ()
+
+@property(nonatomic, readwrite) NSUInteger totalCost;
+@property(nonatomic) NSUInteger diskCost;
+@property(nonatomic, strong) NSMutableDictionary *caches;       // name -> ManagedCache
+@property(nonatomic, strong) NSMapTable *memories;              // id<ManagedMemory> -> NSNumber with its CachePriority
+// Most recently used first. Every entry in memory is in the list, across all caches.
+@property(nonatomic, strong) CacheEntry *newest;
+@property(nonatomic, weak) CacheEntry *oldest;
+// Spilled entries, oldest first
+@property(nonatomic, strong) NSMutableOrderedSet *spilledEntries;
+// Serial. Guards all bookkeeping, so caches can be used from any thread.
+@property(nonatomic, strong) dispatch_queue_t stateQueue;
+// Serial, so a spill is always written before it is read back or removed
+@property(nonatomic, strong) dispatch_queue_t ioQueue;
+
+-(id)objectForKey:(NSString *)key inCache:(ManagedCache *)cache;
+-(void)setObject:(id)object forKey:(NSString *)key cost:(NSUInteger)cost inCache:(ManagedCache *)cache;
+-(void)removeObjectForKey:(NSString *)key inCache:(ManagedCache *)cache;
+-(void)removeAllObjectsInCache:(ManagedCache *)cache;
+
+@end
+
+@implementation ManagedCache
+
+-(NSString *)pathForKey:(NSString *)key {
+    NSString *fileName = [key stringByAddingPercentEncodingWithAllowedCharacters:[NSCharacterSet alphanumericCharacterSet]];
+    return [self.directoryPath stringByAppendingPathComponent:fileName];
+}
+
+-(id)objectForKey:(NSString *)key {
+    return key ? [self.manager objectForKey:key inCache:self] : nil;
+}
+
+-(void)setObject:(id)object forKey:(NSString *)key cost:(NSUInteger)cost {
+    if (!key) {
+        return;
+    }
+    if (!object) {
+        [self removeObjectForKey:key];
+        return;
+    }
+    [self.manager setObject:object forKey:key cost:cost inCache:self];
+}
+
+-(void)removeObjectForKey:(NSString *)key {
+    if (key) {
+        [self.manager removeObjectForKey:key inCache:self];
+    }
+}
+
+-(void)removeAllObjects {
+    [self.manager removeAllObjectsInCache:self];
+}
+
+@end
+
+@implementation CacheManager
+
++ (instancetype)sharedManager {
+    static CacheManager *manager = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        manager = [[CacheManager alloc] init];
+    });
+    return manager;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _memoryBudget = kDefaultMemoryBudget;
+        _diskBudget = kDefaultDiskBudget;
+        _backgroundBudget = kDefaultBackgroundBudget;
+        _caches = [NSMutableDictionary dictionary];
+        _memories = [NSMapTable weakToStrongObjectsMapTable];
+        _spilledEntries = [NSMutableOrderedSet orderedSet];
+        _stateQueue = dispatch_queue_create("com.katyho.MailApp.cache", DISPATCH_QUEUE_SERIAL);
+        _ioQueue = dispatch_queue_create("com.katyho.MailApp.cache.io", DISPATCH_QUEUE_SERIAL);
+        NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+        [center addObserver:self selector:@selector(didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+        [center addObserver:self selector:@selector(didEnterBackground:) name:UIApplicationDidEnterBackgroundNotification object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+-(ManagedCache *)cacheWithName:(NSString *)name priority:(CachePriority)priority spillsToDisk:(BOOL)spillsToDisk {
+    __block ManagedCache *cache = nil;
+    dispatch_sync(self.stateQueue, ^{
+        cache = self.caches[name];
+        if (cache) {
+            return;
+        }
+        cache = [[ManagedCache alloc] init];
+        cache.manager = self;
+        cache.name = name;
+        cache.priority = priority;
+        cache.spillsToDisk = spillsToDisk;
+        cache.entries = [NSMutableDictionary dictionary];
+        cache.spilled = [NSMutableDictionary dictionary];
+        self.caches[name] = cache;
+    });
+    if (spillsToDisk && !cache.directoryPath) {
+        NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+        NSString *path = [[caches stringByAppendingPathComponent:kSpillDirectoryName] stringByAppendingPathComponent:name];
+        cache.directoryPath = path;
+        dispatch_sync(self.ioQueue, ^{
+            // spills from an earlier launch are never read back
+            [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+            [[NSFileManager defaultManager] createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:nil];
+        });
+    }
+    return cache;
+}
+
+-(void)registerMemory:(id<ManagedMemory>)memory priority:(CachePriority)priority {
+    dispatch_async(self.stateQueue, ^{
+        [self.memories setObject:@(priority) forKey:memory];
+        [self enforceBudget];
+    });
+}
+
+-(void)registeredMemoryDidGrow {
+    dispatch_async(self.stateQueue, ^{
+        [self enforceBudget];
+    });
+}
+
+#pragma mark - Cache operations
+
+-(id)objectForKey:(NSString *)key inCache:(ManagedCache *)cache {
+    __block id object = nil;
+    __block CacheEntry *spilled = nil;
+    dispatch_sync(self.stateQueue, ^{
+        CacheEntry *entry = cache.entries[key];
+        if (entry) {
+            [self unlinkEntry:entry];
+            [self linkNewestEntry:entry];
+            object = entry.object;
+            return;
+        }
+        spilled = cache.spilled[key];
+        if (spilled) {
+            [self forgetSpilledEntry:spilled removeFile:NO];
+        }
+    });
+    if (!spilled) {
+        return object;
+    }
+
+    __block NSData *data = nil;
+    NSString *path = [cache pathForKey:key];
+    dispatch_sync(self.ioQueue, ^{
+        data = [NSData dataWithContentsOfFile:path];
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    });
+    object = data ? [NSKeyedUnarchiver unarchiveObjectWithData:data] : nil;
+    if (object) {
+        dispatch_sync(self.stateQueue, ^{
+            // the key may have been set again while reading
+            if (!cache.entries[key] && !cache.spilled[key]) {
+                [self insertObject:object forKey:key cost:spilled.cost inCache:cache];
+            }
+        });
+    }
+    return object;
+}
+
+-(void)setObject:(id)object forKey:(NSString *)key cost:(NSUInteger)cost inCache:(ManagedCache *)cache {
+    dispatch_sync(self.stateQueue, ^{
+        [self removeEntryForKey:key inCache:cache];
+        [self insertObject:object forKey:key cost:cost inCache:cache];
+    });
+}
+
+-(void)removeObjectForKey:(NSString *)key inCache:(ManagedCache *)cache {
+    dispatch_sync(self.stateQueue, ^{
+        [self removeEntryForKey:key inCache:cache];
+    });
+}
+
+-(void)removeAllObjectsInCache:(ManagedCache *)cache {
+    dispatch_sync(self.stateQueue, ^{
+        for (NSString *key in cache.entries.allKeys) {
+            [self removeEntryForKey:key inCache:cache];
+        }
+        for (NSString *key in cache.spilled.allKeys) {
+            [self removeEntryForKey:key inCache:cache];
+        }
+    });
+}
+
+-(void)shedToCost:(NSUInteger)cost {
+    dispatch_sync(self.stateQueue, ^{
+        [self shedToCost:cost registeredCost:[self registeredCost]];
+    });
+}
+
+#pragma mark - Bookkeeping, on stateQueue
+
+-(void)insertObject:(id)object forKey:(NSString *)key cost:(NSUInteger)cost inCache:(ManagedCache *)cache {
+    CacheEntry *entry = [[CacheEntry alloc] init];
+    entry.key = key;
+    entry.cache = cache;
+    entry.object = object;
+    entry.cost = cost;
+    cache.entries[key] = entry;
+    cache.totalCost += cost;
+    self.totalCost += cost;
+    [self linkNewestEntry:entry];
+    [self enforceBudget];
+}
+
+-(NSUInteger)registeredCost {
+    NSUInteger cost = 0;
+    for (id<ManagedMemory> memory in self.memories.keyEnumerator.allObjects) {
+        cost += [memory managedMemoryCost];
+    }
+    return cost;
+}
+
+// Evicts the least recently used objects, and once the caches are empty sheds registered memory
+-(void)enforceBudget {
+    NSUInteger registeredCost = [self registeredCost];
+    while (self.totalCost + registeredCost > self.memoryBudget && self.oldest) {
+        [self evictEntry:self.oldest];
+    }
+    if (self.totalCost + registeredCost > self.memoryBudget) {
+        [self shedToCost:self.memoryBudget registeredCost:registeredCost];
+    }
+}
+
+// Caches and registered memory of the same priority are shed together. Registered memory is shed on the main
+// thread, its cost is taken as gone right away.
+-(void)shedToCost:(NSUInteger)cost registeredCost:(NSUInteger)registeredCost {
+    NSMutableArray *shedding = [NSMutableArray arrayWithArray:self.caches.allValues];
+    NSMapTable *priorities = [NSMapTable strongToStrongObjectsMapTable];
+    for (ManagedCache *cache in shedding) {
+        [priorities setObject:@(cache.priority) forKey:cache];
+    }
+    for (id<ManagedMemory> memory in self.memories.keyEnumerator.allObjects) {
+        [shedding addObject:memory];
+        [priorities setObject:[self.memories objectForKey:memory] forKey:memory];
+    }
+    [shedding sortUsingComparator:^NSComparisonResult(id object1, id object2) {
+        return [[priorities objectForKey:object1] compare:[priorities objectForKey:object2]];
+    }];
+
+    for (id object in shedding) {
+        if (self.totalCost + registeredCost <= cost) {
+            break;
+        }
+        if ([object isKindOfClass:[ManagedCache class]]) {
+            for (CacheEntry *entry in ((ManagedCache *)object).entries.allValues) {
+                [self evictEntry:entry];
+            }
+            continue;
+        }
+        id<ManagedMemory> memory = object;
+        NSUInteger memoryCost = [memory managedMemoryCost];
+        registeredCost -= MIN(memoryCost, registeredCost);
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [memory shedManagedMemory];
+        });
+    }
+}
+
+-(void)removeEntryForKey:(NSString *)key inCache:(ManagedCache *)cache {
+    CacheEntry *entry = cache.entries[key];
+    if (entry) {
+        [self unlinkEntry:entry];
+        [cache.entries removeObjectForKey:key];
+        cache.totalCost -= entry.cost;
+        self.totalCost -= entry.cost;
+    }
+    CacheEntry *spilled = cache.spilled[key];
+    if (spilled) {
+        [self forgetSpilledEntry:spilled removeFile:YES];
+    }
+}
+
+// Drops entry from memory, writing it to disk first if its cache spills
+-(void)evictEntry:(CacheEntry *)entry {
+    ManagedCache *cache = entry.cache;
+    [self unlinkEntry:entry];
+    [cache.entries removeObjectForKey:entry.key];
+    cache.totalCost -= entry.cost;
+    self.totalCost -= entry.cost;
+    if (!cache.spillsToDisk) {
+        return;
+    }
+
+    id object = entry.object;
+    NSString *path = [cache pathForKey:entry.key];
+    entry.object = nil;
+    cache.spilled[entry.key] = entry;
+    [self.spilledEntries addObject:entry];
+    // the archive is about the size of the object in memory, close enough for a budget
+    self.diskCost += entry.cost;
+    dispatch_async(self.ioQueue, ^{
+        NSData *data = [NSKeyedArchiver archivedDataWithRootObject:object];
+        [data writeToFile:path atomically:YES];
+    });
+
+    while (self.diskCost > self.diskBudget && self.spilledEntries.count > 0) {
+        [self forgetSpilledEntry:self.spilledEntries.firstObject removeFile:YES];
+    }
+}
+
+-(void)forgetSpilledEntry:(CacheEntry *)entry removeFile:(BOOL)removeFile {
+    ManagedCache *cache = entry.cache;
+    [cache.spilled removeObjectForKey:entry.key];
+    [self.spilledEntries removeObject:entry];
+    self.diskCost -= entry.cost;
+    if (removeFile) {
+        NSString *path = [cache pathForKey:entry.key];
+        dispatch_async(self.ioQueue, ^{
+            [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        });
+    }
+}
+
+-(void)linkNewestEntry:(CacheEntry *)entry {
+    entry.older = self.newest;
+    entry.newer = nil;
+    self.newest.newer = entry;
+    self.newest = entry;
+    if (!self.oldest) {
+        self.oldest = entry;
+    }
+}
+
+-(void)unlinkEntry:(CacheEntry *)entry {
+    CacheEntry *newer = entry.newer;
+    CacheEntry *older = entry.older;
+    if (newer) {
+        newer.older = older;
+    } else {
+        self.newest = older;
+    }
+    if (older) {
+        older.newer = newer;
+    } else {
+        self.oldest = newer;
+    }
+    entry.older = nil;
+    entry.newer = nil;
+}
+
+#pragma mark - Memory pressure
+
+-(void)didReceiveMemoryWarning:(NSNotification *)notification {
+    [self shedToCost:self.memoryBudget / 4];
+}
+
+-(void)didEnterBackground:(NSNotification *)notification {
+    // suspended apps are the first to be killed for memory, keep them small. Spills still being written finish
+    // before the app is suspended.
+    UIApplication *application = [UIApplication sharedApplication];
+    __block UIBackgroundTaskIdentifier task = [application beginBackgroundTaskWithExpirationHandler:^{
+        [application endBackgroundTask:task];
+        task = UIBackgroundTaskInvalid;
+    }];
+    [self shedToCost:self.backgroundBudget];
+    dispatch_async(self.ioQueue, ^{
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (task != UIBackgroundTaskInvalid) {
+                [application endBackgroundTask:task];
+                task = UIBackgroundTaskInvalid;
+            }
+        });
+    });
+}
+
+#pragma mark - Costs
+
++ (NSUInteger)costOfJSONObject:(id)object {
+    if ([object isKindOfClass:[NSString class]]) {
+        return kObjectOverhead + [object length] * sizeof(unichar);
+    }
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        __block NSUInteger cost = kObjectOverhead;
+        [object enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) {
+            cost += [self costOfJSONObject:key] + [self costOfJSONObject:value];
+        }];
+        return cost;
+    }
+    if ([object isKindOfClass:[NSArray class]]) {
+        NSUInteger cost = kObjectOverhead;
+        for (id value in object) {
+            cost += [self costOfJSONObject:value];
+        }
+        return cost;
+    }
+    return kObjectOverhead;
+}
+
+@end
@@ -17,6 +17,12 @@
 #define kContextIOAuthToken                 @""
 #define kContextIOAuthSecret                @""
 #define kContextIOAccountID                 @""
+#define kContextIOLiteUserID                @""
+
+// Public URL, without a trailing slash, that reaches kWebhookListenPort on the device, e.g. through a tunnel.
+// Leave empty to keep refreshing lists by fetching them.
+#define kWebhookBaseURL                     @""
+#define kWebhookListenPort                  8765
 
 
 
@@ -0,0 +1,36 @@
+//
+//  ContactRow.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  One contact row, a handle on a record in a ContactStore with the text a cell shows. The text is read out of
+//  the store when the row is made, off the main thread, and never changes, so configuring a cell only assigns it.
+
+#import <Foundation/Foundation.h>
+
+@class Contacts;
+@class ContactStore;
+
+@interface ContactRow : NSObject
+
+@property(nonatomic, readonly) ContactStore *store;
+@property(nonatomic, readonly) NSUInteger index;
+@property(nonatomic, readonly) NSString *nameText;
+@property(nonatomic, readonly) NSString *emailText;
+@property(nonatomic, readonly) NSString *statisticText;
+// Makes a new object on every call
+@property(nonatomic, readonly) Contacts *contact;
+
+// Reads the text of the record at index, call it off the main thread
+-(id)initWithStore:(ContactStore *)store index:(NSUInteger)index;
+// The same row with its record moved to index of store, e.g. a compacted store
+-(id)initWithRow:(ContactRow *)row store:(ContactStore *)store index:(NSUInteger)index;
+
+// A row for each of the indexes (NSNumbers)
++ (NSArray *)rowsInStore:(ContactStore *)store indexes:(NSArray *)indexes;
+
+// "1", "2", ... for the row at index, formatted once and shared
++ (NSString *)rankTextForRow:(NSInteger)row;
+
+@end
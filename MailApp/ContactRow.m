@@ -0,0 +1,123 @@
+//
+//  ContactRow.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "ContactRow.h"
+#import "Contacts.h"
+#import "ContactStore.h"
+#import "NSString+Extensions.h"
+#import "CacheManager.h"
+
+#define kNotAvailableText       @"N/A"
+// Rough size of a short NSString and its slot in the array
+#define kRankTextCost           48
+
+// "1", "2", ... formatted once and shared by every contacts list, until memory runs short
+@interface RankTexts : NSObject <ManagedMemory>
+
+@property(nonatomic, strong) NSMutableArray *texts;
+
+@end
+
+@implementation RankTexts
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _texts = [NSMutableArray array];
+    }
+    return self;
+}
+
+-(NSString *)textForRow:(NSInteger)row {
+    @synchronized(self) {
+        NSUInteger count = self.texts.count;
+        while ((NSInteger)self.texts.count <= row) {
+            [self.texts addObject:[NSString stringWithFormat:@"%lu", (unsigned long)self.texts.count + 1]];
+        }
+        if (self.texts.count > count) {
+            [[CacheManager sharedManager] registeredMemoryDidGrow];
+        }
+        return self.texts[row];
+    }
+}
+
+-(NSUInteger)managedMemoryCost {
+    @synchronized(self) {
+        return self.texts.count * kRankTextCost;
+    }
+}
+
+-(void)shedManagedMemory {
+    @synchronized(self) {
+        [self.texts removeAllObjects];
+    }
+}
+
+@end
+
+@implementation ContactRow
+
+-(id)initWithStore:(ContactStore *)store index:(NSUInteger)index {
+    if (self = [super init]) {
+        _store = store;
+        _index = index;
+        NSString *name = [store nameAtIndex:index];
+        NSString *email = [store emailAtIndex:index];
+        _nameText = [NSString isNullOrEmpty:name] ? kNotAvailableText : name;
+        _emailText = [NSString isNullOrEmpty:email] ? kNotAvailableText : email;
+        _statisticText = [NSString stringWithFormat:@"%.02f", [store statisticAtIndex:index]];
+    }
+    return self;
+}
+
+-(id)initWithRow:(ContactRow *)row store:(ContactStore *)store index:(NSUInteger)index {
+    if (self = [super init]) {
+        _store = store;
+        _index = index;
+        _nameText = row.nameText;
+        _emailText = row.emailText;
+        _statisticText = row.statisticText;
+    }
+    return self;
+}
+
++ (NSArray *)rowsInStore:(ContactStore *)store indexes:(NSArray *)indexes {
+    NSMutableArray *rows = [NSMutableArray arrayWithCapacity:indexes.count];
+    for (NSNumber *index in indexes) {
+        [rows addObject:[[ContactRow alloc] initWithStore:store index:index.unsignedIntegerValue]];
+    }
+    return rows;
+}
+
+-(Contacts *)contact {
+    return [self.store contactAtIndex:self.index];
+}
+
++ (NSString *)rankTextForRow:(NSInteger)row {
+    static RankTexts *rankTexts = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        rankTexts = [[RankTexts alloc] init];
+        [[CacheManager sharedManager] registerMemory:rankTexts priority:CachePriorityRendered];
+    });
+    return [rankTexts textForRow:row];
+}
+
+// Records are updated in place, so a row is compared by the text it was made with rather than by its record
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[ContactRow class]]) {
+        return NO;
+    }
+    ContactRow *other = object;
+    return [self.emailText isEqualToString:other.emailText] && [self.nameText isEqualToString:other.nameText] &&
+           [self.statisticText isEqualToString:other.statisticText];
+}
+
+- (NSUInteger)hash {
+    return self.emailText.hash;
+}
+
+@end
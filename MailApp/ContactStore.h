@@ -0,0 +1,58 @@
+//
+//  ContactStore.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Contact records kept in columns like MessageStore, with names and emails as IDs in the InternTable.
+//  Contacts objects are only made when asked for. A contact already in the store is updated in place. Safe to
+//  read from any thread while another adds records.
+
+#import <Foundation/Foundation.h>
+#import "InternTable.h"
+
+@class SnapshotFile;
+@class Contacts;
+
+@interface ContactStore : NSObject
+
+@property(nonatomic, readonly) NSUInteger count;
+// Bytes taken by all records, not counting the strings in the InternTable
+@property(nonatomic, readonly) NSUInteger byteCount;
+
+/**
+ *  A store over columns saved with snapshotSectionsForIndexes:prefix:, read in place from the mapped file until
+ *  the first append copies them. Returns nil if a column is missing or damaged, or they disagree on the count.
+ */
+-(instancetype)initWithSnapshotFile:(SnapshotFile *)file prefix:(NSString *)prefix;
+
+/**
+ *  Adds a record for each match in a response of the contacts API, or overwrites the record already kept for
+ *  its email. A record keeps its email and index for the life of the store.
+ *
+ *  @return the index of the record of each match (NSNumbers), in the order of the response
+ */
+-(NSArray *)addContactsFromResponse:(NSDictionary *)response;
+
+/**
+ *  Appends copies of the records of store at indexes (NSNumbers), in that order, e.g. to move the rows in
+ *  memory to a new store and let the other records go.
+ *
+ *  @return the indexes of the copies
+ */
+-(NSRange)appendRecordsAtIndexes:(NSArray *)indexes ofStore:(ContactStore *)store;
+
+-(NSString *)nameAtIndex:(NSUInteger)index;
+-(NSString *)emailAtIndex:(NSUInteger)index;
+-(float)statisticAtIndex:(NSUInteger)index;
+
+// Equal IDs mean equal emails, in this store, a MessageStore or anywhere else the InternTable is used
+-(StringID)internedEmailAtIndex:(NSUInteger)index;
+
+// A new Contacts object with the fields of the record
+-(Contacts *)contactAtIndex:(NSUInteger)index;
+
+// The records at indexes (NSNumbers), in that order, as one section per column named prefix + column
+-(NSDictionary *)snapshotSectionsForIndexes:(NSArray *)indexes prefix:(NSString *)prefix;
+
+@end
@@ -0,0 +1,212 @@
+//
+//  ContactStore.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "ContactStore.h"
+#import "SnapshotFile.h"
+#import "Contacts.h"
+
+@interface ContactStore ()
+
+// One element per record in each column
+@property(nonatomic, strong) NSData *names;          // StringID
+@property(nonatomic, strong) NSData *emails;         // StringID
+@property(nonatomic, strong) NSData *statistics;     // float
+@property(nonatomic, readwrite) NSUInteger count;
+// Email (StringID) -> index of its record
+@property(nonatomic, strong) NSMutableDictionary *indexesByEmail;
+// Set while the columns point into a mapped snapshot, which can't grow
+@property(nonatomic) BOOL restored;
+// Concurrent. Reads run side by side, writes are barriers since they can move the columns.
+@property(nonatomic, strong) dispatch_queue_t queue;
+
+@end
+
+// Copies field i of fields to index of column, growing the column by a record if index is at its end
+static void ContactStoreWriteField(NSData *column, NSUInteger index, NSData *fields, NSUInteger i, size_t width) {
+    NSMutableData *growable = (NSMutableData *)column;
+    if (growable.length < (index + 1) * width) {
+        growable.length = (index + 1) * width;
+    }
+    memcpy((uint8_t *)growable.mutableBytes + index * width, (const uint8_t *)fields.bytes + i * width, width);
+}
+
+@implementation ContactStore
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _names = [NSMutableData data];
+        _emails = [NSMutableData data];
+        _statistics = [NSMutableData data];
+        _indexesByEmail = [NSMutableDictionary dictionary];
+        _queue = dispatch_queue_create("com.katyho.MailApp.contactstore", DISPATCH_QUEUE_CONCURRENT);
+    }
+    return self;
+}
+
+-(instancetype)initWithSnapshotFile:(SnapshotFile *)file prefix:(NSString *)prefix {
+    if ((self = [self init])) {
+        NSArray *columns = @[@"names", @"emails", @"statistics"];
+        NSArray *widths = @[@(sizeof(StringID)), @(sizeof(StringID)), @(sizeof(float))];
+        NSUInteger count = NSNotFound;
+        for (NSUInteger i = 0; i < columns.count; i++) {
+            NSData *column = [file sectionNamed:[prefix stringByAppendingString:columns[i]]];
+            NSUInteger width = [widths[i] unsignedIntegerValue];
+            if (!column || column.length % width != 0 || (count != NSNotFound && column.length / width != count)) {
+                return nil;
+            }
+            count = column.length / width;
+            [self setValue:column forKey:columns[i]];
+        }
+        _count = count;
+        _restored = YES;
+        [self indexEmailsFromIndex:0];
+    }
+    return self;
+}
+
+// Must run inside a barrier, or before the store is shared
+-(void)indexEmailsFromIndex:(NSUInteger)start {
+    const StringID *emails = self.emails.bytes;
+    for (NSUInteger i = start; i < _count; i++) {
+        if (emails[i] != kNilStringID) {
+            self.indexesByEmail[@(emails[i])] = @(i);
+        }
+    }
+}
+
+-(NSUInteger)count {
+    __block NSUInteger count;
+    dispatch_sync(self.queue, ^{
+        count = _count;
+    });
+    return count;
+}
+
+-(NSUInteger)byteCount {
+    __block NSUInteger byteCount;
+    dispatch_sync(self.queue, ^{
+        byteCount = self.names.length + self.emails.length + self.statistics.length;
+    });
+    return byteCount;
+}
+
+-(NSArray *)addContactsFromResponse:(NSDictionary *)response {
+    NSArray *matches = [response valueForKey:@"matches"];
+    InternTable *table = [InternTable sharedTable];
+    NSUInteger count = matches.count;
+    NSMutableData *names = [NSMutableData dataWithLength:count * sizeof(StringID)];
+    NSMutableData *emails = [NSMutableData dataWithLength:count * sizeof(StringID)];
+    NSMutableData *statistics = [NSMutableData dataWithLength:count * sizeof(float)];
+    [matches enumerateObjectsUsingBlock:^(NSDictionary *dict, NSUInteger i, BOOL *stop) {
+        ((StringID *)names.mutableBytes)[i] = [table internString:dict[@"name"]];
+        ((StringID *)emails.mutableBytes)[i] = [table internString:dict[@"email"]];
+        ((float *)statistics.mutableBytes)[i] = [Contacts statisticForDictionary:dict];
+    }];
+
+    NSMutableArray *indexes = [NSMutableArray arrayWithCapacity:count];
+    dispatch_barrier_sync(self.queue, ^{
+        [self makeColumnsGrowable];
+        for (NSUInteger i = 0; i < count; i++) {
+            StringID email = ((const StringID *)emails.bytes)[i];
+            NSNumber *existing = email != kNilStringID ? self.indexesByEmail[@(email)] : nil;
+            NSUInteger index = existing ? existing.unsignedIntegerValue : _count++;
+            ContactStoreWriteField(self.names, index, names, i, sizeof(StringID));
+            ContactStoreWriteField(self.emails, index, emails, i, sizeof(StringID));
+            ContactStoreWriteField(self.statistics, index, statistics, i, sizeof(float));
+            if (!existing && email != kNilStringID) {
+                self.indexesByEmail[@(email)] = @(index);
+            }
+            [indexes addObject:@(index)];
+        }
+    });
+    return indexes;
+}
+
+-(NSRange)appendRecordsAtIndexes:(NSArray *)indexes ofStore:(ContactStore *)store {
+    NSDictionary *sections = [store snapshotSectionsForIndexes:indexes prefix:@""];
+    __block NSRange range;
+    dispatch_barrier_sync(self.queue, ^{
+        [self makeColumnsGrowable];
+        range = NSMakeRange(_count, indexes.count);
+        [(NSMutableData *)self.names appendData:sections[@"names"]];
+        [(NSMutableData *)self.emails appendData:sections[@"emails"]];
+        [(NSMutableData *)self.statistics appendData:sections[@"statistics"]];
+        _count += indexes.count;
+        [self indexEmailsFromIndex:range.location];
+    });
+    return range;
+}
+
+// Restored columns point into the snapshot file, the first write copies them. Must run inside a barrier.
+-(void)makeColumnsGrowable {
+    if (!self.restored) {
+        return;
+    }
+    self.names = [self.names mutableCopy];
+    self.emails = [self.emails mutableCopy];
+    self.statistics = [self.statistics mutableCopy];
+    self.restored = NO;
+}
+
+-(StringID)nameIDAtIndex:(NSUInteger)index {
+    __block StringID stringID;
+    dispatch_sync(self.queue, ^{
+        stringID = ((const StringID *)self.names.bytes)[index];
+    });
+    return stringID;
+}
+
+-(StringID)internedEmailAtIndex:(NSUInteger)index {
+    __block StringID stringID;
+    dispatch_sync(self.queue, ^{
+        stringID = ((const StringID *)self.emails.bytes)[index];
+    });
+    return stringID;
+}
+
+-(NSString *)nameAtIndex:(NSUInteger)index {
+    return [[InternTable sharedTable] stringForID:[self nameIDAtIndex:index]];
+}
+
+-(NSString *)emailAtIndex:(NSUInteger)index {
+    return [[InternTable sharedTable] stringForID:[self internedEmailAtIndex:index]];
+}
+
+-(float)statisticAtIndex:(NSUInteger)index {
+    __block float statistic;
+    dispatch_sync(self.queue, ^{
+        statistic = ((const float *)self.statistics.bytes)[index];
+    });
+    return statistic;
+}
+
+-(Contacts *)contactAtIndex:(NSUInteger)index {
+    return [[Contacts alloc] initWithName:[self nameAtIndex:index]
+                                    email:[self emailAtIndex:index]
+                                statistic:[self statisticAtIndex:index]];
+}
+
+-(NSDictionary *)snapshotSectionsForIndexes:(NSArray *)indexes prefix:(NSString *)prefix {
+    NSMutableDictionary *sections = [NSMutableDictionary dictionary];
+    dispatch_sync(self.queue, ^{
+        NSArray *columns = @[@"names", @"emails", @"statistics"];
+        NSArray *widths = @[@(sizeof(StringID)), @(sizeof(StringID)), @(sizeof(float))];
+        for (NSUInteger i = 0; i < columns.count; i++) {
+            NSData *column = [self valueForKey:columns[i]];
+            NSUInteger width = [widths[i] unsignedIntegerValue];
+            NSMutableData *section = [NSMutableData dataWithLength:indexes.count * width];
+            uint8_t *bytes = section.mutableBytes;
+            [indexes enumerateObjectsUsingBlock:^(NSNumber *index, NSUInteger j, BOOL *stop) {
+                memcpy(bytes + j * width, (const uint8_t *)column.bytes + index.unsignedIntegerValue * width, width);
+            }];
+            sections[[prefix stringByAppendingString:columns[i]]] = section;
+        }
+    });
+    return sections;
+}
+
+@end
@@ -18,6 +18,11 @@
 
 -(id)initWithDictionary:(NSDictionary*)dict;
 
+-(id)initWithName:(NSString *)name email:(NSString *)email statistic:(float)statistic;
+
+// received_count / sent_count of a contact dictionary, 0 if nothing was sent
++ (float)statisticForDictionary:(NSDictionary *)dict;
+
 + (NSArray *)contactsArrayForResponse:(NSDictionary *)response;
 
 @end
@@ -16,17 +16,45 @@
     if (self = [super init]) {
         _name = dict[@"name"];
         _email = dict[@"email"];
-        NSInteger sentCount = [dict[@"sent_count"] integerValue];
-        NSInteger receivedCount = [dict[@"received_count"] integerValue];
-        if (sentCount == 0) {
-            _statistic = 0;
-        } else {
-            _statistic = (float)receivedCount/(float)sentCount;
-        }
+        _statistic = [Contacts statisticForDictionary:dict];
     }
     return self;
 }
 
+//  Initialize fields of Contact from a ContactStore record
+-(id)initWithName:(NSString *)name email:(NSString *)email statistic:(float)statistic {
+    if (self = [super init]) {
+        _name = name;
+        _email = email;
+        _statistic = statistic;
+    }
+    return self;
+}
+
++ (float)statisticForDictionary:(NSDictionary *)dict {
+    NSInteger sentCount = [dict[@"sent_count"] integerValue];
+    NSInteger receivedCount = [dict[@"received_count"] integerValue];
+    if (sentCount == 0) {
+        return 0;
+    }
+    return (float)receivedCount/(float)sentCount;
+}
+
+//  Contacts are equal when every displayed field matches
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[Contacts class]]) {
+        return NO;
+    }
+    Contacts *other = object;
+    return (self.name == other.name || [self.name isEqual:other.name]) &&
+           (self.email == other.email || [self.email isEqual:other.email]) &&
+           self.statistic == other.statistic;
+}
+
+- (NSUInteger)hash {
+    return self.email.hash;
+}
+
 //  Return an array of Contact objects from the response returned by
 //  getContacts method of the ContextIO API. 
 + (NSArray *)contactsArrayForResponse:(NSDictionary *)response {
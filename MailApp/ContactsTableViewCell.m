@@ -11,7 +11,10 @@
 @implementation ContactsTableViewCell
 
 - (void)awakeFromNib {
-    // Initialization code
+    [super awakeFromNib];
+    // Initialization code, done once per cell rather than on every dequeue
+    [self.contentView.layer setBorderColor:[UIColor blackColor].CGColor];
+    [self.contentView.layer setBorderWidth:1.0f];
 }
 
 - (void)setSelected:(BOOL)selected animated:(BOOL)animated {
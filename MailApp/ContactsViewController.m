@@ -11,23 +11,24 @@
 #import "SVProgressHUD.h"
 #import "Constants.h"
 #import "Contacts.h"
+#import "ContactRow.h"
 
 #import "ContactsTableViewCell.h"
 #import "MessageViewController.h"
+#import "MessagePrefetcher.h"
+#import "ContactsViewModel.h"
+#import "UITableView+ListChanges.h"
 
 #define kCellReuseId                @"ContactsCell"
-#define kContactSortBy              @"received_count"
-#define kContactLimit               10
 #define kSectionNumber              1
 #define kSegueToMessage             @"showMessageController"
 
-@interface ContactsViewController ()
+@interface ContactsViewController () <ListViewModelDelegate>
 {
     Contacts *selectedContact;   // save the contact the user selects
-    int number;                  // for numbering the contacts from 1-10
 }
 
-@property(nonatomic, strong)NSArray *contacts;
+@property(nonatomic, strong)ContactsViewModel *viewModel;
 
 @end
 
@@ -35,16 +36,27 @@
 
 - (void)viewDidLoad {
     [super viewDidLoad];
+    self.viewModel = [[ContactsViewModel alloc] initWithFromDate:self.selectedFromDate toDate:self.selectedToDate];
+    self.viewModel.delegate = self;
+    // paints the last known contacts right away, fresh ones are merged in when they arrive
+    [self.viewModel load];
 }
 
 - (void)viewDidAppear:(BOOL)animated {
     [super viewDidAppear:animated];
     self.title = @"Top 10 Contacts";
-    if (!_contacts) {
-        number = 0;
-        [self fetchContacts];
+    if (!self.viewModel.items && self.viewModel.loading) {
+        [SVProgressHUD show];
+    } else {
+        [self prefetchVisibleContacts];
     }
 }
+
+- (void)viewWillDisappear:(BOOL)animated {
+    [super viewWillDisappear:animated];
+    [[MessagePrefetcher sharedPrefetcher] cancelPrefetching];
+}
+
 - (void)didReceiveMemoryWarning {
     [super didReceiveMemoryWarning];
     // Dispose of any resources that can be recreated.
@@ -57,7 +69,7 @@
 }
 
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
-    return self.contacts.count;
+    return self.viewModel.items.count;
 }
 
 
@@ -65,16 +77,13 @@
     ContactsTableViewCell *cell = (ContactsTableViewCell *)[tableView dequeueReusableCellWithIdentifier:kCellReuseId forIndexPath:indexPath];
     if (cell) {
         
-        Contacts *contact = [self.contacts objectAtIndex:indexPath.row];
-        NSLog(@"contact %@", contact);
-                
-        number++;
-        cell.nameLabel.text = [NSString isNullOrEmpty:contact.name] ? @"N/A" : contact.name;
-        cell.emailLabel.text = [NSString isNullOrEmpty:contact.email] ? @"N/A" : contact.email;
-        cell.statisticsLabel.text = [NSString stringWithFormat:@"%.02f", contact.statistic];
-        cell.number.text = [NSString stringWithFormat:@"%i", number];
-        [cell.contentView.layer setBorderColor:[UIColor blackColor].CGColor];
-        [cell.contentView.layer setBorderWidth:1.0f];
+        // rows carry their text, made off the main thread, see ContactRow
+        ContactRow *row = [self.viewModel.items objectAtIndex:indexPath.row];
+        cell.nameLabel.text = row.nameText;
+        cell.emailLabel.text = row.emailText;
+        cell.statisticsLabel.text = row.statisticText;
+        // numbered 1-10 by position, cells are reused and updated out of order
+        cell.number.text = [ContactRow rankTextForRow:indexPath.row];
         
     }
     
@@ -89,7 +98,7 @@
 }
 
 - (void)tableView:(UITableView *)tableView didSelectRowAtIndexPath:(NSIndexPath *)indexPath {
-    selectedContact = self.contacts[indexPath.row];
+    selectedContact = ((ContactRow *)self.viewModel.items[indexPath.row]).contact;
     if (selectedContact)
         [self performSegueWithIdentifier:kSegueToMessage sender:self];
 }
@@ -142,24 +151,39 @@
 }
 
 
-- (void)fetchContacts {
-    [SVProgressHUD show];
-    CIOContactsRequest *contactRequest = [[CIOV2Client sharedInstance] getContacts];
-    // contactRequest parameters
-    contactRequest.sort_by = kContactSortBy;
-    contactRequest.limit = kContactLimit;
-    contactRequest.active_after = self.selectedFromDate;
-    contactRequest.active_before = self.selectedToDate;
-    
-    [contactRequest executeWithSuccess:^(NSDictionary * _Nonnull responseDict) {
-        [SVProgressHUD dismiss];
-        self.contacts = [Contacts contactsArrayForResponse:responseDict];
-        [self.tableView reloadData];
-    } failure:^(NSError * _Nonnull error) {
-        NSLog(@"error %@", error);
+#pragma mark - ListViewModelDelegate
+
+-(void)listViewModel:(ListViewModel *)viewModel didUpdateItemsWithChanges:(ListChanges *)changes {
+    [self.tableView applyListChanges:changes inSection:0];
+    // moved rows keep their cells, renumber what's on screen
+    for (NSIndexPath *indexPath in [self.tableView indexPathsForVisibleRows]) {
+        ContactsTableViewCell *cell = (ContactsTableViewCell *)[self.tableView cellForRowAtIndexPath:indexPath];
+        cell.number.text = [ContactRow rankTextForRow:indexPath.row];
+    }
+    [self prefetchVisibleContacts];
+}
+
+-(void)listViewModel:(ListViewModel *)viewModel didFailWithError:(NSError *)error {
+    NSLog(@"error %@", error);
+}
+
+-(void)listViewModelDidChangeLoading:(ListViewModel *)viewModel {
+    if (!viewModel.loading) {
         [SVProgressHUD dismiss];
-    }];
+    }
+}
 
+// Loads the first page of messages for the contacts on screen so opening one is instant
+- (void)prefetchVisibleContacts {
+    [self.tableView layoutIfNeeded];
+    NSMutableArray *emails = [NSMutableArray array];
+    for (NSIndexPath *indexPath in [self.tableView indexPathsForVisibleRows]) {
+        Contacts *contact = ((ContactRow *)self.viewModel.items[indexPath.row]).contact;
+        if (contact.email) {
+            [emails addObject:contact.email];
+        }
+    }
+    [[MessagePrefetcher sharedPrefetcher] prefetchMessagesForEmails:emails];
 }
 
 @end
@@ -0,0 +1,18 @@
+//
+//  ContactsViewModel.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Top contacts for a time range. Items are ContactRows.
+
+#import "ListViewModel.h"
+
+@interface ContactsViewModel : ListViewModel
+
+@property(nonatomic, readonly) NSDate *fromDate;
+@property(nonatomic, readonly) NSDate *toDate;
+
+-(id)initWithFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate;
+
+@end
@@ -0,0 +1,147 @@
+//
+//  ContactsViewModel.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "ContactsViewModel.h"
+#import "CIOExtensions.h"
+#import "ContactRow.h"
+#import "ContactStore.h"
+#import "SnapshotFile.h"
+#import "CacheManager.h"
+
+#define kContactSortBy              @"received_count"
+#define kContactLimit               10
+
+// Registered with the cache manager for the memory of its store
+@interface ContactsViewModel () <ManagedMemory>
+
+@property(nonatomic, readwrite) NSDate *fromDate;
+@property(nonatomic, readwrite) NSDate *toDate;
+// Every contact loaded for this list. Items are rows pointing into it. Atomic, the cache manager reads it on its
+// own queue and rows are made on the diff queue while compacting replaces it on the main thread.
+@property(atomic, strong) ContactStore *store;
+
+@end
+
+@implementation ContactsViewModel
+
+-(id)initWithFromDate:(NSDate *)fromDate toDate:(NSDate *)toDate {
+    if (self = [super init]) {
+        _fromDate = fromDate;
+        _toDate = toDate;
+        _store = [[ContactStore alloc] init];
+        [[CacheManager sharedManager] registerMemory:self priority:CachePriorityModels];
+    }
+    return self;
+}
+
+// The pickers include the time of day, key by day so the snapshot is found again
+-(NSString *)snapshotKey {
+    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
+    [dateFormatter setDateFormat:@"yyyy-MM-dd"];
+    return [NSString stringWithFormat:@"contacts-%@-%@",
+            self.fromDate ? [dateFormatter stringFromDate:self.fromDate] : @"",
+            self.toDate ? [dateFormatter stringFromDate:self.toDate] : @""];
+}
+
+-(NSArray *)itemsForSnapshot:(id)snapshot {
+    ContactStore *store = self.store;
+    NSArray *rows = [ContactRow rowsInStore:store indexes:[store addContactsFromResponse:snapshot]];
+    [[CacheManager sharedManager] registeredMemoryDidGrow];
+    return rows;
+}
+
+-(NSArray *)itemsForLaunchSnapshot:(SnapshotFile *)file prefix:(NSString *)prefix {
+    ContactStore *store = [[ContactStore alloc] initWithSnapshotFile:file prefix:prefix];
+    if (store.count == 0) {
+        return nil;
+    }
+    self.store = store;
+    NSMutableArray *indexes = [NSMutableArray arrayWithCapacity:store.count];
+    for (NSUInteger i = 0; i < store.count; i++) {
+        [indexes addObject:@(i)];
+    }
+    return [ContactRow rowsInStore:store indexes:indexes];
+}
+
+-(NSDictionary *)launchSnapshotSectionsWithPrefix:(NSString *)prefix {
+    ContactStore *store = self.store;
+    NSMutableArray *indexes = [NSMutableArray arrayWithCapacity:self.items.count];
+    for (ContactRow *row in self.items) {
+        // rows of an older store are still waiting to be compacted
+        if (row.store != store) {
+            return nil;
+        }
+        [indexes addObject:@(row.index)];
+    }
+    return indexes.count > 0 ? [store snapshotSectionsForIndexes:indexes prefix:prefix] : nil;
+}
+
+-(id<NSCopying>)identifierForItem:(ContactRow *)row {
+    return @([row.store internedEmailAtIndex:row.index]);
+}
+
+#pragma mark - ManagedMemory
+
+-(NSUInteger)managedMemoryCost {
+    return self.store.byteCount;
+}
+
+-(void)shedManagedMemory {
+    [self compactStore];
+}
+
+-(void)didPublishFreshItems {
+    [self compactStore];
+}
+
+// Copies the records of the rows to a new store and points the rows at it, so contacts no longer listed go with
+// the old store once no row of a diff still running holds on to it. Rows made into an older store while the last
+// compaction ran are moved too.
+-(void)compactStore {
+    NSArray *items = self.items;
+    NSMapTable *indexesByStore = [NSMapTable strongToStrongObjectsMapTable];
+    for (ContactRow *row in items) {
+        NSMutableArray *indexes = [indexesByStore objectForKey:row.store];
+        if (!indexes) {
+            indexes = [NSMutableArray array];
+            [indexesByStore setObject:indexes forKey:row.store];
+        }
+        [indexes addObject:@(row.index)];
+    }
+    ContactStore *compacted = [[ContactStore alloc] init];
+    // store -> index in compacted of the next row of that store
+    NSMapTable *nextIndexByStore = [NSMapTable strongToStrongObjectsMapTable];
+    for (ContactStore *store in indexesByStore) {
+        NSRange range = [compacted appendRecordsAtIndexes:[indexesByStore objectForKey:store] ofStore:store];
+        [nextIndexByStore setObject:@(range.location) forKey:store];
+    }
+    NSMutableArray *moved = [NSMutableArray arrayWithCapacity:items.count];
+    for (ContactRow *row in items) {
+        NSUInteger index = [[nextIndexByStore objectForKey:row.store] unsignedIntegerValue];
+        [nextIndexByStore setObject:@(index + 1) forKey:row.store];
+        [moved addObject:[[ContactRow alloc] initWithRow:row store:compacted index:index]];
+    }
+    self.store = compacted;
+    if (items) {
+        [self substituteItems:moved];
+    }
+}
+
+-(void)fetchSnapshotWithSuccess:(void (^)(id))success failure:(void (^)(NSError *))failure {
+    CIOContactsRequest *contactRequest = [[CIOV2Client sharedInstance] getContacts];
+    // contactRequest parameters
+    contactRequest.sort_by = kContactSortBy;
+    contactRequest.limit = kContactLimit;
+    contactRequest.active_after = self.fromDate;
+    contactRequest.active_before = self.toDate;
+
+    [contactRequest executeWithSuccess:^(NSDictionary * _Nonnull responseDict) {
+        success(responseDict);
+    } failure:failure];
+}
+
+@end
@@ -0,0 +1,53 @@
+//
+//  InternTable.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  The app-wide set of interned strings. Every distinct string is stored once as UTF-8 and gets a 32-bit ID
+//  that stays the same for the life of the process, so model stores can keep IDs instead of strings, and
+//  comparing or joining on a string is comparing integers. The table is split into shards with a lock each,
+//  so decoders on different threads rarely wait on each other. Strings are never removed, so only intern strings
+//  that many records share, like names, emails or reply markers; strings nearly every record has its own of,
+//  like message IDs, belong in a StringArena of the store that holds the records.
+
+#import <Foundation/Foundation.h>
+
+@class SnapshotFile;
+
+typedef uint32_t StringID;
+
+// Stands for nil, and for anything that isn't a string
+extern const StringID kNilStringID;
+
+@interface InternTable : NSObject
+
+// Bytes used by all shards. Left out of the CacheManager's budget, none of it can be shed.
+@property(nonatomic, readonly) NSUInteger byteCount;
+
++ (instancetype)sharedTable;
+
+/**
+ *  Returns the ID of string, adding it if it isn't in the table yet. Returns kNilStringID for nil and for
+ *  objects other than strings, e.g. NSNull from JSON, and for new strings once the string's shard is full.
+ *  Safe to call from any thread.
+ */
+-(StringID)internString:(id)string;
+
+/**
+ *  Creates a new NSString for stringID, or returns nil for kNilStringID.
+ */
+-(NSString *)stringForID:(StringID)stringID;
+
+// The whole table as sections for a SnapshotFile, named "strings.*"
+-(NSDictionary *)snapshotSections;
+
+/**
+ *  Replaces the table with the one saved in file, keeping every ID it had. Strings are read from the mapped file
+ *  in place. Only possible before the first string is interned, since IDs already handed out would change meaning.
+ *
+ *  @return NO if the table was used already, or nothing intact was saved in file
+ */
+-(BOOL)restoreFromSnapshotFile:(SnapshotFile *)file;
+
+@end
@@ -0,0 +1,169 @@
+//
+//  InternTable.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "InternTable.h"
+#import "StringArena.h"
+#import "SnapshotFile.h"
+#import <pthread.h>
+
+const StringID kNilStringID = 0;
+
+// An ID is the string's offset in its shard's arena, shifted left, with the shard in the low bits. Arena
+// offsets are never 0, so no string gets kNilStringID, and each shard holds up to 256 MB.
+#define kShardBits          4
+#define kShardCount         (1 << kShardBits)
+#define kShardMask          (kShardCount - 1)
+// Largest arena offset that still fits an ID once shifted
+#define kMaxShardRef        (UINT32_MAX >> kShardBits)
+// Characters hashed from each end of a string to pick its shard
+#define kShardHashCharacters    8
+
+#define kMetaSectionName    @"strings.meta"     // uint32 shard count, then the string count of each shard
+
+// Not registered with the cache manager: nothing can be shed, IDs handed out must keep their meaning.
+@interface InternTable () {
+    StringArena *_arenas[kShardCount];
+    pthread_mutex_t _locks[kShardCount];
+}
+
+@end
+
+@implementation InternTable
+
++ (instancetype)sharedTable {
+    static InternTable *table = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        table = [[InternTable alloc] init];
+    });
+    return table;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        for (NSUInteger i = 0; i < kShardCount; i++) {
+            _arenas[i] = [[StringArena alloc] init];
+            pthread_mutex_init(&_locks[i], NULL);
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < kShardCount; i++) {
+        pthread_mutex_destroy(&_locks[i]);
+    }
+}
+
+-(NSUInteger)byteCount {
+    NSUInteger byteCount = 0;
+    for (NSUInteger i = 0; i < kShardCount; i++) {
+        pthread_mutex_lock(&_locks[i]);
+        byteCount += _arenas[i].byteCount;
+        pthread_mutex_unlock(&_locks[i]);
+    }
+    return byteCount;
+}
+
+// A string must always go to the same shard, also in a later launch restoring a snapshot. NSString's hash could
+// change with the OS, so this hashes the length and the characters at both ends itself.
+-(NSUInteger)shardForString:(NSString *)string {
+    NSUInteger length = string.length;
+    unichar characters[2 * kShardHashCharacters];
+    NSUInteger head = MIN(length, kShardHashCharacters);
+    NSUInteger tail = MIN(length - head, kShardHashCharacters);
+    [string getCharacters:characters range:NSMakeRange(0, head)];
+    [string getCharacters:characters + head range:NSMakeRange(length - tail, tail)];
+    uint32_t hash = 2166136261u ^ (uint32_t)length;
+    for (NSUInteger i = 0; i < head + tail; i++) {
+        hash = (hash ^ characters[i]) * 16777619u;
+    }
+    return (hash ^ (hash >> 16)) & kShardMask;
+}
+
+-(StringID)internString:(id)string {
+    if (![string isKindOfClass:[NSString class]]) {
+        return kNilStringID;
+    }
+    NSUInteger shard = [self shardForString:string];
+    pthread_mutex_lock(&_locks[shard]);
+    // past kMaxShardRef the shifted offset would wrap and the ID would name another string
+    StringRef ref = [_arenas[shard] internString:string maximumRef:kMaxShardRef];
+    pthread_mutex_unlock(&_locks[shard]);
+    if (ref == kNilStringRef) {
+        // called from decoders in the background, so the record goes without the string rather than the app crashing
+        NSLog(@"intern table shard %lu is full, dropping a string", (unsigned long)shard);
+        return kNilStringID;
+    }
+    return (StringID)(ref << kShardBits) | (StringID)shard;
+}
+
+-(NSString *)stringForID:(StringID)stringID {
+    if (stringID == kNilStringID) {
+        return nil;
+    }
+    NSUInteger shard = stringID & kShardMask;
+    pthread_mutex_lock(&_locks[shard]);
+    NSString *string = [_arenas[shard] stringForRef:stringID >> kShardBits];
+    pthread_mutex_unlock(&_locks[shard]);
+    return string;
+}
+
+#pragma mark - Snapshots
+
+-(NSDictionary *)snapshotSections {
+    NSMutableDictionary *sections = [NSMutableDictionary dictionary];
+    NSMutableData *meta = [NSMutableData data];
+    uint32_t shardCount = kShardCount;
+    [meta appendBytes:&shardCount length:sizeof(shardCount)];
+    for (NSUInteger i = 0; i < kShardCount; i++) {
+        pthread_mutex_lock(&_locks[i]);
+        uint32_t stringCount = (uint32_t)_arenas[i].stringCount;
+        sections[[NSString stringWithFormat:@"strings.%lu.bytes", (unsigned long)i]] = [_arenas[i] snapshotBytes];
+        sections[[NSString stringWithFormat:@"strings.%lu.table", (unsigned long)i]] = [_arenas[i] snapshotTable];
+        pthread_mutex_unlock(&_locks[i]);
+        [meta appendBytes:&stringCount length:sizeof(stringCount)];
+    }
+    sections[kMetaSectionName] = meta;
+    return sections;
+}
+
+-(BOOL)restoreFromSnapshotFile:(SnapshotFile *)file {
+    NSData *meta = [file sectionNamed:kMetaSectionName];
+    if (meta.length != sizeof(uint32_t) * (kShardCount + 1) || ((const uint32_t *)meta.bytes)[0] != kShardCount) {
+        return NO;
+    }
+    // every shard or none, a string missing from one shard would break the IDs of the others
+    StringArena *arenas[kShardCount];
+    for (NSUInteger i = 0; i < kShardCount; i++) {
+        NSData *bytes = [file sectionNamed:[NSString stringWithFormat:@"strings.%lu.bytes", (unsigned long)i]];
+        NSData *table = [file sectionNamed:[NSString stringWithFormat:@"strings.%lu.table", (unsigned long)i]];
+        arenas[i] = bytes && table ? [[StringArena alloc] initWithSnapshotBytes:bytes table:table stringCount:((const uint32_t *)meta.bytes)[i + 1]] : nil;
+        if (!arenas[i]) {
+            return NO;
+        }
+    }
+
+    for (NSUInteger i = 0; i < kShardCount; i++) {
+        pthread_mutex_lock(&_locks[i]);
+    }
+    BOOL unused = YES;
+    for (NSUInteger i = 0; i < kShardCount; i++) {
+        unused = unused && _arenas[i].stringCount == 0;
+    }
+    if (unused) {
+        for (NSUInteger i = 0; i < kShardCount; i++) {
+            _arenas[i] = arenas[i];
+        }
+    }
+    for (NSUInteger i = 0; i < kShardCount; i++) {
+        pthread_mutex_unlock(&_locks[i]);
+    }
+    return unused;
+}
+
+@end
@@ -0,0 +1,52 @@
+//
+//  LaunchSnapshot.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  The binary snapshot the app starts from: the InternTable and the stores behind each list screen, saved as a
+//  SnapshotFile when the app enters the background and mapped again at launch. Lists restored from it paint
+//  without parsing or copying anything; those it doesn't have fall back to the JSON in SnapshotStore.
+
+#import <Foundation/Foundation.h>
+
+@class SnapshotFile;
+@class ListViewModel;
+
+@interface LaunchSnapshot : NSObject
+
+// The snapshot restored at launch, or nil if there was none or it was unusable
+@property(nonatomic, readonly) SnapshotFile *file;
+
++ (instancetype)sharedSnapshot;
+
+// Prefix of the section names a list saved under key uses
++ (NSString *)sectionPrefixForKey:(NSString *)key;
+
+/**
+ *  Maps the last saved snapshot and restores the InternTable from it. Call once at launch, before any string is
+ *  interned; a snapshot whose strings can't be restored is deleted.
+ */
+-(void)restore;
+
+// The restored snapshot if it has an up to date copy of the list saved under key, else nil
+-(SnapshotFile *)fileForListWithKey:(NSString *)key;
+
+/**
+ *  Stops using the saved copy of the list under key, e.g. because its saved JSON has changed since. It is left out of
+ *  the next save unless the list is alive then.
+ */
+-(void)discardListForKey:(NSString *)key;
+
+/**
+ *  Includes list in every save from now on, for as long as it is alive.
+ */
+-(void)registerList:(ListViewModel *)list;
+
+/**
+ *  Writes a new snapshot in the background, replacing the old one once it is complete. Lists restored earlier but
+ *  no longer alive are carried over from the old snapshot. Call from the main thread.
+ */
+-(void)save;
+
+@end
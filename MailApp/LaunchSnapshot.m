@@ -0,0 +1,141 @@
+//
+//  LaunchSnapshot.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "LaunchSnapshot.h"
+#import <UIKit/UIKit.h>
+#import "SnapshotFile.h"
+#import "InternTable.h"
+#import "ListViewModel.h"
+
+#define kSnapshotDirectoryName          @"Snapshots"
+#define kSnapshotFileName               @"launch.snapshot"
+#define kListSectionPrefix              @"list."
+// Strings are never removed from the table, so a snapshot only grows. Past this it is dropped and the next
+// launch starts from the JSON snapshots, which is cheaper than compacting the table and renumbering every store.
+#define kMaxStringBytes                 (16 * 1024 * 1024)
+
+@interface LaunchSnapshot ()
+
+@property(nonatomic, readwrite) SnapshotFile *file;
+@property(nonatomic, strong) NSString *path;
+@property(nonatomic, strong) NSHashTable *lists;
+// Section prefixes of lists whose copy in file is out of date
+@property(nonatomic, strong) NSMutableSet *discardedPrefixes;
+// Saves are written here one at a time
+@property(nonatomic, strong) dispatch_queue_t ioQueue;
+
+@end
+
+@implementation LaunchSnapshot
+
++ (instancetype)sharedSnapshot {
+    static LaunchSnapshot *snapshot = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        snapshot = [[LaunchSnapshot alloc] init];
+    });
+    return snapshot;
+}
+
++ (NSString *)sectionPrefixForKey:(NSString *)key {
+    return [NSString stringWithFormat:@"%@%@.", kListSectionPrefix, key];
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+        NSString *directory = [caches stringByAppendingPathComponent:kSnapshotDirectoryName];
+        [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+        _path = [directory stringByAppendingPathComponent:kSnapshotFileName];
+        _lists = [NSHashTable weakObjectsHashTable];
+        _discardedPrefixes = [NSMutableSet set];
+        _ioQueue = dispatch_queue_create("com.katyho.MailApp.launchsnapshot", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+-(void)restore {
+    SnapshotFile *file = [[SnapshotFile alloc] initWithPath:self.path];
+    // lists hold string IDs, without the strings they mean nothing
+    if (file && ![[InternTable sharedTable] restoreFromSnapshotFile:file]) {
+        NSLog(@"launch snapshot strings are unusable, dropping it");
+        [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+        file = nil;
+    }
+    self.file = file;
+}
+
+-(SnapshotFile *)fileForListWithKey:(NSString *)key {
+    return [self.discardedPrefixes containsObject:[LaunchSnapshot sectionPrefixForKey:key]] ? nil : self.file;
+}
+
+-(void)discardListForKey:(NSString *)key {
+    [self.discardedPrefixes addObject:[LaunchSnapshot sectionPrefixForKey:key]];
+}
+
+-(void)registerList:(ListViewModel *)list {
+    [self.lists addObject:list];
+}
+
+-(void)save {
+    // lists are read on the main thread, where their items change
+    NSMutableDictionary *sections = [NSMutableDictionary dictionary];
+    NSMutableSet *savedPrefixes = [NSMutableSet set];
+    for (ListViewModel *list in self.lists.allObjects) {
+        NSString *key = [list snapshotKey];
+        if (!key) {
+            continue;
+        }
+        NSString *prefix = [LaunchSnapshot sectionPrefixForKey:key];
+        NSDictionary *listSections = [list launchSnapshotSectionsWithPrefix:prefix];
+        if (listSections) {
+            [sections addEntriesFromDictionary:listSections];
+            [savedPrefixes addObject:prefix];
+        }
+    }
+    // lists from the last snapshot that weren't opened this time. Their string IDs still hold, the table was
+    // restored from the same file and only grew since.
+    SnapshotFile *file = self.file;
+    for (NSString *name in file.sectionNames) {
+        if (![name hasPrefix:kListSectionPrefix]) {
+            continue;
+        }
+        // keys can contain dots, column names can't
+        NSString *prefix = [name substringToIndex:NSMaxRange([name rangeOfString:@"." options:NSBackwardsSearch])];
+        BOOL skipped = [savedPrefixes containsObject:prefix] || [self.discardedPrefixes containsObject:prefix];
+        NSData *section = skipped ? nil : [file sectionNamed:name];
+        if (section) {
+            sections[name] = section;
+        }
+    }
+
+    UIApplication *application = [UIApplication sharedApplication];
+    __block UIBackgroundTaskIdentifier task = [application beginBackgroundTaskWithExpirationHandler:^{
+        [application endBackgroundTask:task];
+        task = UIBackgroundTaskInvalid;
+    }];
+    NSString *path = self.path;
+    dispatch_async(self.ioQueue, ^{
+        InternTable *table = [InternTable sharedTable];
+        if (table.byteCount > kMaxStringBytes) {
+            [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        } else {
+            [sections addEntriesFromDictionary:[table snapshotSections]];
+            if (![SnapshotFile writeSections:sections toPath:path]) {
+                NSLog(@"could not write launch snapshot");
+            }
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (task != UIBackgroundTaskInvalid) {
+                [application endBackgroundTask:task];
+                task = UIBackgroundTaskInvalid;
+            }
+        });
+    });
+}
+
+@end
@@ -0,0 +1,37 @@
+//
+//  ListChanges.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Row changes between two item arrays, ready to apply to a table view in one batch. Rows are matched with
+//  Heckel's algorithm in linear time; picking the fewest moves among them takes n log n.
+
+#import <Foundation/Foundation.h>
+
+@interface ListChanges : NSObject
+
+@property(nonatomic, readonly) NSIndexSet *deletedIndexes;     // in the old items
+@property(nonatomic, readonly) NSIndexSet *insertedIndexes;    // in the new items
+@property(nonatomic, readonly) NSIndexSet *reloadedIndexes;    // in the old items, never moved
+@property(nonatomic, readonly) NSUInteger moveCount;
+@property(nonatomic, readonly) BOOL isEmpty;
+
+/**
+ *  Matches items between the arrays by identifier. Matched items out of order with the others become moves,
+ *  matched items that aren't isEqual become reloads, or a delete and an insert if they also moved. The blocks may be
+ *  called on any thread.
+ */
++ (instancetype)changesFromItems:(NSArray *)oldItems
+                         toItems:(NSArray *)newItems
+                      identifier:(id<NSCopying> (^)(id item))identifier
+                         isEqual:(BOOL (^)(id oldItem, id newItem))isEqual;
+
++ (instancetype)insertionOfRange:(NSRange)range;
+
++ (instancetype)reloadOfIndexes:(NSIndexSet *)indexes;
+
+// from is an index in the old items, to an index in the new items
+- (void)enumerateMovesUsingBlock:(void (^)(NSUInteger from, NSUInteger to))block;
+
+@end
@@ -0,0 +1,214 @@
+//
+//  ListChanges.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "ListChanges.h"
+
+// One entry of Heckel's symbol table. Counts only need to tell 0, 1 and more apart.
+typedef struct {
+    NSUInteger oldCount;
+    NSUInteger newCount;
+    NSUInteger oldIndex;
+} ListSymbol;
+
+typedef struct {
+    NSUInteger from;
+    NSUInteger to;
+} ListMove;
+
+@interface ListChanges ()
+
+@property(nonatomic, readwrite) NSIndexSet *deletedIndexes;
+@property(nonatomic, readwrite) NSIndexSet *insertedIndexes;
+@property(nonatomic, readwrite) NSIndexSet *reloadedIndexes;
+@property(nonatomic, strong) NSData *moves;     // ListMove array
+
+@end
+
+@implementation ListChanges
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _deletedIndexes = [NSIndexSet indexSet];
+        _insertedIndexes = [NSIndexSet indexSet];
+        _reloadedIndexes = [NSIndexSet indexSet];
+        _moves = [NSData data];
+    }
+    return self;
+}
+
++ (instancetype)changesFromItems:(NSArray *)oldItems
+                         toItems:(NSArray *)newItems
+                      identifier:(id<NSCopying> (^)(id))identifier
+                         isEqual:(BOOL (^)(id, id))isEqual {
+    NSUInteger oldCount = oldItems.count;
+    NSUInteger newCount = newItems.count;
+
+    NSMutableDictionary *symbolForIdentifier = [NSMutableDictionary dictionaryWithCapacity:oldCount + newCount];
+    ListSymbol *symbols = calloc(oldCount + newCount + 1, sizeof(ListSymbol));
+    NSUInteger *oldSymbols = malloc((oldCount + 1) * sizeof(NSUInteger));
+    NSUInteger *newSymbols = malloc((newCount + 1) * sizeof(NSUInteger));
+    NSInteger *oldToNew = malloc((oldCount + 1) * sizeof(NSInteger));
+    NSInteger *newToOld = malloc((newCount + 1) * sizeof(NSInteger));
+    __block NSUInteger symbolCount = 0;
+
+    NSUInteger (^symbolIndex)(id) = ^NSUInteger(id item) {
+        id<NSCopying> key = identifier(item);
+        NSNumber *index = symbolForIdentifier[key];
+        if (!index) {
+            index = @(symbolCount++);
+            symbolForIdentifier[key] = index;
+        }
+        return index.unsignedIntegerValue;
+    };
+
+    // 1 and 2: count every identifier in both arrays
+    for (NSUInteger i = 0; i < newCount; i++) {
+        newSymbols[i] = symbolIndex(newItems[i]);
+        symbols[newSymbols[i]].newCount++;
+        newToOld[i] = -1;
+    }
+    for (NSUInteger i = 0; i < oldCount; i++) {
+        oldSymbols[i] = symbolIndex(oldItems[i]);
+        symbols[oldSymbols[i]].oldCount++;
+        symbols[oldSymbols[i]].oldIndex = i;
+        oldToNew[i] = -1;
+    }
+
+    // 3: identifiers appearing exactly once in each array anchor a match
+    for (NSUInteger i = 0; i < newCount; i++) {
+        ListSymbol symbol = symbols[newSymbols[i]];
+        if (symbol.oldCount == 1 && symbol.newCount == 1) {
+            newToOld[i] = (NSInteger)symbol.oldIndex;
+            oldToNew[symbol.oldIndex] = (NSInteger)i;
+        }
+    }
+
+    // 4 and 5: grow matches over neighbours with the same identifier, forwards then backwards
+    for (NSUInteger i = 0; i + 1 < newCount; i++) {
+        NSInteger j = newToOld[i];
+        if (j >= 0 && (NSUInteger)j + 1 < oldCount && newToOld[i + 1] < 0 && oldToNew[j + 1] < 0 &&
+            newSymbols[i + 1] == oldSymbols[j + 1]) {
+            newToOld[i + 1] = j + 1;
+            oldToNew[j + 1] = (NSInteger)i + 1;
+        }
+    }
+    for (NSUInteger i = newCount; i-- > 1;) {
+        NSInteger j = newToOld[i];
+        if (j > 0 && newToOld[i - 1] < 0 && oldToNew[j - 1] < 0 && newSymbols[i - 1] == oldSymbols[j - 1]) {
+            newToOld[i - 1] = j - 1;
+            oldToNew[j - 1] = (NSInteger)i - 1;
+        }
+    }
+
+    // 6: matched rows whose relative order is kept stay put, found as the longest run of old indexes that increases
+    // in new order. Only the other matched rows move, so one row moving to the end is a single move rather than
+    // every row shifting past it. Binary search over the run ends keeps this at n log n.
+    NSUInteger *runEnds = malloc((newCount + 1) * sizeof(NSUInteger));     // new index ending the best run of each length
+    NSInteger *previous = malloc((newCount + 1) * sizeof(NSInteger));      // new index before i in its run
+    BOOL *stays = calloc(newCount + 1, sizeof(BOOL));
+    NSUInteger runLength = 0;
+    for (NSUInteger i = 0; i < newCount; i++) {
+        NSInteger j = newToOld[i];
+        if (j < 0) {
+            continue;
+        }
+        NSUInteger low = 0;
+        NSUInteger high = runLength;
+        while (low < high) {
+            NSUInteger middle = (low + high) / 2;
+            if (newToOld[runEnds[middle]] < j) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        previous[i] = low > 0 ? (NSInteger)runEnds[low - 1] : -1;
+        runEnds[low] = i;
+        if (low == runLength) {
+            runLength++;
+        }
+    }
+    for (NSInteger i = runLength > 0 ? (NSInteger)runEnds[runLength - 1] : -1; i >= 0; i = previous[i]) {
+        stays[i] = YES;
+    }
+
+    // Rows left unmatched are deletes and inserts
+    NSMutableIndexSet *deleted = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *inserted = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *reloaded = [NSMutableIndexSet indexSet];
+    NSMutableData *moves = [NSMutableData data];
+    for (NSUInteger i = 0; i < oldCount; i++) {
+        if (oldToNew[i] < 0) {
+            [deleted addIndex:i];
+        }
+    }
+    for (NSUInteger i = 0; i < newCount; i++) {
+        NSInteger j = newToOld[i];
+        if (j < 0) {
+            [inserted addIndex:i];
+            continue;
+        }
+        BOOL moved = !stays[i];
+        BOOL changed = !isEqual(oldItems[(NSUInteger)j], newItems[i]);
+        if (moved && changed) {
+            // a row can't be moved and reloaded in the same batch
+            [deleted addIndex:(NSUInteger)j];
+            [inserted addIndex:i];
+        } else if (moved) {
+            ListMove move = { (NSUInteger)j, i };
+            [moves appendBytes:&move length:sizeof(move)];
+        } else if (changed) {
+            [reloaded addIndex:(NSUInteger)j];
+        }
+    }
+
+    free(runEnds);
+    free(previous);
+    free(stays);
+    free(symbols);
+    free(oldSymbols);
+    free(newSymbols);
+    free(oldToNew);
+    free(newToOld);
+
+    ListChanges *changes = [[ListChanges alloc] init];
+    changes.deletedIndexes = deleted;
+    changes.insertedIndexes = inserted;
+    changes.reloadedIndexes = reloaded;
+    changes.moves = moves;
+    return changes;
+}
+
++ (instancetype)insertionOfRange:(NSRange)range {
+    ListChanges *changes = [[ListChanges alloc] init];
+    changes.insertedIndexes = [NSIndexSet indexSetWithIndexesInRange:range];
+    return changes;
+}
+
++ (instancetype)reloadOfIndexes:(NSIndexSet *)indexes {
+    ListChanges *changes = [[ListChanges alloc] init];
+    changes.reloadedIndexes = indexes;
+    return changes;
+}
+
+- (NSUInteger)moveCount {
+    return self.moves.length / sizeof(ListMove);
+}
+
+- (void)enumerateMovesUsingBlock:(void (^)(NSUInteger, NSUInteger))block {
+    const ListMove *moves = self.moves.bytes;
+    for (NSUInteger i = 0; i < self.moveCount; i++) {
+        block(moves[i].from, moves[i].to);
+    }
+}
+
+- (BOOL)isEmpty {
+    return self.deletedIndexes.count == 0 && self.insertedIndexes.count == 0 &&
+           self.reloadedIndexes.count == 0 && self.moveCount == 0;
+}
+
+@end
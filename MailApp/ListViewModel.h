@@ -0,0 +1,88 @@
+//
+//  ListViewModel.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Base view model for a table screen. It hands out the last known items synchronously, revalidates them
+//  against the API in the background, and publishes only what changed.
+
+#import <Foundation/Foundation.h>
+#import "ListChanges.h"
+
+@class ListViewModel;
+@class SnapshotFile;
+
+@protocol ListViewModelDelegate <NSObject>
+
+-(void)listViewModel:(ListViewModel *)viewModel didUpdateItemsWithChanges:(ListChanges *)changes;
+
+@optional
+-(void)listViewModel:(ListViewModel *)viewModel didFailWithError:(NSError *)error;
+-(void)listViewModelDidChangeLoading:(ListViewModel *)viewModel;
+
+@end
+
+@interface ListViewModel : NSObject
+
+@property(nonatomic, weak) id<ListViewModelDelegate> delegate;
+
+// nil until a snapshot or the first response is available. Rows dropped from memory are [NSNull null].
+@property(nonatomic, readonly) NSArray *items;
+@property(nonatomic, readonly, getter=isLoading) BOOL loading;
+
+/**
+ *  Fills items from the launch snapshot, or else the saved JSON snapshot, if there is one and items are still empty,
+ *  then starts a revalidation unless the items are kept fresh by pushes. Call from the main thread; items can be shown
+ *  as soon as this returns.
+ */
+-(void)load;
+
+/**
+ *  Fetches fresh items unless a fetch is already running.
+ */
+-(void)revalidate;
+
+#pragma mark - For subclasses
+
+// Key the raw response is saved under in SnapshotStore, or nil to keep nothing
+-(NSString *)snapshotKey;
+// Parses a raw response into row models. Runs on a background queue, except for the saved snapshot in -load.
+-(NSArray *)itemsForSnapshot:(id)snapshot;
+// Items from the launch snapshot sections starting with prefix, or nil. Runs on the main thread in -load, read the
+// sections in place rather than parsing them.
+-(NSArray *)itemsForLaunchSnapshot:(SnapshotFile *)file prefix:(NSString *)prefix;
+// Sections to save the items under in the launch snapshot, named starting with prefix, or nil to save nothing
+-(NSDictionary *)launchSnapshotSectionsWithPrefix:(NSString *)prefix;
+// YES while pushed updates keep the items current, so -load needn't revalidate them. Defaults to NO.
+-(BOOL)isKeptFresh;
+// YES to have the next revalidation publish itemsByMergingFreshItems:withItems: rather than the fresh items. Read on
+// the main thread before the diff starts. Defaults to NO.
+-(BOOL)mergesFreshItems;
+// The items a revalidation publishes when mergesFreshItems. Returns freshItems unless overridden. Called on a
+// background queue, so it must only use what it is passed and state that doesn't change.
+-(NSArray *)itemsByMergingFreshItems:(NSArray *)freshItems withItems:(NSArray *)oldItems;
+// Called on a background queue while diffing
+-(id<NSCopying>)identifierForItem:(id)item;
+-(BOOL)item:(id)oldItem isEqualToItem:(id)newItem;
+// Called on the main thread once a revalidation has replaced the items, e.g. to let go of what the old ones held
+-(void)didPublishFreshItems;
+
+/**
+ *  Fetches a fresh raw response. Call success with it on the main thread; it is saved as the snapshot.
+ */
+-(void)fetchSnapshotWithSuccess:(void (^)(id snapshot))success failure:(void (^)(NSError *error))failure;
+
+// Parses a further page off the main thread, adds its items at the end and tells the delegate
+-(void)appendSnapshot:(id)snapshot;
+// Parses pushed records off the main thread and inserts their items at index
+-(void)insertSnapshot:(id)snapshot atIndex:(NSUInteger)index;
+// Parses a page off the main thread and fills the dropped rows it covers, starting at index
+-(void)fillItemsFromIndex:(NSUInteger)index withSnapshot:(id)snapshot;
+// Drops the items outside range from memory. Rows stay in place as [NSNull null]; the delegate isn't told.
+-(void)dropItemsOutsideRange:(NSRange)range;
+// Replaces the items with others that show the same, e.g. rows moved to a compacted store. The delegate isn't told.
+-(void)substituteItems:(NSArray *)items;
+-(void)setLoading:(BOOL)loading;
+
+@end
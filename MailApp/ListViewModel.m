@@ -0,0 +1,268 @@
+//
+//  ListViewModel.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "ListViewModel.h"
+#import "SnapshotStore.h"
+#import "LaunchSnapshot.h"
+
+@interface ListViewModel ()
+
+@property(nonatomic, readwrite) NSArray *items;
+@property(nonatomic, readwrite, getter=isLoading) BOOL loading;
+// Diffs run here so refreshing a long list never blocks scrolling
+@property(nonatomic, strong) dispatch_queue_t diffQueue;
+
+@end
+
+@implementation ListViewModel
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _diffQueue = dispatch_queue_create("com.katyho.MailApp.diff", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_diffQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+    }
+    return self;
+}
+
+-(void)load {
+    NSString *key = [self snapshotKey];
+    if (key) {
+        [[LaunchSnapshot sharedSnapshot] registerList:self];
+    }
+    if (!self.items && key) {
+        SnapshotFile *file = [[LaunchSnapshot sharedSnapshot] fileForListWithKey:key];
+        self.items = file ? [self itemsForLaunchSnapshot:file prefix:[LaunchSnapshot sectionPrefixForKey:key]] : nil;
+    }
+    if (!self.items) {
+        id snapshot = key ? [[SnapshotStore sharedStore] objectForKey:key] : nil;
+        if (snapshot) {
+            self.items = [self itemsForSnapshot:snapshot];
+        }
+    }
+    if (!self.items || ![self isKeptFresh]) {
+        [self revalidate];
+    }
+}
+
+-(void)revalidate {
+    if (self.loading) {
+        return;
+    }
+    self.loading = YES;
+    __weak ListViewModel *weakSelf = self;
+    [self fetchSnapshotWithSuccess:^(id snapshot) {
+        ListViewModel *strongSelf = weakSelf;
+        if (!strongSelf) {
+            return;
+        }
+        NSString *key = [strongSelf snapshotKey];
+        if (key) {
+            [[SnapshotStore sharedStore] setObject:snapshot forKey:key];
+        }
+        // still loading until the diff is published, so a second revalidation can't race this one
+        [strongSelf publishSnapshot:snapshot completion:^{
+            weakSelf.loading = NO;
+        }];
+    } failure:^(NSError *error) {
+        ListViewModel *strongSelf = weakSelf;
+        if (!strongSelf) {
+            return;
+        }
+        strongSelf.loading = NO;
+        if ([strongSelf.delegate respondsToSelector:@selector(listViewModel:didFailWithError:)]) {
+            [strongSelf.delegate listViewModel:strongSelf didFailWithError:error];
+        }
+    }];
+}
+
+// completion is called on the main thread once the items are published
+-(void)publishSnapshot:(id)snapshot completion:(void (^)(void))completion {
+    __weak ListViewModel *weakSelf = self;
+    dispatch_async(self.diffQueue, ^{
+        NSArray *freshItems = [self itemsForSnapshot:snapshot];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf publishFreshItems:freshItems completion:completion];
+        });
+    });
+}
+
+// Merges and diffs against the items as they are when the diff starts. If they change while diffing, e.g. a page is
+// appended, the diff is taken again against the new items so nothing that arrived meanwhile is lost.
+-(void)publishFreshItems:(NSArray *)freshItems completion:(void (^)(void))completion {
+    NSArray *oldItems = self.items;
+    // read here, it is written on the main thread
+    BOOL merges = [self mergesFreshItems];
+    __weak ListViewModel *weakSelf = self;
+    dispatch_async(self.diffQueue, ^{
+        NSArray *items = merges ? [self itemsByMergingFreshItems:freshItems withItems:oldItems] : freshItems;
+        ListChanges *changes;
+        if (oldItems) {
+            changes = [ListChanges changesFromItems:oldItems toItems:items identifier:^id<NSCopying>(id item) {
+                return [self identifierForItem:item] ?: [NSNull null];
+            } isEqual:^BOOL(id oldItem, id newItem) {
+                return [self item:oldItem isEqualToItem:newItem];
+            }];
+        } else {
+            changes = [ListChanges insertionOfRange:NSMakeRange(0, items.count)];
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            ListViewModel *strongSelf = weakSelf;
+            if (!strongSelf) {
+                return;
+            }
+            if (strongSelf.items != oldItems) {
+                [strongSelf publishFreshItems:freshItems completion:completion];
+                return;
+            }
+            strongSelf.items = items;
+            if (!changes.isEmpty) {
+                [strongSelf.delegate listViewModel:strongSelf didUpdateItemsWithChanges:changes];
+            }
+            [strongSelf didPublishFreshItems];
+            completion();
+        });
+    });
+}
+
+-(void)appendSnapshot:(id)snapshot {
+    __weak ListViewModel *weakSelf = self;
+    dispatch_async(self.diffQueue, ^{
+        NSArray *items = [self itemsForSnapshot:snapshot];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf appendItems:items];
+        });
+    });
+}
+
+-(void)insertSnapshot:(id)snapshot atIndex:(NSUInteger)index {
+    __weak ListViewModel *weakSelf = self;
+    dispatch_async(self.diffQueue, ^{
+        NSArray *items = [self itemsForSnapshot:snapshot];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            ListViewModel *strongSelf = weakSelf;
+            if (!strongSelf || items.count == 0) {
+                return;
+            }
+            NSMutableArray *inserted = [strongSelf.items mutableCopy] ?: [NSMutableArray array];
+            NSUInteger location = MIN(index, inserted.count);
+            [inserted insertObjects:items atIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(location, items.count)]];
+            strongSelf.items = inserted;
+            [strongSelf.delegate listViewModel:strongSelf didUpdateItemsWithChanges:[ListChanges insertionOfRange:NSMakeRange(location, items.count)]];
+        });
+    });
+}
+
+-(void)fillItemsFromIndex:(NSUInteger)index withSnapshot:(id)snapshot {
+    __weak ListViewModel *weakSelf = self;
+    dispatch_async(self.diffQueue, ^{
+        NSArray *items = [self itemsForSnapshot:snapshot];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            ListViewModel *strongSelf = weakSelf;
+            if (!strongSelf) {
+                return;
+            }
+            NSMutableArray *filled = [strongSelf.items mutableCopy];
+            NSMutableIndexSet *reloaded = [NSMutableIndexSet indexSet];
+            for (NSUInteger i = 0; i < items.count && index + i < filled.count; i++) {
+                if (filled[index + i] == [NSNull null]) {
+                    filled[index + i] = items[i];
+                    [reloaded addIndex:index + i];
+                }
+            }
+            if (reloaded.count > 0) {
+                strongSelf.items = filled;
+                [strongSelf.delegate listViewModel:strongSelf didUpdateItemsWithChanges:[ListChanges reloadOfIndexes:reloaded]];
+            }
+        });
+    });
+}
+
+-(void)dropItemsOutsideRange:(NSRange)range {
+    NSArray *items = self.items;
+    if (items.count == 0) {
+        return;
+    }
+    NSMutableArray *kept = [items mutableCopy];
+    NSUInteger end = MIN(NSMaxRange(range), items.count);
+    for (NSUInteger i = 0; i < items.count; i++) {
+        if (i < range.location || i >= end) {
+            kept[i] = [NSNull null];
+        }
+    }
+    self.items = kept;
+}
+
+-(void)substituteItems:(NSArray *)items {
+    NSParameterAssert(items.count == self.items.count);
+    self.items = items;
+}
+
+-(void)appendItems:(NSArray *)items {
+    if (items.count == 0) {
+        return;
+    }
+    NSArray *oldItems = self.items ?: @[];
+    self.items = [oldItems arrayByAddingObjectsFromArray:items];
+    [self.delegate listViewModel:self didUpdateItemsWithChanges:[ListChanges insertionOfRange:NSMakeRange(oldItems.count, items.count)]];
+}
+
+-(void)setLoading:(BOOL)loading {
+    if (_loading == loading) {
+        return;
+    }
+    _loading = loading;
+    if ([self.delegate respondsToSelector:@selector(listViewModelDidChangeLoading:)]) {
+        [self.delegate listViewModelDidChangeLoading:self];
+    }
+}
+
+#pragma mark - For subclasses
+
+-(NSString *)snapshotKey {
+    return nil;
+}
+
+-(NSArray *)itemsForSnapshot:(id)snapshot {
+    return @[];
+}
+
+-(NSArray *)itemsForLaunchSnapshot:(SnapshotFile *)file prefix:(NSString *)prefix {
+    return nil;
+}
+
+-(NSDictionary *)launchSnapshotSectionsWithPrefix:(NSString *)prefix {
+    return nil;
+}
+
+-(BOOL)isKeptFresh {
+    return NO;
+}
+
+-(BOOL)mergesFreshItems {
+    return NO;
+}
+
+-(NSArray *)itemsByMergingFreshItems:(NSArray *)freshItems withItems:(NSArray *)oldItems {
+    return freshItems;
+}
+
+-(id<NSCopying>)identifierForItem:(id)item {
+    return [NSValue valueWithNonretainedObject:item];
+}
+
+-(BOOL)item:(id)oldItem isEqualToItem:(id)newItem {
+    return [oldItem isEqual:newItem];
+}
+
+-(void)didPublishFreshItems {
+}
+
+-(void)fetchSnapshotWithSuccess:(void (^)(id))success failure:(void (^)(NSError *))failure {
+    [NSException raise:NSInternalInconsistencyException format:@"%@ must override %@", NSStringFromClass([self class]), NSStringFromSelector(_cmd)];
+}
+
+@end
@@ -0,0 +1,53 @@
+//
+//  MessagePrefetcher.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Loads the first page of messages for contacts the user is likely to open, so MessageViewController
+//  can show them without waiting on the network.
+
+#import <Foundation/Foundation.h>
+
+@class CIOAdaptivePager;
+
+@interface MessagePrefetcher : NSObject
+
+/**
+ *  Prefetches at most this many contacts at once. Defaults to 2, leaving the other connections to the host free
+ *  for requests the user is waiting on.
+ */
+@property(nonatomic) NSUInteger maxConcurrentPrefetches;
+
+/**
+ *  Prefetched pages older than this are dropped instead of shown. Defaults to 120 seconds.
+ */
+@property(nonatomic) NSTimeInterval maxAge;
+
++ (instancetype)sharedPrefetcher;
+
+/**
+ *  Queues the first page of messages for each email, in order, replacing anything still queued from an earlier call.
+ *  Emails that are already cached or loading are skipped.
+ */
+-(void)prefetchMessagesForEmails:(NSArray *)emails;
+
+/**
+ *  Drops queued prefetches and cancels those still loading, except for a contact that was already opened and is
+ *  waiting on its page.
+ */
+-(void)cancelPrefetching;
+
+/**
+ *  Hands the prefetched first page for email over to the caller and forgets it. If the page is still loading,
+ *  completion is called when it arrives.
+ *
+ *  @param completion called on the main thread with the pager positioned after the first page and the raw
+ *                    page, or with nil for both if the prefetch failed
+ *
+ *  @return NO if nothing was prefetched for email, in which case completion is never called
+ */
+-(BOOL)takeMessagesForEmail:(NSString *)email
+                 completion:(void (^)(CIOAdaptivePager *pager, NSArray *page))completion;
+
+@end
@@ -0,0 +1,155 @@
+//
+//  MessagePrefetcher.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "MessagePrefetcher.h"
+#import "CIOAdaptivePager.h"
+#import "NSString+Extensions.h"
+#import "MessagesViewModel.h"
+#import "SnapshotStore.h"
+
+#define kDefaultMaxConcurrentPrefetches     2
+#define kDefaultMaxAge                      120.0
+
+@interface MessagePrefetchEntry : NSObject
+
+@property(nonatomic, strong) CIOAdaptivePager *pager;
+// The page itself is kept in SnapshotStore, where the cache manager's budget and memory warnings reach it
+@property(nonatomic) BOOL loaded;
+@property(nonatomic) NSTimeInterval loadedAt;
+@property(nonatomic, copy) void (^waiter)(CIOAdaptivePager *pager, NSArray *page);
+
+@end
+
+@implementation MessagePrefetchEntry
+
+@end
+
+@interface MessagePrefetcher ()
+
+// All state is only touched on the main thread
+@property(nonatomic, strong) NSMutableDictionary *entries;      // email -> MessagePrefetchEntry
+@property(nonatomic, strong) NSMutableArray *queuedEmails;
+@property(nonatomic) NSUInteger prefetchesInFlight;
+
+@end
+
+@implementation MessagePrefetcher
+
++ (instancetype)sharedPrefetcher {
+    static MessagePrefetcher *prefetcher = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        prefetcher = [[MessagePrefetcher alloc] init];
+    });
+    return prefetcher;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _maxConcurrentPrefetches = kDefaultMaxConcurrentPrefetches;
+        _maxAge = kDefaultMaxAge;
+        _entries = [NSMutableDictionary dictionary];
+        _queuedEmails = [NSMutableArray array];
+    }
+    return self;
+}
+
+-(BOOL)isExpired:(MessagePrefetchEntry *)entry {
+    return entry.loaded && [NSDate timeIntervalSinceReferenceDate] - entry.loadedAt > self.maxAge;
+}
+
+-(void)prefetchMessagesForEmails:(NSArray *)emails {
+    [self.queuedEmails removeAllObjects];
+    for (NSString *email in emails) {
+        if ([NSString isNullOrEmpty:email]) {
+            continue;
+        }
+        MessagePrefetchEntry *entry = self.entries[email];
+        if (entry && ![self isExpired:entry]) {
+            continue;
+        }
+        [self.entries removeObjectForKey:email];
+        [self.queuedEmails addObject:email];
+    }
+    [self startQueuedPrefetches];
+}
+
+-(void)cancelPrefetching {
+    [self.queuedEmails removeAllObjects];
+    // their failure blocks forget the entries and free the slots
+    for (MessagePrefetchEntry *entry in [self.entries allValues]) {
+        if (!entry.loaded && !entry.waiter) {
+            [entry.pager cancel];
+        }
+    }
+}
+
+-(void)startQueuedPrefetches {
+    while (self.prefetchesInFlight < self.maxConcurrentPrefetches && self.queuedEmails.count > 0) {
+        NSString *email = self.queuedEmails.firstObject;
+        [self.queuedEmails removeObjectAtIndex:0];
+
+        MessagePrefetchEntry *entry = [[MessagePrefetchEntry alloc] init];
+        entry.pager = [MessagesViewModel pagerForEmail:email];
+        self.entries[email] = entry;
+        self.prefetchesInFlight++;
+
+        [entry.pager fetchNextPageWithSuccess:^(NSArray * _Nonnull page) {
+            self.prefetchesInFlight--;
+            [[SnapshotStore sharedStore] setObject:page forKey:[MessagesViewModel snapshotKeyForEmail:email]];
+            entry.loaded = YES;
+            entry.loadedAt = [NSDate timeIntervalSinceReferenceDate];
+            if (entry.waiter) {
+                [self finishEntry:entry forEmail:email pager:entry.pager page:page];
+            }
+            [self startQueuedPrefetches];
+        } failure:^(NSError * _Nonnull error) {
+            if (error.code != NSURLErrorCancelled) {
+                NSLog(@"prefetch failed %@", error);
+            }
+            self.prefetchesInFlight--;
+            [self finishEntry:entry forEmail:email pager:nil page:nil];
+            [self startQueuedPrefetches];
+        }];
+    }
+}
+
+-(void)finishEntry:(MessagePrefetchEntry *)entry forEmail:(NSString *)email pager:(CIOAdaptivePager *)pager page:(NSArray *)page {
+    if (self.entries[email] == entry) {
+        [self.entries removeObjectForKey:email];
+    }
+    void (^waiter)(CIOAdaptivePager *, NSArray *) = entry.waiter;
+    entry.waiter = nil;
+    if (waiter) {
+        waiter(pager, page);
+    }
+}
+
+-(BOOL)takeMessagesForEmail:(NSString *)email completion:(void (^)(CIOAdaptivePager *, NSArray *))completion {
+    MessagePrefetchEntry *entry = email ? self.entries[email] : nil;
+    if (!entry || entry.waiter) {
+        return NO;
+    }
+    if ([self isExpired:entry]) {
+        [self.entries removeObjectForKey:email];
+        return NO;
+    }
+    if (entry.loaded) {
+        NSArray *page = [[SnapshotStore sharedStore] objectForKey:[MessagesViewModel snapshotKeyForEmail:email]];
+        if (!page) {
+            [self.entries removeObjectForKey:email];
+            return NO;
+        }
+        entry.waiter = completion;
+        [self finishEntry:entry forEmail:email pager:entry.pager page:page];
+        return YES;
+    }
+    entry.waiter = completion;
+    return YES;
+}
+
+@end
@@ -0,0 +1,34 @@
+//
+//  MessageRow.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  One message row, a handle on a record in a MessageStore with the text a cell shows. The text is read out of
+//  the store when the row is made, off the main thread, and never changes, so configuring a cell only assigns
+//  it. Rows dropped from memory take their text with them.
+
+#import <Foundation/Foundation.h>
+
+@class Messages;
+@class MessageStore;
+
+@interface MessageRow : NSObject
+
+@property(nonatomic, readonly) MessageStore *store;
+@property(nonatomic, readonly) NSUInteger index;
+@property(nonatomic, readonly) NSString *messageID;
+@property(nonatomic, readonly) NSString *dateText;
+@property(nonatomic, readonly) NSString *subjectText;
+// Makes a new object on every call
+@property(nonatomic, readonly) Messages *message;
+
+// Reads the text of the record at index, call it off the main thread
+-(id)initWithStore:(MessageStore *)store index:(NSUInteger)index;
+// The same row with its record moved to index of store, e.g. a compacted store
+-(id)initWithRow:(MessageRow *)row store:(MessageStore *)store index:(NSUInteger)index;
+
+// A row for each of the indexes (NSNumbers)
++ (NSArray *)rowsInStore:(MessageStore *)store indexes:(NSArray *)indexes;
+
+@end
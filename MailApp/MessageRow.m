@@ -0,0 +1,62 @@
+//
+//  MessageRow.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "MessageRow.h"
+#import "Messages.h"
+#import "MessageStore.h"
+
+@implementation MessageRow
+
+-(id)initWithStore:(MessageStore *)store index:(NSUInteger)index {
+    if (self = [super init]) {
+        _store = store;
+        _index = index;
+        _messageID = [store messageIDAtIndex:index];
+        _dateText = [store dateTextAtIndex:index] ?: @"";
+        _subjectText = [store subjectAtIndex:index] ?: @"";
+    }
+    return self;
+}
+
+-(id)initWithRow:(MessageRow *)row store:(MessageStore *)store index:(NSUInteger)index {
+    if (self = [super init]) {
+        _store = store;
+        _index = index;
+        _messageID = row.messageID;
+        _dateText = row.dateText;
+        _subjectText = row.subjectText;
+    }
+    return self;
+}
+
++ (NSArray *)rowsInStore:(MessageStore *)store indexes:(NSArray *)indexes {
+    NSMutableArray *rows = [NSMutableArray arrayWithCapacity:indexes.count];
+    for (NSNumber *index in indexes) {
+        [rows addObject:[[MessageRow alloc] initWithStore:store index:index.unsignedIntegerValue]];
+    }
+    return rows;
+}
+
+-(Messages *)message {
+    return [self.store messageAtIndex:self.index];
+}
+
+// Records are updated in place, so a row is compared by the text it was made with rather than by its record
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[MessageRow class]]) {
+        return NO;
+    }
+    MessageRow *other = object;
+    return [self.subjectText isEqualToString:other.subjectText] && [self.dateText isEqualToString:other.dateText] &&
+           (self.messageID == other.messageID || [self.messageID isEqualToString:other.messageID]);
+}
+
+- (NSUInteger)hash {
+    return self.subjectText.hash;
+}
+
+@end
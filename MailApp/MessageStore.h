@@ -0,0 +1,65 @@
+//
+//  MessageStore.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Message records kept in columns: fixed-width fields in plain arrays, strings as refs. Message IDs, subjects
+//  and dates are nearly all distinct, so they go in an arena of the store's own and are let go with it; only the
+//  reply markers shared by many messages are IDs in the InternTable. A record takes 24 bytes plus its strings,
+//  where a Messages object and its strings take several hundred, and Messages objects are only made when asked for. A message already in the
+//  store is updated in place, so refreshing a page takes no new records. Safe to read from any thread while
+//  another adds records.
+
+#import <Foundation/Foundation.h>
+#import "InternTable.h"
+
+@class SnapshotFile;
+@class Messages;
+
+@interface MessageStore : NSObject
+
+@property(nonatomic, readonly) NSUInteger count;
+// Bytes taken by all records, not counting the strings in the InternTable
+@property(nonatomic, readonly) NSUInteger byteCount;
+
+/**
+ *  A store over columns and strings saved with snapshotSectionsForIndexes:prefix:, read in place from the mapped
+ *  file until the first write copies them. Returns nil if a column is missing or damaged, or they disagree on the count.
+ */
+-(instancetype)initWithSnapshotFile:(SnapshotFile *)file prefix:(NSString *)prefix;
+
+/**
+ *  Adds a record for each message in a response of the messages API, or overwrites the record already kept
+ *  for its message ID. A record keeps its message ID and index for the life of the store. Dates are formatted
+ *  here, so call it off the main thread.
+ *
+ *  @return the index of the record of each message (NSNumbers), in the order of the response
+ */
+-(NSArray *)addMessagesFromResponse:(NSArray *)response;
+
+/**
+ *  Appends copies of the records of store at indexes (NSNumbers), in that order, e.g. to move the rows in
+ *  memory to a new store and let the other records go.
+ *
+ *  @return the indexes of the copies
+ */
+-(NSRange)appendRecordsAtIndexes:(NSArray *)indexes ofStore:(MessageStore *)store;
+
+-(NSString *)messageIDAtIndex:(NSUInteger)index;
+-(NSString *)subjectAtIndex:(NSUInteger)index;
+// Formatted like Messages.date
+-(NSString *)dateTextAtIndex:(NSUInteger)index;
+-(NSTimeInterval)timestampAtIndex:(NSUInteger)index;
+
+// A new Messages object with the fields of the record
+-(Messages *)messageAtIndex:(NSUInteger)index;
+
+// The index of the record of messageID, or NSNotFound
+-(NSUInteger)indexOfMessageID:(NSString *)messageID;
+
+// The records at indexes (NSNumbers), in that order, as one section per column named prefix + column, and their
+// strings as sections named prefix + "strings.*"
+-(NSDictionary *)snapshotSectionsForIndexes:(NSArray *)indexes prefix:(NSString *)prefix;
+
+@end
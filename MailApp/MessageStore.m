@@ -0,0 +1,383 @@
+//
+//  MessageStore.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "MessageStore.h"
+#import "StringArena.h"
+#import "SnapshotFile.h"
+#import "Messages.h"
+
+#define kStringsBytesSectionName    @"strings.bytes"
+#define kStringsTableSectionName    @"strings.table"
+#define kStringsMetaSectionName     @"strings.meta"     // uint32 string count
+#define kMessageIndexSectionName    @"messageIndex"     // MessageStoreIndexEntry sorted by message ID
+
+// Where the record of a message ID is, as saved in a snapshot
+typedef struct {
+    StringRef messageID;
+    uint32_t index;
+} MessageStoreIndexEntry;
+
+@interface MessageStore ()
+
+// One element per record in each column
+@property(nonatomic, strong) NSData *messageIDs;         // StringRef in strings
+@property(nonatomic, strong) NSData *subjectPrefixes;    // StringID, "Re: " and the like
+@property(nonatomic, strong) NSData *subjects;           // StringRef in strings, the rest of the subject
+@property(nonatomic, strong) NSData *dateTexts;          // StringRef in strings
+@property(nonatomic, strong) NSData *timestamps;         // NSTimeInterval
+// Message IDs, subjects and dates hardly repeat from one message to the next. Kept here rather than in the
+// InternTable, which never lets a string go, so they go with the store.
+@property(nonatomic, strong) StringArena *strings;
+@property(nonatomic, readwrite) NSUInteger count;
+// Message ID (StringRef) -> index of its record, for records added since the snapshot was restored
+@property(nonatomic, strong) NSMutableDictionary *indexesByMessageID;
+// Index of the restored records, searched in place
+@property(nonatomic, strong) NSData *restoredIndex;
+// Set while the columns point into a mapped snapshot, which can't grow
+@property(nonatomic) BOOL restored;
+// Concurrent. Reads run side by side, writes are barriers since they can move the columns and the strings.
+@property(nonatomic, strong) dispatch_queue_t queue;
+
+@end
+
+// Splits the reply and forward markers off the front of subject, e.g. "Re: Fwd: " from "Re: Fwd: Lunch", so
+// a thread's subjects share the string of the original
+static NSString *MessageStoreSplitSubject(NSString *subject, NSString **prefix) {
+    static NSArray *markers = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        markers = @[@"re:", @"fwd:", @"fw:"];
+    });
+    *prefix = nil;
+    if (![subject isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    NSUInteger end = 0;
+    BOOL found = YES;
+    while (found) {
+        found = NO;
+        for (NSString *marker in markers) {
+            NSRange range = NSMakeRange(end, MIN(marker.length, subject.length - end));
+            if ([subject compare:marker options:NSCaseInsensitiveSearch range:range] == NSOrderedSame) {
+                end += marker.length;
+                while (end < subject.length && [subject characterAtIndex:end] == ' ') {
+                    end++;
+                }
+                found = YES;
+                break;
+            }
+        }
+    }
+    if (end == 0) {
+        return subject;
+    }
+    *prefix = [subject substringToIndex:end];
+    return [subject substringFromIndex:end];
+}
+
+// Copies field to index of column, growing the column by a record if index is at its end
+static void MessageStoreWriteField(NSData *column, NSUInteger index, const void *field, size_t width) {
+    NSMutableData *growable = (NSMutableData *)column;
+    if (growable.length < (index + 1) * width) {
+        growable.length = (index + 1) * width;
+    }
+    memcpy((uint8_t *)growable.mutableBytes + index * width, field, width);
+}
+
+static int MessageStoreCompareIndexEntries(const void *a, const void *b) {
+    StringRef left = ((const MessageStoreIndexEntry *)a)->messageID;
+    StringRef right = ((const MessageStoreIndexEntry *)b)->messageID;
+    return left < right ? -1 : left > right;
+}
+
+@implementation MessageStore
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _messageIDs = [NSMutableData data];
+        _subjectPrefixes = [NSMutableData data];
+        _subjects = [NSMutableData data];
+        _dateTexts = [NSMutableData data];
+        _timestamps = [NSMutableData data];
+        _strings = [[StringArena alloc] init];
+        _indexesByMessageID = [NSMutableDictionary dictionary];
+        _queue = dispatch_queue_create("com.katyho.MailApp.messagestore", DISPATCH_QUEUE_CONCURRENT);
+    }
+    return self;
+}
+
+-(instancetype)initWithSnapshotFile:(SnapshotFile *)file prefix:(NSString *)prefix {
+    if ((self = [self init])) {
+        NSArray *columns = @[@"messageIDs", @"subjectPrefixes", @"subjects", @"dateTexts", @"timestamps"];
+        NSArray *widths = @[@(sizeof(StringRef)), @(sizeof(StringID)), @(sizeof(StringRef)), @(sizeof(StringRef)), @(sizeof(NSTimeInterval))];
+        NSUInteger count = NSNotFound;
+        for (NSUInteger i = 0; i < columns.count; i++) {
+            NSData *column = [file sectionNamed:[prefix stringByAppendingString:columns[i]]];
+            NSUInteger width = [widths[i] unsignedIntegerValue];
+            if (!column || column.length % width != 0 || (count != NSNotFound && column.length / width != count)) {
+                return nil;
+            }
+            count = column.length / width;
+            [self setValue:column forKey:columns[i]];
+        }
+        _strings = [MessageStore stringsFromSections:@{
+            kStringsBytesSectionName: [file sectionNamed:[prefix stringByAppendingString:kStringsBytesSectionName]] ?: [NSData data],
+            kStringsTableSectionName: [file sectionNamed:[prefix stringByAppendingString:kStringsTableSectionName]] ?: [NSData data],
+            kStringsMetaSectionName: [file sectionNamed:[prefix stringByAppendingString:kStringsMetaSectionName]] ?: [NSData data],
+        }];
+        _restoredIndex = [file sectionNamed:[prefix stringByAppendingString:kMessageIndexSectionName]];
+        if (!_strings || !_restoredIndex || _restoredIndex.length % sizeof(MessageStoreIndexEntry) != 0) {
+            return nil;
+        }
+        _count = count;
+        _restored = YES;
+    }
+    return self;
+}
+
+// The arena saved by snapshotSectionsForIndexes:prefix:, unprefixed, or nil if it is missing or damaged
++ (StringArena *)stringsFromSections:(NSDictionary *)sections {
+    NSData *meta = sections[kStringsMetaSectionName];
+    if (meta.length != sizeof(uint32_t)) {
+        return nil;
+    }
+    return [[StringArena alloc] initWithSnapshotBytes:sections[kStringsBytesSectionName]
+                                                table:sections[kStringsTableSectionName]
+                                          stringCount:*(const uint32_t *)meta.bytes];
+}
+
+// The index of the record of messageID, or NSNotFound. Must run inside the queue.
+-(NSUInteger)indexOfMessageRef:(StringRef)messageID {
+    NSNumber *added = self.indexesByMessageID[@(messageID)];
+    if (added) {
+        return added.unsignedIntegerValue;
+    }
+    const MessageStoreIndexEntry *entries = self.restoredIndex.bytes;
+    NSUInteger low = 0;
+    NSUInteger high = self.restoredIndex.length / sizeof(MessageStoreIndexEntry);
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if (entries[middle].messageID < messageID) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    BOOL found = low < self.restoredIndex.length / sizeof(MessageStoreIndexEntry) && entries[low].messageID == messageID &&
+                 entries[low].index < _count;
+    return found ? entries[low].index : NSNotFound;
+}
+
+// Must run inside a barrier, or before the store is shared
+-(void)indexMessageIDsFromIndex:(NSUInteger)start {
+    const StringRef *messageIDs = self.messageIDs.bytes;
+    for (NSUInteger i = start; i < _count; i++) {
+        if (messageIDs[i] != kNilStringRef) {
+            self.indexesByMessageID[@(messageIDs[i])] = @(i);
+        }
+    }
+}
+
+-(NSUInteger)count {
+    __block NSUInteger count;
+    dispatch_sync(self.queue, ^{
+        count = _count;
+    });
+    return count;
+}
+
+-(NSUInteger)byteCount {
+    __block NSUInteger byteCount;
+    dispatch_sync(self.queue, ^{
+        byteCount = self.messageIDs.length + self.subjectPrefixes.length + self.subjects.length + self.dateTexts.length +
+                    self.timestamps.length + self.strings.byteCount;
+    });
+    return byteCount;
+}
+
+-(NSArray *)addMessagesFromResponse:(NSArray *)response {
+    // split and format outside the barrier so readers aren't held up, the InternTable is safe to use from any thread
+    InternTable *table = [InternTable sharedTable];
+    NSUInteger count = response.count;
+    NSMutableArray *messageIDs = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray *subjects = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray *dateTexts = [NSMutableArray arrayWithCapacity:count];
+    NSMutableData *subjectPrefixes = [NSMutableData dataWithLength:count * sizeof(StringID)];
+    NSMutableData *timestamps = [NSMutableData dataWithLength:count * sizeof(NSTimeInterval)];
+    [response enumerateObjectsUsingBlock:^(NSDictionary *dict, NSUInteger i, BOOL *stop) {
+        NSString *prefix;
+        NSString *subject = MessageStoreSplitSubject([dict valueForKey:@"subject"], &prefix);
+        NSTimeInterval timestamp = [[dict valueForKey:@"date"] doubleValue];
+        [messageIDs addObject:[dict valueForKey:@"message_id"] ?: [NSNull null]];
+        [subjects addObject:subject ?: [NSNull null]];
+        [dateTexts addObject:[Messages stringFromTimestamp:timestamp]];
+        ((StringID *)subjectPrefixes.mutableBytes)[i] = [table internString:prefix];
+        ((NSTimeInterval *)timestamps.mutableBytes)[i] = timestamp;
+    }];
+
+    NSMutableArray *indexes = [NSMutableArray arrayWithCapacity:count];
+    dispatch_barrier_sync(self.queue, ^{
+        [self makeColumnsGrowable];
+        for (NSUInteger i = 0; i < count; i++) {
+            StringRef messageID = [self.strings internString:messageIDs[i]];
+            StringRef subject = [self.strings internString:subjects[i]];
+            StringRef dateText = [self.strings internString:dateTexts[i]];
+            NSUInteger existing = messageID != kNilStringRef ? [self indexOfMessageRef:messageID] : NSNotFound;
+            NSUInteger index = existing != NSNotFound ? existing : _count++;
+            MessageStoreWriteField(self.messageIDs, index, &messageID, sizeof(StringRef));
+            MessageStoreWriteField(self.subjectPrefixes, index, (const StringID *)subjectPrefixes.bytes + i, sizeof(StringID));
+            MessageStoreWriteField(self.subjects, index, &subject, sizeof(StringRef));
+            MessageStoreWriteField(self.dateTexts, index, &dateText, sizeof(StringRef));
+            MessageStoreWriteField(self.timestamps, index, (const NSTimeInterval *)timestamps.bytes + i, sizeof(NSTimeInterval));
+            if (existing == NSNotFound && messageID != kNilStringRef) {
+                self.indexesByMessageID[@(messageID)] = @(index);
+            }
+            [indexes addObject:@(index)];
+        }
+    });
+    return indexes;
+}
+
+-(NSRange)appendRecordsAtIndexes:(NSArray *)indexes ofStore:(MessageStore *)store {
+    NSDictionary *sections = [store snapshotSectionsForIndexes:indexes prefix:@""];
+    StringArena *strings = [MessageStore stringsFromSections:sections];
+    __block NSRange range;
+    dispatch_barrier_sync(self.queue, ^{
+        [self makeColumnsGrowable];
+        range = NSMakeRange(_count, indexes.count);
+        // the refs point into the arena of the sections, move the strings they name over to this store's
+        NSMutableData *messageIDs = [sections[@"messageIDs"] mutableCopy];
+        NSMutableData *subjects = [sections[@"subjects"] mutableCopy];
+        NSMutableData *dateTexts = [sections[@"dateTexts"] mutableCopy];
+        for (NSUInteger i = 0; i < indexes.count; i++) {
+            StringRef *refs[] = {(StringRef *)messageIDs.mutableBytes + i, (StringRef *)subjects.mutableBytes + i,
+                                 (StringRef *)dateTexts.mutableBytes + i};
+            for (NSUInteger j = 0; j < sizeof(refs) / sizeof(refs[0]); j++) {
+                *refs[j] = [self.strings internRef:*refs[j] ofArena:strings];
+            }
+        }
+        [(NSMutableData *)self.messageIDs appendData:messageIDs];
+        [(NSMutableData *)self.subjectPrefixes appendData:sections[@"subjectPrefixes"]];
+        [(NSMutableData *)self.subjects appendData:subjects];
+        [(NSMutableData *)self.dateTexts appendData:dateTexts];
+        [(NSMutableData *)self.timestamps appendData:sections[@"timestamps"]];
+        _count += indexes.count;
+        [self indexMessageIDsFromIndex:range.location];
+    });
+    return range;
+}
+
+// Restored columns point into the snapshot file, the first write copies them. Must run inside a barrier.
+-(void)makeColumnsGrowable {
+    if (!self.restored) {
+        return;
+    }
+    self.messageIDs = [self.messageIDs mutableCopy];
+    self.subjectPrefixes = [self.subjectPrefixes mutableCopy];
+    self.subjects = [self.subjects mutableCopy];
+    self.dateTexts = [self.dateTexts mutableCopy];
+    self.timestamps = [self.timestamps mutableCopy];
+    self.restored = NO;
+}
+
+-(NSString *)messageIDAtIndex:(NSUInteger)index {
+    __block NSString *messageID;
+    dispatch_sync(self.queue, ^{
+        messageID = [self.strings stringForRef:((const StringRef *)self.messageIDs.bytes)[index]];
+    });
+    return messageID;
+}
+
+-(NSString *)subjectAtIndex:(NSUInteger)index {
+    __block StringID prefixID;
+    __block NSString *subject;
+    dispatch_sync(self.queue, ^{
+        prefixID = ((const StringID *)self.subjectPrefixes.bytes)[index];
+        subject = [self.strings stringForRef:((const StringRef *)self.subjects.bytes)[index]];
+    });
+    NSString *prefix = [[InternTable sharedTable] stringForID:prefixID];
+    return prefix ? [prefix stringByAppendingString:subject ?: @""] : subject;
+}
+
+-(NSString *)dateTextAtIndex:(NSUInteger)index {
+    __block NSString *dateText;
+    dispatch_sync(self.queue, ^{
+        dateText = [self.strings stringForRef:((const StringRef *)self.dateTexts.bytes)[index]];
+    });
+    return dateText;
+}
+
+-(NSTimeInterval)timestampAtIndex:(NSUInteger)index {
+    __block NSTimeInterval timestamp;
+    dispatch_sync(self.queue, ^{
+        timestamp = ((const NSTimeInterval *)self.timestamps.bytes)[index];
+    });
+    return timestamp;
+}
+
+-(Messages *)messageAtIndex:(NSUInteger)index {
+    return [[Messages alloc] initWithMessageID:[self messageIDAtIndex:index]
+                                       subject:[self subjectAtIndex:index]
+                                          date:[self dateTextAtIndex:index]];
+}
+
+-(NSUInteger)indexOfMessageID:(NSString *)messageID {
+    __block NSUInteger index = NSNotFound;
+    dispatch_sync(self.queue, ^{
+        StringRef ref = [self.strings refForString:messageID];
+        if (ref != kNilStringRef) {
+            index = [self indexOfMessageRef:ref];
+        }
+    });
+    return index;
+}
+
+// The strings of the records are copied to an arena of their own, so the sections carry none of the others. The
+// index of message IDs is saved sorted, so a restored store searches it in place instead of rebuilding it.
+-(NSDictionary *)snapshotSectionsForIndexes:(NSArray *)indexes prefix:(NSString *)prefix {
+    NSMutableDictionary *sections = [NSMutableDictionary dictionary];
+    dispatch_sync(self.queue, ^{
+        NSArray *columns = @[@"messageIDs", @"subjectPrefixes", @"subjects", @"dateTexts", @"timestamps"];
+        NSArray *widths = @[@(sizeof(StringRef)), @(sizeof(StringID)), @(sizeof(StringRef)), @(sizeof(StringRef)), @(sizeof(NSTimeInterval))];
+        // columns of refs into the store's strings
+        NSSet *arenaColumns = [NSSet setWithObjects:@"messageIDs", @"subjects", @"dateTexts", nil];
+        StringArena *strings = [[StringArena alloc] init];
+        for (NSUInteger i = 0; i < columns.count; i++) {
+            NSData *column = [self valueForKey:columns[i]];
+            NSUInteger width = [widths[i] unsignedIntegerValue];
+            BOOL inArena = [arenaColumns containsObject:columns[i]];
+            NSMutableData *section = [NSMutableData dataWithLength:indexes.count * width];
+            uint8_t *bytes = section.mutableBytes;
+            [indexes enumerateObjectsUsingBlock:^(NSNumber *index, NSUInteger j, BOOL *stop) {
+                memcpy(bytes + j * width, (const uint8_t *)column.bytes + index.unsignedIntegerValue * width, width);
+                if (inArena) {
+                    StringRef *ref = (StringRef *)(bytes + j * width);
+                    *ref = [strings internRef:*ref ofArena:self.strings];
+                }
+            }];
+            sections[[prefix stringByAppendingString:columns[i]]] = section;
+        }
+        const StringRef *messageIDs = [sections[[prefix stringByAppendingString:@"messageIDs"]] bytes];
+        NSMutableData *index = [NSMutableData dataWithCapacity:indexes.count * sizeof(MessageStoreIndexEntry)];
+        for (NSUInteger j = 0; j < indexes.count; j++) {
+            if (messageIDs[j] != kNilStringRef) {
+                MessageStoreIndexEntry entry = {messageIDs[j], (uint32_t)j};
+                [index appendBytes:&entry length:sizeof(entry)];
+            }
+        }
+        qsort(index.mutableBytes, index.length / sizeof(MessageStoreIndexEntry), sizeof(MessageStoreIndexEntry),
+              MessageStoreCompareIndexEntries);
+        sections[[prefix stringByAppendingString:kMessageIndexSectionName]] = index;
+        uint32_t stringCount = (uint32_t)strings.stringCount;
+        sections[[prefix stringByAppendingString:kStringsBytesSectionName]] = [strings snapshotBytes];
+        sections[[prefix stringByAppendingString:kStringsTableSectionName]] = [strings snapshotTable];
+        sections[[prefix stringByAppendingString:kStringsMetaSectionName]] = [NSData dataWithBytes:&stringCount length:sizeof(stringCount)];
+    });
+    return sections;
+}
+
+@end
@@ -11,7 +11,10 @@
 @implementation MessageTableViewCell
 
 - (void)awakeFromNib {
-    // Initialization code
+    [super awakeFromNib];
+    // Initialization code, done once per cell rather than on every dequeue
+    [self.contentView.layer setBorderColor:[UIColor blackColor].CGColor];
+    [self.contentView.layer setBorderWidth:0.1f];
 }
 
 - (void)setSelected:(BOOL)selected animated:(BOOL)animated {
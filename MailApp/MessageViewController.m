@@ -7,19 +7,26 @@
 //
 
 #import "MessageViewController.h"
+#import <QuartzCore/QuartzCore.h>
 #import "MessageTableViewCell.h"
 
 #import "SVProgressHUD.h"
 #import "Constants.h"
 #import "CIOExtensions.h"
-#import "Messages.h"
+#import "MessageRow.h"
+#import "MessagesViewModel.h"
+#import "UITableView+ListChanges.h"
 
 #define kSectionNumber      1
 #define kMessageReuseId     @"MessageCell"
+#define kMessageRowHeight   71.0f
 
-@interface MessageViewController ()
+@interface MessageViewController () <ListViewModelDelegate>
 
-@property(nonatomic, strong)NSArray *messages;
+@property(nonatomic, strong)MessagesViewModel *viewModel;
+// last scroll sample, for the scroll velocity
+@property(nonatomic)CGFloat lastContentOffsetY;
+@property(nonatomic)NSTimeInterval lastScrollTime;
 
 @end
 
@@ -28,6 +35,10 @@
 - (void)viewDidLoad {
     [super viewDidLoad];
     NSLog(@"responseDict %@", self.selectedContact.email);
+    self.viewModel = [[MessagesViewModel alloc] initWithEmail:self.selectedContact.email];
+    self.viewModel.delegate = self;
+    // paints the last known messages right away, fresh ones are merged in when they arrive
+    [self.viewModel load];
     // Uncomment the following line to preserve selection between presentations.
     // self.clearsSelectionOnViewWillAppear = NO;
     
@@ -38,7 +49,9 @@
 -(void)viewDidAppear:(BOOL)animated {
     [super viewDidAppear:animated];
     self.title = @"Messages";
-    [self fetchMessages];
+    if (!self.viewModel.items && self.viewModel.loading) {
+        [SVProgressHUD show];
+    }
 }
 
 - (void)didReceiveMemoryWarning {
@@ -53,7 +66,7 @@
 }
 
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
-    return self.messages.count;
+    return self.viewModel.items.count;
 }
 
 
@@ -62,12 +75,12 @@
     
     // Configure the cell...
     if (cell) {
-        Messages *message = [self.messages objectAtIndex:indexPath.row];
-        
-        cell.dateLabel.text = message.date;
-        cell.subjectTextView.text = message.subject;
-        [cell.contentView.layer setBorderColor:[UIColor blackColor].CGColor];
-        [cell.contentView.layer setBorderWidth:0.1f];
+        // rows carry their text, formatted off the main thread when the messages arrive, see MessageRow
+        // rows dropped from memory are NSNull and stay blank until they're loaded again
+        MessageRow *row = [self.viewModel.items objectAtIndex:indexPath.row];
+        BOOL loaded = (id)row != [NSNull null];
+        cell.dateLabel.text = loaded ? row.dateText : nil;
+        cell.subjectTextView.text = loaded ? row.subjectText : nil;
     }
     
     
@@ -75,7 +88,41 @@
 }
 
 - (CGFloat)tableView:(UITableView *)tableView heightForRowAtIndexPath:(NSIndexPath *)indexPath {
-    return 71.0f;
+    return kMessageRowHeight;
+}
+
+#pragma mark - Scroll view delegate
+
+- (void)scrollViewDidScroll:(UIScrollView *)scrollView {
+    NSTimeInterval now = CACurrentMediaTime();
+    CGFloat offsetY = scrollView.contentOffset.y;
+    NSTimeInterval elapsed = now - self.lastScrollTime;
+    double rowsPerSecond = 0;
+    if (self.lastScrollTime > 0 && elapsed > 0) {
+        rowsPerSecond = (offsetY - self.lastContentOffsetY) / kMessageRowHeight / elapsed;
+    }
+    self.lastContentOffsetY = offsetY;
+    self.lastScrollTime = now;
+    [self.viewModel scrollToVisibleRange:[self rowRangeForContentOffsetY:offsetY] rowsPerSecond:rowsPerSecond];
+}
+
+- (void)scrollViewWillEndDragging:(UIScrollView *)scrollView withVelocity:(CGPoint)velocity targetContentOffset:(inout CGPoint *)targetContentOffset {
+    // start on the rows a flick will come to rest on instead of every row it passes
+    NSRange targetRange = [self rowRangeForContentOffsetY:targetContentOffset->y];
+    double rowsPerSecond = velocity.y * 1000.0 / kMessageRowHeight;
+    [self.viewModel scrollToVisibleRange:targetRange rowsPerSecond:rowsPerSecond];
+}
+
+- (void)scrollViewDidEndDecelerating:(UIScrollView *)scrollView {
+    self.lastScrollTime = 0;
+    [self.viewModel scrollToVisibleRange:[self rowRangeForContentOffsetY:scrollView.contentOffset.y] rowsPerSecond:0];
+}
+
+-(NSRange)rowRangeForContentOffsetY:(CGFloat)offsetY {
+    CGFloat top = MAX(offsetY + self.tableView.contentInset.top, 0);
+    NSUInteger first = (NSUInteger)(top / kMessageRowHeight);
+    NSUInteger visible = (NSUInteger)ceil(CGRectGetHeight(self.tableView.bounds) / kMessageRowHeight) + 1;
+    return NSMakeRange(first, visible);
 }
 
 /*
@@ -122,21 +169,22 @@
 }
 */
 
--(void)fetchMessages {
-    [SVProgressHUD show];
-    CIOMessagesRequest *messagesRequest = [[CIOV2Client sharedInstance] getMessages];
-    
-    // set messageRequest parameters
-    messagesRequest.limit = 20;
-    messagesRequest.email = self.selectedContact.email;
-    
-    [messagesRequest executeWithSuccess:^(NSArray * _Nonnull responseArray) {
+#pragma mark - ListViewModelDelegate
+
+-(void)listViewModel:(ListViewModel *)viewModel didUpdateItemsWithChanges:(ListChanges *)changes {
+    [self.tableView applyListChanges:changes inSection:0];
+    // a short first page may not fill the screen, so nothing scrolls to ask for more
+    [self.viewModel scrollToVisibleRange:[self rowRangeForContentOffsetY:self.tableView.contentOffset.y] rowsPerSecond:0];
+}
+
+-(void)listViewModel:(ListViewModel *)viewModel didFailWithError:(NSError *)error {
+    NSLog(@"failed %@", error);
+}
+
+-(void)listViewModelDidChangeLoading:(ListViewModel *)viewModel {
+    if (!viewModel.loading) {
         [SVProgressHUD dismiss];
-        self.messages = [Messages messagesArrayForResponse:responseArray];
-        [self.tableView reloadData];
-    } failure:^(NSError * _Nonnull error) {
-        NSLog(@"failed %@", error);
-    }];
+    }
 }
 
 @end
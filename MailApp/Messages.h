@@ -11,9 +11,17 @@
 
 @interface Messages : NSObject
 
+@property(strong, nonatomic) NSString *messageID;
 @property(strong, nonatomic) NSString *subject;
 @property(strong, nonatomic) NSString *date;
 
+-(id)initWithDictionary:(NSDictionary*)dict;
+
+-(id)initWithMessageID:(NSString *)messageID subject:(NSString *)subject date:(NSString *)date;
+
+//  The date text for a "date" field of the API, in seconds since 1970
++(NSString *)stringFromTimestamp:(NSTimeInterval)timestamp;
+
 
 +(NSArray *)messagesArrayForResponse:(NSArray *)response; 
 
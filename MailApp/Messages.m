@@ -12,25 +12,52 @@
 @implementation Messages
 
 //  Initialize fields of Message from the dictionary object for each message
--(in)initWithDictionary:(NSDictionary *)dict {
+-(id)initWithDictionary:(NSDictionary *)dict {
     if (self = [super init]) {
-        NSLog(@"dict %@", dict);
         NSTimeInterval d = [[dict valueForKey:@"date"] doubleValue];
-        NSDate *date = [NSDate dateWithTimeIntervalSince1970:d];
-        _date = [self stringFromDate:date];
+        _messageID = [dict valueForKey:@"message_id"];
+        _date = [Messages stringFromTimestamp:d];
         _subject = [dict valueForKey:@"subject"];
         
     }
     return self;
 }
 
-//  Convert NSDate object into a string with format "dd-MM-yyyy"
-- (NSString *)stringFromDate:(NSDate *)date {
-    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
-    [dateFormatter setDateFormat:@"dd-MM-yyyy 'at' HH:mm"];
-    NSString *dateString = [dateFormatter stringFromDate:date];
-    return dateString;
-    
+//  Initialize fields of Message from a MessageStore record
+-(id)initWithMessageID:(NSString *)messageID subject:(NSString *)subject date:(NSString *)date {
+    if (self = [super init]) {
+        _messageID = messageID;
+        _subject = subject;
+        _date = date;
+    }
+    return self;
+}
+
+//  Messages are equal when they have the same ID, subject and date
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[Messages class]]) {
+        return NO;
+    }
+    Messages *other = object;
+    return (self.messageID == other.messageID || [self.messageID isEqual:other.messageID]) &&
+           (self.subject == other.subject || [self.subject isEqual:other.subject]) &&
+           (self.date == other.date || [self.date isEqual:other.date]);
+}
+
+- (NSUInteger)hash {
+    return self.messageID.hash;
+}
+
+//  Convert a timestamp into a string with format "dd-MM-yyyy at HH:mm"
++ (NSString *)stringFromTimestamp:(NSTimeInterval)timestamp {
+    // creating a formatter is far more expensive than using one, and formatting is thread safe
+    static NSDateFormatter *dateFormatter = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dateFormatter = [[NSDateFormatter alloc] init];
+        [dateFormatter setDateFormat:@"dd-MM-yyyy 'at' HH:mm"];
+    });
+    return [dateFormatter stringFromDate:[NSDate dateWithTimeIntervalSince1970:timestamp]];
 }
 
 //  Return an array of Message objects from the response returned by
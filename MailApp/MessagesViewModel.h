@@ -0,0 +1,41 @@
+//
+//  MessagesViewModel.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Messages exchanged with one contact, newest first. Items are MessageRows. Revalidation reloads the
+//  first page; further pages follow the scroll position, see scrollToVisibleRange:rowsPerSecond:.
+
+#import "ListViewModel.h"
+
+@class CIOAdaptivePager;
+
+@interface MessagesViewModel : ListViewModel
+
+@property(nonatomic, readonly) NSString *email;
+@property(nonatomic, readonly) BOOL hasMorePages;
+
+// Rows kept in memory around the visible ones, the rest are dropped and loaded again when needed. Defaults to 600.
+@property(nonatomic) NSUInteger maxResidentRows;
+// Pages loaded at once to fill dropped rows. Defaults to 2.
+@property(nonatomic) NSUInteger maxConcurrentFills;
+
+-(id)initWithEmail:(NSString *)email;
+
+-(void)loadNextPage;
+
+/**
+ *  Call as the table scrolls. Loads the rows the user will reach within the time a page takes at the current speed
+ *  (negative when scrolling up), forgets pages still loading for rows that are no longer needed, and drops rows far
+ *  from the visible ones.
+ */
+-(void)scrollToVisibleRange:(NSRange)visibleRange rowsPerSecond:(double)rowsPerSecond;
+
+// Key of the list of email, the same for any capitalization of it
++ (NSString *)snapshotKeyForEmail:(NSString *)email;
+
+// The pager for the messages exchanged with email, also used by MessagePrefetcher
++ (CIOAdaptivePager *)pagerForEmail:(NSString *)email;
+
+@end
@@ -0,0 +1,382 @@
+//
+//  MessagesViewModel.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "MessagesViewModel.h"
+#import "MessagePrefetcher.h"
+#import "CIOAdaptivePager.h"
+#import "CIOExtensions.h"
+#import "MessageRow.h"
+#import "MessageStore.h"
+#import "SnapshotFile.h"
+#import "PushUpdater.h"
+#import "CacheManager.h"
+
+#define kDefaultMaxResidentRows         600
+#define kDefaultMaxConcurrentFills      2
+// Load far enough ahead to cover this many times the expected page latency
+#define kLeadFactor                     1.5
+
+// Registered with the cache manager for the memory of its store
+@interface MessagesViewModel () <ManagedMemory>
+
+@property(nonatomic, readwrite) NSString *email;
+@property(nonatomic, strong) CIOAdaptivePager *pager;
+// Every message loaded for this list. Items are rows pointing into it. Atomic, the cache manager reads it on its
+// own queue and rows are made on the diff queue while compacting replaces it on the main thread.
+@property(atomic, strong) MessageStore *store;
+// offset -> NSValue with the NSRange of a page loading to fill dropped rows. Removing an entry forgets the page.
+@property(nonatomic, strong) NSMutableDictionary *fillLoads;
+// Rows outside this range were dropped the last time memory was trimmed
+@property(nonatomic) NSRange keptRange;
+// Rows restored from the launch snapshot, until the first page is revalidated
+@property(nonatomic) NSUInteger restoredRowCount;
+// Set when the first page only replaces the top of the restored rows, the rest are kept while diffing. Main
+// thread only, the diff reads it through mergesFreshItems before it starts.
+@property(nonatomic) BOOL keepsRestoredRows;
+
+@end
+
+@implementation MessagesViewModel
+
++ (NSString *)snapshotKeyForEmail:(NSString *)email {
+    // lowercased like the addresses of pushed messages, so both find the same list whatever the contacts API returned
+    return [NSString stringWithFormat:@"messages-%@", [email lowercaseString]];
+}
+
++ (CIOAdaptivePager *)pagerForEmail:(NSString *)email {
+    return [[CIOAdaptivePager alloc] initWithRequestFactory:^CIOArrayRequest *{
+        CIOMessagesRequest *messagesRequest = [[CIOV2Client sharedInstance] getMessages];
+        // set messageRequest parameters, the pager sets limit and offset
+        messagesRequest.email = email;
+        return messagesRequest;
+    }];
+}
+
+-(id)initWithEmail:(NSString *)email {
+    if (self = [super init]) {
+        _email = email;
+        _store = [[MessageStore alloc] init];
+        _maxResidentRows = kDefaultMaxResidentRows;
+        _maxConcurrentFills = kDefaultMaxConcurrentFills;
+        _fillLoads = [NSMutableDictionary dictionary];
+        _keptRange = NSMakeRange(0, NSUIntegerMax);
+        [[CacheManager sharedManager] registerMemory:self priority:CachePriorityModels];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(didReceivePushedMessage:)
+                                                     name:kPushedMessageNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+-(BOOL)hasMorePages {
+    return self.pager.hasMorePages;
+}
+
+-(NSString *)snapshotKey {
+    return self.email ? [MessagesViewModel snapshotKeyForEmail:self.email] : nil;
+}
+
+-(NSArray *)itemsForSnapshot:(id)snapshot {
+    // a refreshed page updates the records it already has in place
+    MessageStore *store = self.store;
+    NSArray *rows = [MessageRow rowsInStore:store indexes:[store addMessagesFromResponse:snapshot]];
+    [[CacheManager sharedManager] registeredMemoryDidGrow];
+    return rows;
+}
+
+-(BOOL)isKeptFresh {
+    return [[PushUpdater sharedUpdater] isKeyFresh:[self snapshotKey]];
+}
+
+-(NSArray *)itemsForLaunchSnapshot:(SnapshotFile *)file prefix:(NSString *)prefix {
+    MessageStore *store = [[MessageStore alloc] initWithSnapshotFile:file prefix:prefix];
+    if (store.count == 0) {
+        return nil;
+    }
+    self.store = store;
+    self.restoredRowCount = store.count;
+    NSMutableArray *indexes = [NSMutableArray arrayWithCapacity:store.count];
+    for (NSUInteger i = 0; i < store.count; i++) {
+        [indexes addObject:@(i)];
+    }
+    return [MessageRow rowsInStore:store indexes:indexes];
+}
+
+// Saves the rows from the top down to the first dropped one, which are what the screen opens on
+-(NSDictionary *)launchSnapshotSectionsWithPrefix:(NSString *)prefix {
+    MessageStore *store = self.store;
+    NSMutableArray *indexes = [NSMutableArray array];
+    for (MessageRow *row in self.items) {
+        // rows of an older store are still waiting to be compacted
+        if ((id)row == [NSNull null] || row.store != store) {
+            break;
+        }
+        [indexes addObject:@(row.index)];
+    }
+    return indexes.count > 0 ? [store snapshotSectionsForIndexes:indexes prefix:prefix] : nil;
+}
+
+-(BOOL)mergesFreshItems {
+    return self.keepsRestoredRows;
+}
+
+-(NSArray *)itemsByMergingFreshItems:(NSArray *)freshItems withItems:(NSArray *)oldItems {
+    NSMutableSet *freshIdentifiers = [NSMutableSet setWithCapacity:freshItems.count];
+    for (MessageRow *row in freshItems) {
+        [freshIdentifiers addObject:[self identifierForItem:row]];
+    }
+    NSMutableArray *items = [freshItems mutableCopy];
+    for (MessageRow *row in oldItems) {
+        if ((id)row != [NSNull null] && ![freshIdentifiers containsObject:[self identifierForItem:row]]) {
+            [items addObject:row];
+        }
+    }
+    return items;
+}
+
+-(id<NSCopying>)identifierForItem:(MessageRow *)row {
+    if ((id)row == [NSNull null]) {
+        return [NSNull null];
+    }
+    // message IDs aren't interned, and rows of a diff can be in different stores, so the string is the identifier
+    return row.messageID ?: [NSNull null];
+}
+
+-(void)fetchSnapshotWithSuccess:(void (^)(id))success failure:(void (^)(NSError *))failure {
+    __weak MessagesViewModel *weakSelf = self;
+    void (^revalidated)(id) = ^(NSArray *page) {
+        [weakSelf keepRestoredRowsAfterFirstPage:page];
+        [[PushUpdater sharedUpdater] didRevalidateKey:[weakSelf snapshotKey]];
+        success(page);
+    };
+    // a page prefetched from the contacts list counts as the revalidation
+    BOOL prefetched = [[MessagePrefetcher sharedPrefetcher] takeMessagesForEmail:self.email completion:^(CIOAdaptivePager *pager, NSArray *page) {
+        MessagesViewModel *strongSelf = weakSelf;
+        if (!strongSelf) {
+            return;
+        }
+        if (pager) {
+            strongSelf.pager = pager;
+            revalidated(page);
+        } else {
+            [strongSelf fetchFirstPageWithSuccess:revalidated failure:failure];
+        }
+    }];
+    if (!prefetched) {
+        [self fetchFirstPageWithSuccess:revalidated failure:failure];
+    }
+}
+
+// A long list restored at launch would shrink back to one page once it is revalidated. Instead the page replaces
+// the top of it and paging goes on after the restored rows, moved down by the messages that are new.
+-(void)keepRestoredRowsAfterFirstPage:(NSArray *)page {
+    NSUInteger restoredRowCount = self.restoredRowCount;
+    self.restoredRowCount = 0;
+    if (restoredRowCount == 0 || !self.pager.hasMorePages) {
+        return;
+    }
+    // the page isn't in the store yet, so anything found there was restored
+    NSUInteger newRowCount = 0;
+    for (NSDictionary *dict in page) {
+        if ([self.store indexOfMessageID:[dict valueForKey:@"message_id"]] == NSNotFound) {
+            newRowCount++;
+        }
+    }
+    self.keepsRestoredRows = YES;
+    [self.pager skipToOffset:(NSInteger)(restoredRowCount + newRowCount)];
+}
+
+-(void)fetchFirstPageWithSuccess:(void (^)(id))success failure:(void (^)(NSError *))failure {
+    self.pager = [MessagesViewModel pagerForEmail:self.email];
+    [self.pager fetchNextPageWithSuccess:success failure:failure];
+}
+
+// New messages go on top. Everything below moves down a row, on the server too.
+-(void)didReceivePushedMessage:(NSNotification *)notification {
+    NSDictionary *message = notification.userInfo[kPushedMessageKey];
+    if (!self.items || !self.email || ![[PushUpdater emailsInMessage:message] containsObject:[self.email lowercaseString]] ||
+        [self.store indexOfMessageID:message[@"message_id"]] != NSNotFound) {
+        return;
+    }
+    // pages loading to fill dropped rows would land a row too high
+    [self.fillLoads removeAllObjects];
+    if (self.keptRange.length < NSUIntegerMax) {
+        self.keptRange = NSMakeRange(self.keptRange.location + 1, self.keptRange.length);
+    }
+    [self.pager skipToOffset:self.pager.offset + 1];
+    [self insertSnapshot:@[message] atIndex:0];
+}
+
+-(void)loadNextPage {
+    if (self.loading || !self.pager) {
+        return;
+    }
+    self.loading = YES;
+    __weak MessagesViewModel *weakSelf = self;
+    [self.pager fetchNextPageWithSuccess:^(NSArray * _Nonnull page) {
+        MessagesViewModel *strongSelf = weakSelf;
+        [strongSelf appendSnapshot:page];
+        strongSelf.loading = NO;
+    } failure:^(NSError * _Nonnull error) {
+        MessagesViewModel *strongSelf = weakSelf;
+        strongSelf.loading = NO;
+        if ([strongSelf.delegate respondsToSelector:@selector(listViewModel:didFailWithError:)]) {
+            [strongSelf.delegate listViewModel:strongSelf didFailWithError:error];
+        }
+    }];
+}
+
+-(void)scrollToVisibleRange:(NSRange)visibleRange rowsPerSecond:(double)rowsPerSecond {
+    NSArray *items = self.items;
+    if (!items || !self.pager) {
+        return;
+    }
+    NSInteger count = (NSInteger)items.count;
+    NSInteger pageSize = self.pager.pageSize;
+    // rows that go by while a page loads, looked for in the direction of scrolling
+    NSInteger lead = MAX(pageSize, (NSInteger)ceil(fabs(rowsPerSecond) * self.pager.expectedPageLatency * kLeadFactor));
+    NSInteger start = MAX((NSInteger)visibleRange.location - (rowsPerSecond < 0 ? lead : pageSize), 0);
+    NSInteger end = (NSInteger)NSMaxRange(visibleRange) + (rowsPerSecond < 0 ? pageSize : lead);
+    NSRange neededRange = NSMakeRange((NSUInteger)start, (NSUInteger)(end - start));
+
+    // a fast flick leaves pages loading for rows nobody will see, free their slots
+    for (NSNumber *offset in self.fillLoads.allKeys) {
+        if (NSIntersectionRange([self.fillLoads[offset] rangeValue], neededRange).length == 0) {
+            [self.fillLoads removeObjectForKey:offset];
+        }
+    }
+
+    if (end > count && self.pager.hasMorePages) {
+        [self loadNextPage];
+    }
+
+    // fill rows dropped earlier that are about to be seen again
+    for (NSInteger i = start; i < MIN(end, count) && self.fillLoads.count < self.maxConcurrentFills; i++) {
+        if (items[i] != [NSNull null]) {
+            continue;
+        }
+        NSRange loading = [self fillLoadCoveringIndex:(NSUInteger)i];
+        if (loading.length > 0) {
+            i = (NSInteger)NSMaxRange(loading) - 1;
+            continue;
+        }
+        [self fillRowsFromIndex:(NSUInteger)i];
+        i += pageSize - 1;
+    }
+
+    [self trimRowsAroundVisibleRange:visibleRange];
+}
+
+-(NSRange)fillLoadCoveringIndex:(NSUInteger)index {
+    for (NSValue *value in self.fillLoads.allValues) {
+        if (NSLocationInRange(index, value.rangeValue)) {
+            return value.rangeValue;
+        }
+    }
+    return NSMakeRange(0, 0);
+}
+
+-(void)fillRowsFromIndex:(NSUInteger)index {
+    NSValue *load = [NSValue valueWithRange:NSMakeRange(index, (NSUInteger)self.pager.pageSize)];
+    self.fillLoads[@(index)] = load;
+    __weak MessagesViewModel *weakSelf = self;
+    [self.pager fetchPageAtOffset:(NSInteger)index success:^(NSArray * _Nonnull page) {
+        MessagesViewModel *strongSelf = weakSelf;
+        if (strongSelf.fillLoads[@(index)] != load) {
+            return;
+        }
+        [strongSelf.fillLoads removeObjectForKey:@(index)];
+        [strongSelf fillItemsFromIndex:index withSnapshot:page];
+    } failure:^(NSError * _Nonnull error) {
+        MessagesViewModel *strongSelf = weakSelf;
+        if (strongSelf.fillLoads[@(index)] == load) {
+            [strongSelf.fillLoads removeObjectForKey:@(index)];
+        }
+    }];
+}
+
+#pragma mark - ManagedMemory
+
+-(NSUInteger)managedMemoryCost {
+    return self.store.byteCount;
+}
+
+-(void)shedManagedMemory {
+    [self compactStore];
+}
+
+-(void)didPublishFreshItems {
+    self.keepsRestoredRows = NO;
+    [self compactStore];
+}
+
+// Copies the records of the rows in memory to a new store and points the rows at it. Records of dropped rows and
+// of messages no longer listed go with the old store, once no row of a diff still running holds on to it. Rows
+// made into an older store while the last compaction ran are moved too.
+-(void)compactStore {
+    NSArray *items = self.items;
+    NSMapTable *indexesByStore = [NSMapTable strongToStrongObjectsMapTable];
+    for (MessageRow *row in items) {
+        if ((id)row == [NSNull null]) {
+            continue;
+        }
+        NSMutableArray *indexes = [indexesByStore objectForKey:row.store];
+        if (!indexes) {
+            indexes = [NSMutableArray array];
+            [indexesByStore setObject:indexes forKey:row.store];
+        }
+        [indexes addObject:@(row.index)];
+    }
+    MessageStore *compacted = [[MessageStore alloc] init];
+    // store -> index in compacted of the next row of that store
+    NSMapTable *nextIndexByStore = [NSMapTable strongToStrongObjectsMapTable];
+    for (MessageStore *store in indexesByStore) {
+        NSRange range = [compacted appendRecordsAtIndexes:[indexesByStore objectForKey:store] ofStore:store];
+        [nextIndexByStore setObject:@(range.location) forKey:store];
+    }
+    NSMutableArray *moved = [items mutableCopy];
+    for (NSUInteger i = 0; i < items.count; i++) {
+        MessageRow *row = items[i];
+        if ((id)row == [NSNull null]) {
+            continue;
+        }
+        NSUInteger index = [[nextIndexByStore objectForKey:row.store] unsignedIntegerValue];
+        [nextIndexByStore setObject:@(index + 1) forKey:row.store];
+        moved[i] = [[MessageRow alloc] initWithRow:row store:compacted index:index];
+    }
+    self.store = compacted;
+    if (items) {
+        [self substituteItems:moved];
+    }
+}
+
+// Keeps at most maxResidentRows centered on the visible rows, trimming only once the center has moved a quarter
+// of that away so scrolling doesn't copy the rows on every frame
+-(void)trimRowsAroundVisibleRange:(NSRange)visibleRange {
+    NSUInteger count = self.items.count;
+    if (count <= self.maxResidentRows) {
+        return;
+    }
+    NSUInteger center = visibleRange.location + visibleRange.length / 2;
+    NSUInteger half = self.maxResidentRows / 2;
+    NSUInteger keptCenter = self.keptRange.location + MIN(self.keptRange.length, count) / 2;
+    BOOL keptRangeLimits = self.keptRange.length < count;
+    if (keptRangeLimits && (center > keptCenter ? center - keptCenter : keptCenter - center) < self.maxResidentRows / 4) {
+        return;
+    }
+    NSUInteger location = center > half ? center - half : 0;
+    self.keptRange = NSMakeRange(location, self.maxResidentRows);
+    [self dropItemsOutsideRange:self.keptRange];
+    [self compactStore];
+}
+
+@end
@@ -0,0 +1,42 @@
+//
+//  PushUpdater.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Keeps message lists current from a Context.IO WebHook instead of refetching them. A CIOWebhookReceiver on the
+//  device is told about each new message; it is added to the live list and the saved first page of every contact
+//  it involves, and lists revalidated recently while the WebHook is active don't fetch again when they are reopened.
+//  Does nothing unless kWebhookBaseURL is set.
+
+#import <Foundation/Foundation.h>
+
+// Posted on the main thread for each new message, under kPushedMessageKey as it came in the WebHook's message_data
+extern NSString *const kPushedMessageNotification;
+extern NSString *const kPushedMessageKey;
+
+@interface PushUpdater : NSObject
+
+// YES while the WebHook is active and the receiver listening
+@property(nonatomic, readonly, getter=isActive) BOOL active;
+
++ (instancetype)sharedUpdater;
+
+// Starts the receiver and activates the WebHook, creating it the first time. Call at launch and in the foreground.
+-(void)start;
+
+// Pauses the WebHook, in a background task so it can be called on entering the background, and stops the
+// receiver. Lists are no longer fresh once it is stopped.
+-(void)stop;
+
+// YES if the list saved under key was revalidated while the WebHook stayed active, so no new message was missed
+// since, and not longer ago than a few minutes, since WebHooks don't tell about deletions or flag changes
+-(BOOL)isKeyFresh:(NSString *)key;
+
+// Call when the list saved under key has been revalidated
+-(void)didRevalidateKey:(NSString *)key;
+
+// Lowercased addresses a message is from or sent to
++ (NSArray *)emailsInMessage:(NSDictionary *)message;
+
+@end
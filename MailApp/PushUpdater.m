@@ -0,0 +1,196 @@
+//
+//  PushUpdater.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "PushUpdater.h"
+#import "Constants.h"
+#import "CIOExtensions.h"
+#import "CIOWebhookReceiver.h"
+#import "SnapshotStore.h"
+#import "LaunchSnapshot.h"
+#import "MessagesViewModel.h"
+
+#define kWebhookIDDefaultsKey           @"PushUpdaterWebhookID"
+// WebHooks only tell about new messages, so a list still revalidates once this old to catch deletions and flag changes
+#define kMaxFreshAge                    300
+
+NSString *const kPushedMessageNotification = @"PushedMessageNotification";
+NSString *const kPushedMessageKey = @"message";
+
+@interface PushUpdater ()
+
+@property(nonatomic, readwrite, getter=isActive) BOOL active;
+@property(nonatomic, strong) CIOWebhookReceiver *receiver;
+// Key -> NSDate the list was revalidated, since the WebHook last became active
+@property(nonatomic, strong) NSMutableDictionary *freshKeys;
+
+@end
+
+@implementation PushUpdater
+
++ (instancetype)sharedUpdater {
+    static PushUpdater *updater = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        updater = [[PushUpdater alloc] init];
+    });
+    return updater;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _freshKeys = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+-(void)start {
+    if (kWebhookBaseURL.length == 0 || self.receiver) {
+        return;
+    }
+    CIOWebhookReceiver *receiver = [[CIOWebhookReceiver alloc] initWithConsumerSecret:kContextIOConsumerSecret];
+    __weak PushUpdater *weakSelf = self;
+    receiver.callbackHandler = ^(NSDictionary *payload) {
+        [weakSelf applyMessage:payload[@"message_data"]];
+    };
+    receiver.failureHandler = ^(NSDictionary *payload) {
+        // Context.IO lost the mailbox connection and paused the WebHook, anything since then was missed
+        PushUpdater *strongSelf = weakSelf;
+        strongSelf.active = NO;
+        [strongSelf activateWebhook];
+    };
+    NSError *error;
+    if (![receiver startOnPort:kWebhookListenPort error:&error]) {
+        NSLog(@"webhook receiver could not start: %@", error);
+        return;
+    }
+    self.receiver = receiver;
+    [self activateWebhook];
+}
+
+-(void)stop {
+    if (!self.receiver) {
+        return;
+    }
+    NSString *webhookID = [[NSUserDefaults standardUserDefaults] stringForKey:kWebhookIDDefaultsKey];
+    if (webhookID) {
+        // called on the way into the background, keep running until the server has paused the WebHook
+        UIApplication *application = [UIApplication sharedApplication];
+        __block UIBackgroundTaskIdentifier task = [application beginBackgroundTaskWithExpirationHandler:^{
+            [application endBackgroundTask:task];
+            task = UIBackgroundTaskInvalid;
+        }];
+        void (^finished)(void) = ^{
+            if (task != UIBackgroundTaskInvalid) {
+                [application endBackgroundTask:task];
+                task = UIBackgroundTaskInvalid;
+            }
+        };
+        [[[CIOLiteClient sharedInstance] setWebhookID:webhookID toActive:NO] executeWithSuccess:^(NSDictionary *response) {
+            finished();
+        } failure:^(NSError *error) {
+            finished();
+        }];
+    }
+    [self.receiver stop];
+    self.receiver = nil;
+    self.active = NO;
+}
+
+-(void)setActive:(BOOL)active {
+    _active = active;
+    if (!active) {
+        [self.freshKeys removeAllObjects];
+    }
+}
+
+-(void)activateWebhook {
+    NSString *webhookID = [[NSUserDefaults standardUserDefaults] stringForKey:kWebhookIDDefaultsKey];
+    if (!webhookID) {
+        [self createWebhook];
+        return;
+    }
+    __weak PushUpdater *weakSelf = self;
+    [[[CIOLiteClient sharedInstance] setWebhookID:webhookID toActive:YES] executeWithSuccess:^(NSDictionary *response) {
+        PushUpdater *strongSelf = weakSelf;
+        strongSelf.active = strongSelf.receiver != nil;
+    } failure:^(NSError *error) {
+        // most likely deleted on the server, make a new one
+        [[NSUserDefaults standardUserDefaults] removeObjectForKey:kWebhookIDDefaultsKey];
+        [weakSelf createWebhook];
+    }];
+}
+
+-(void)createWebhook {
+    NSString *callbackURL = [kWebhookBaseURL stringByAppendingString:CIOWebhookReceiverCallbackPath];
+    NSString *failureURL = [kWebhookBaseURL stringByAppendingString:CIOWebhookReceiverFailurePath];
+    __weak PushUpdater *weakSelf = self;
+    [[[CIOLiteClient sharedInstance] createWebhookWithCallbackURL:callbackURL failureURL:failureURL] executeWithSuccess:^(NSDictionary *response) {
+        PushUpdater *strongSelf = weakSelf;
+        NSString *webhookID = response[@"webhook_id"];
+        if (![webhookID isKindOfClass:[NSString class]]) {
+            return;
+        }
+        [[NSUserDefaults standardUserDefaults] setObject:webhookID forKey:kWebhookIDDefaultsKey];
+        strongSelf.active = strongSelf.receiver != nil;
+    } failure:^(NSError *error) {
+        NSLog(@"could not create webhook: %@", error);
+    }];
+}
+
+-(BOOL)isKeyFresh:(NSString *)key {
+    NSDate *revalidated = key ? self.freshKeys[key] : nil;
+    return self.active && revalidated && -[revalidated timeIntervalSinceNow] < kMaxFreshAge;
+}
+
+-(void)didRevalidateKey:(NSString *)key {
+    if (self.active && key) {
+        self.freshKeys[key] = [NSDate date];
+    }
+}
+
+#pragma mark - Messages
+
+-(void)applyMessage:(NSDictionary *)message {
+    if (![message isKindOfClass:[NSDictionary class]] || ![[message valueForKey:@"message_id"] isKindOfClass:[NSString class]]) {
+        return;
+    }
+    for (NSString *email in [PushUpdater emailsInMessage:message]) {
+        NSString *key = [MessagesViewModel snapshotKeyForEmail:email];
+        // the saved first page, so the list opens with the message without fetching it
+        NSArray *page = [[SnapshotStore sharedStore] objectForKey:key];
+        if ([page isKindOfClass:[NSArray class]] && ![[page valueForKey:@"message_id"] containsObject:message[@"message_id"]]) {
+            [[SnapshotStore sharedStore] setObject:[@[message] arrayByAddingObjectsFromArray:page] forKey:key];
+        }
+        // the binary copy doesn't have it, open from the page above instead
+        [[LaunchSnapshot sharedSnapshot] discardListForKey:key];
+    }
+    [[NSNotificationCenter defaultCenter] postNotificationName:kPushedMessageNotification
+                                                        object:self
+                                                      userInfo:@{kPushedMessageKey: message}];
+}
+
++ (NSArray *)emailsInMessage:(NSDictionary *)message {
+    NSDictionary *addresses = [message valueForKey:@"addresses"];
+    if (![addresses isKindOfClass:[NSDictionary class]]) {
+        return @[];
+    }
+    NSMutableOrderedSet *emails = [NSMutableOrderedSet orderedSet];
+    for (NSString *field in @[@"from", @"to", @"cc", @"bcc"]) {
+        id value = addresses[field];
+        // from is a single address, the others are lists
+        for (NSDictionary *address in [value isKindOfClass:[NSArray class]] ? value : @[value ?: @{}]) {
+            NSString *email = [address isKindOfClass:[NSDictionary class]] ? address[@"email"] : nil;
+            if ([email isKindOfClass:[NSString class]]) {
+                [emails addObject:[email lowercaseString]];
+            }
+        }
+    }
+    return emails.array;
+}
+
+@end
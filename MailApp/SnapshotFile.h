@@ -0,0 +1,38 @@
+//
+//  SnapshotFile.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  A versioned binary file of named sections, mapped into memory instead of read. Sections start on page
+//  boundaries and are handed out as NSData pointing into the mapping, so their pages are only read from
+//  disk when touched. Files are written to a temporary path, synced, and renamed into place, and the directory
+//  is synced so the rename survives a crash. A checksum over the header and one per section catch torn or
+//  corrupted writes.
+
+#import <Foundation/Foundation.h>
+
+@interface SnapshotFile : NSObject
+
+// Names of all sections, checked or not
+@property(nonatomic, readonly) NSArray *sectionNames;
+
+/**
+ *  Writes sections (name -> NSData) to path, replacing any file there only once the new one is complete.
+ *  Slow for large sections, call off the main thread.
+ */
++ (BOOL)writeSections:(NSDictionary *)sections toPath:(NSString *)path;
+
+/**
+ *  Maps the file at path. Returns nil if there is no file, or if it is from another format version or its
+ *  header is damaged.
+ */
+-(instancetype)initWithPath:(NSString *)path;
+
+/**
+ *  Returns the section, checking its checksum the first time it is asked for. Returns nil if there is no such
+ *  section or it is damaged. The data stays valid after the SnapshotFile is released.
+ */
+-(NSData *)sectionNamed:(NSString *)name;
+
+@end
@@ -0,0 +1,252 @@
+//
+//  SnapshotFile.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "SnapshotFile.h"
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+#define kSnapshotMagic          0x504E534D      // "MSNP"
+// Bump whenever the layout of the file or of any section changes
+#define kSnapshotVersion        2
+// The largest page size on iOS devices, so every section can be faulted in on its own
+#define kSectionAlignment       16384
+
+// The file starts with a header, then a table of sections and their names, then the sections
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t namesLength;
+    uint64_t tableChecksum;         // of the section table and the names
+    uint64_t headerChecksum;        // of the fields above
+} SnapshotHeader;
+
+typedef struct {
+    uint32_t nameOffset;            // in the names, which follow the table
+    uint32_t nameLength;
+    uint64_t offset;                // from the start of the file
+    uint64_t length;
+    uint64_t checksum;
+} SnapshotSection;
+
+// Fletcher-64 over 32-bit words, fast enough to check megabytes at launch
+#define kChecksumModulus        0xFFFFFFFFull
+// Words summed before reducing, small enough that neither sum can overflow
+#define kChecksumBlockWords     16384
+
+static uint64_t SnapshotChecksum(const void *bytes, size_t length) {
+    const uint8_t *data = bytes;
+    uint64_t sum1 = 0;
+    uint64_t sum2 = 0;
+    size_t words = length / sizeof(uint32_t);
+    for (size_t i = 0; i < words; i++) {
+        uint32_t word;
+        memcpy(&word, data + i * sizeof(word), sizeof(word));
+        sum1 += word;
+        sum2 += sum1;
+        if (i % kChecksumBlockWords == kChecksumBlockWords - 1) {
+            sum1 %= kChecksumModulus;
+            sum2 %= kChecksumModulus;
+        }
+    }
+    uint32_t tail = 0;
+    memcpy(&tail, data + words * sizeof(uint32_t), length % sizeof(uint32_t));
+    sum1 = (sum1 + tail) % kChecksumModulus;
+    sum2 = (sum2 + sum1) % kChecksumModulus;
+    return (sum2 << 32) | sum1;
+}
+
+static uint64_t SnapshotAligned(uint64_t offset) {
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+static BOOL SnapshotWriteAll(int fd, const void *bytes, size_t length, off_t offset) {
+    const uint8_t *data = bytes;
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if (written <= 0) {
+            return NO;
+        }
+        data += written;
+        length -= (size_t)written;
+        offset += written;
+    }
+    return YES;
+}
+
+@interface SnapshotFile ()
+
+@property(nonatomic) const uint8_t *bytes;
+@property(nonatomic) size_t length;
+@property(nonatomic, readwrite) NSArray *sectionNames;
+@property(nonatomic, strong) NSDictionary *sectionIndexes;      // name -> index in the section table
+@property(nonatomic, strong) NSMutableDictionary *checkedSections;     // name -> @YES if intact, @NO if damaged
+
+@end
+
+@implementation SnapshotFile
+
++ (BOOL)writeSections:(NSDictionary *)sections toPath:(NSString *)path {
+    NSArray *names = [sections.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    NSMutableData *table = [NSMutableData dataWithLength:names.count * sizeof(SnapshotSection)];
+    NSMutableData *nameBytes = [NSMutableData data];
+    SnapshotSection *entries = table.mutableBytes;
+    uint64_t offset = SnapshotAligned(sizeof(SnapshotHeader) + table.length +
+                                      [[names componentsJoinedByString:@""] lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+    for (NSUInteger i = 0; i < names.count; i++) {
+        NSData *name = [names[i] dataUsingEncoding:NSUTF8StringEncoding];
+        NSData *section = sections[names[i]];
+        entries[i].nameOffset = (uint32_t)nameBytes.length;
+        entries[i].nameLength = (uint32_t)name.length;
+        entries[i].offset = offset;
+        entries[i].length = section.length;
+        entries[i].checksum = SnapshotChecksum(section.bytes, section.length);
+        [nameBytes appendData:name];
+        offset = SnapshotAligned(offset + section.length);
+    }
+    [table appendData:nameBytes];
+    // appending may have moved the table
+    entries = table.mutableBytes;
+
+    SnapshotHeader header = {0};
+    header.magic = kSnapshotMagic;
+    header.version = kSnapshotVersion;
+    header.sectionCount = (uint32_t)names.count;
+    header.namesLength = (uint32_t)nameBytes.length;
+    header.tableChecksum = SnapshotChecksum(table.bytes, table.length);
+    header.headerChecksum = SnapshotChecksum(&header, offsetof(SnapshotHeader, headerChecksum));
+
+    NSString *temporaryPath = [path stringByAppendingPathExtension:@"tmp"];
+    int fd = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NO;
+    }
+    BOOL written = SnapshotWriteAll(fd, &header, sizeof(header), 0) &&
+                   SnapshotWriteAll(fd, table.bytes, table.length, sizeof(header));
+    for (NSUInteger i = 0; i < names.count && written; i++) {
+        NSData *section = sections[names[i]];
+        written = SnapshotWriteAll(fd, section.bytes, section.length, (off_t)entries[i].offset);
+    }
+    written = written && ftruncate(fd, (off_t)offset) == 0 && fsync(fd) == 0;
+    close(fd);
+    if (!written || rename(temporaryPath.fileSystemRepresentation, path.fileSystemRepresentation) != 0) {
+        unlink(temporaryPath.fileSystemRepresentation);
+        return NO;
+    }
+    // the rename is only durable once the directory holding the file is synced too
+    int directory = open(path.stringByDeletingLastPathComponent.fileSystemRepresentation, O_RDONLY);
+    if (directory < 0) {
+        return NO;
+    }
+    BOOL synced = fsync(directory) == 0;
+    close(directory);
+    return synced;
+}
+
+-(instancetype)initWithPath:(NSString *)path {
+    if (!(self = [super init])) {
+        return nil;
+    }
+    int fd = open(path.fileSystemRepresentation, O_RDONLY);
+    if (fd < 0) {
+        return nil;
+    }
+    struct stat status;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && (size_t)status.st_size >= sizeof(SnapshotHeader)) {
+        mapping = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // the mapping keeps the file open
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return nil;
+    }
+    _bytes = mapping;
+    _length = (size_t)status.st_size;
+    _checkedSections = [NSMutableDictionary dictionary];
+    if (![self readSectionTable]) {
+        return nil;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_bytes) {
+        munmap((void *)_bytes, _length);
+    }
+}
+
+-(BOOL)readSectionTable {
+    SnapshotHeader header;
+    memcpy(&header, self.bytes, sizeof(header));
+    if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion ||
+        header.headerChecksum != SnapshotChecksum(&header, offsetof(SnapshotHeader, headerChecksum))) {
+        return NO;
+    }
+    size_t tableLength = header.sectionCount * sizeof(SnapshotSection) + header.namesLength;
+    if (sizeof(header) + tableLength > self.length ||
+        header.tableChecksum != SnapshotChecksum(self.bytes + sizeof(header), tableLength)) {
+        return NO;
+    }
+
+    const uint8_t *names = self.bytes + sizeof(header) + header.sectionCount * sizeof(SnapshotSection);
+    NSMutableArray *sectionNames = [NSMutableArray arrayWithCapacity:header.sectionCount];
+    NSMutableDictionary *sectionIndexes = [NSMutableDictionary dictionaryWithCapacity:header.sectionCount];
+    for (uint32_t i = 0; i < header.sectionCount; i++) {
+        SnapshotSection section = [self sectionAtIndex:i];
+        if (section.offset + section.length > self.length ||
+            (uint64_t)section.nameOffset + section.nameLength > header.namesLength) {
+            return NO;
+        }
+        NSString *name = [[NSString alloc] initWithBytes:names + section.nameOffset length:section.nameLength encoding:NSUTF8StringEncoding];
+        if (!name) {
+            return NO;
+        }
+        [sectionNames addObject:name];
+        sectionIndexes[name] = @(i);
+    }
+    self.sectionNames = sectionNames;
+    self.sectionIndexes = sectionIndexes;
+    return YES;
+}
+
+-(SnapshotSection)sectionAtIndex:(NSUInteger)index {
+    SnapshotSection section;
+    memcpy(&section, self.bytes + sizeof(SnapshotHeader) + index * sizeof(SnapshotSection), sizeof(section));
+    return section;
+}
+
+-(NSData *)sectionNamed:(NSString *)name {
+    NSNumber *index = self.sectionIndexes[name];
+    if (!index) {
+        return nil;
+    }
+    SnapshotSection section = [self sectionAtIndex:index.unsignedIntegerValue];
+    const uint8_t *bytes = self.bytes + section.offset;
+    @synchronized(self) {
+        NSNumber *intact = self.checkedSections[name];
+        if (!intact) {
+            intact = @(SnapshotChecksum(bytes, (size_t)section.length) == section.checksum);
+            self.checkedSections[name] = intact;
+            if (!intact.boolValue) {
+                NSLog(@"snapshot section %@ is damaged", name);
+            }
+        }
+        if (!intact.boolValue) {
+            return nil;
+        }
+    }
+    // holds on to the file, and so its mapping, until the data goes away
+    SnapshotFile *file = self;
+    return [[NSData alloc] initWithBytesNoCopy:(void *)bytes length:(NSUInteger)section.length deallocator:^(void *unused, NSUInteger length) {
+        (void)file;
+    }];
+}
+
+@end
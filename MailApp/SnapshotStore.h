@@ -0,0 +1,28 @@
+//
+//  SnapshotStore.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Keeps the last API response behind each screen, in memory and in the Caches directory, so a screen
+//  can paint it in its first frame while fresh data loads.
+
+#import <Foundation/Foundation.h>
+
+@interface SnapshotStore : NSObject
+
++ (instancetype)sharedStore;
+
+/**
+ *  Returns the snapshot saved under key, reading it from disk if it is not in memory. Call from the main thread.
+ */
+-(id)objectForKey:(NSString *)key;
+
+/**
+ *  Saves a JSON object (as returned by the API) under key. It is written to disk in the background.
+ */
+-(void)setObject:(id)object forKey:(NSString *)key;
+
+-(void)removeObjectForKey:(NSString *)key;
+
+@end
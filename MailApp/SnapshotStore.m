@@ -0,0 +1,91 @@
+//
+//  SnapshotStore.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "SnapshotStore.h"
+#import "CacheManager.h"
+
+#define kSnapshotDirectoryName      @"Snapshots"
+
+@interface SnapshotStore ()
+
+// Snapshots are already on disk, so they are dropped rather than spilled
+@property(nonatomic, strong) ManagedCache *memoryCache;
+@property(nonatomic, strong) NSString *directoryPath;
+// Serial, so a write never races a later write or remove of the same key
+@property(nonatomic, strong) dispatch_queue_t ioQueue;
+
+@end
+
+@implementation SnapshotStore
+
++ (instancetype)sharedStore {
+    static SnapshotStore *store = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        store = [[SnapshotStore alloc] init];
+    });
+    return store;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _memoryCache = [[CacheManager sharedManager] cacheWithName:@"snapshots" priority:CachePriorityResponses spillsToDisk:NO];
+        _ioQueue = dispatch_queue_create("com.katyho.MailApp.snapshots", DISPATCH_QUEUE_SERIAL);
+        NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+        _directoryPath = [caches stringByAppendingPathComponent:kSnapshotDirectoryName];
+        [[NSFileManager defaultManager] createDirectoryAtPath:_directoryPath withIntermediateDirectories:YES attributes:nil error:nil];
+    }
+    return self;
+}
+
+-(NSString *)pathForKey:(NSString *)key {
+    NSString *fileName = [key stringByAddingPercentEncodingWithAllowedCharacters:[NSCharacterSet alphanumericCharacterSet]];
+    return [[self.directoryPath stringByAppendingPathComponent:fileName] stringByAppendingPathExtension:@"json"];
+}
+
+-(id)objectForKey:(NSString *)key {
+    id object = [self.memoryCache objectForKey:key];
+    if (object) {
+        return object;
+    }
+    // snapshots are a single page of results, small enough to read in the first frame
+    __block NSData *data = nil;
+    dispatch_sync(self.ioQueue, ^{
+        data = [NSData dataWithContentsOfFile:[self pathForKey:key]];
+    });
+    if (!data) {
+        return nil;
+    }
+    object = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    if (object) {
+        [self.memoryCache setObject:object forKey:key cost:data.length];
+    }
+    return object;
+}
+
+-(void)setObject:(id)object forKey:(NSString *)key {
+    if (!object) {
+        [self removeObjectForKey:key];
+        return;
+    }
+    [self.memoryCache setObject:object forKey:key cost:[CacheManager costOfJSONObject:object]];
+    NSString *path = [self pathForKey:key];
+    dispatch_async(self.ioQueue, ^{
+        NSData *data = [NSJSONSerialization dataWithJSONObject:object options:0 error:nil];
+        [data writeToFile:path atomically:YES];
+    });
+}
+
+-(void)removeObjectForKey:(NSString *)key {
+    [self.memoryCache removeObjectForKey:key];
+    NSString *path = [self pathForKey:key];
+    dispatch_async(self.ioQueue, ^{
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    });
+}
+
+@end
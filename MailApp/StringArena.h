@@ -0,0 +1,63 @@
+//
+//  StringArena.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+//  Interned UTF-8 strings packed into one growing buffer and addressed by offset. Each distinct string is
+//  stored once, so two refs from the same arena are equal exactly when their strings are. Not thread safe,
+//  InternTable guards the arenas of its shards.
+
+#import <Foundation/Foundation.h>
+
+// Offset of a string in its arena
+typedef uint32_t StringRef;
+
+// Stands for nil, and for anything that isn't a string
+extern const StringRef kNilStringRef;
+
+@interface StringArena : NSObject
+
+// Bytes used by strings and the intern table
+@property(nonatomic, readonly) NSUInteger byteCount;
+@property(nonatomic, readonly) NSUInteger stringCount;
+
+/**
+ *  An arena over bytes and table saved from snapshotBytes and snapshotTable, e.g. mapped from a file. They
+ *  are read in place; new strings go into memory of the arena's own, and table is copied on the first one.
+ *  Refs are the same as in the saved arena.
+ */
+-(instancetype)initWithSnapshotBytes:(NSData *)bytes table:(NSData *)table stringCount:(NSUInteger)stringCount;
+
+/**
+ *  Returns the ref of string, adding it if it isn't in the arena yet. Returns kNilStringRef for nil and for
+ *  objects other than strings, e.g. NSNull from JSON.
+ */
+-(StringRef)internString:(id)string;
+
+/**
+ *  Like internString:, but returns kNilStringRef instead of adding string if its ref would be past maximumRef.
+ */
+-(StringRef)internString:(id)string maximumRef:(StringRef)maximumRef;
+
+/**
+ *  Returns the ref of string without adding it, or kNilStringRef if it isn't in the arena.
+ */
+-(StringRef)refForString:(NSString *)string;
+
+/**
+ *  Returns the ref here of the string at ref in arena, adding it if it isn't in this arena yet. The bytes are
+ *  copied over without making an NSString. Returns kNilStringRef for kNilStringRef.
+ */
+-(StringRef)internRef:(StringRef)ref ofArena:(StringArena *)arena;
+
+/**
+ *  Creates a new NSString for ref, or returns nil for kNilStringRef.
+ */
+-(NSString *)stringForRef:(StringRef)ref;
+
+// Copies of the strings and of the intern table, to save and restore with initWithSnapshotBytes:table:stringCount:
+-(NSData *)snapshotBytes;
+-(NSData *)snapshotTable;
+
+@end
@@ -0,0 +1,233 @@
+//
+//  StringArena.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "StringArena.h"
+
+const StringRef kNilStringRef = 0;
+
+#define kInitialTableCapacity       256
+// Strings up to this long are converted to UTF-8 on the stack
+#define kStackBufferLength          256
+
+// Each string is stored as its byte length followed by its UTF-8 bytes, with no terminator
+typedef uint32_t StringLength;
+
+@interface StringArena ()
+
+// Strings restored from a snapshot, read in place. Refs below their length point into them.
+@property(nonatomic, strong) NSData *restoredBytes;
+// Strings added since, at refs from the length of restoredBytes on
+@property(nonatomic, strong) NSMutableData *bytes;
+// Open addressing table of refs, kNilStringRef marks an empty slot
+@property(nonatomic) StringRef *table;
+@property(nonatomic) NSUInteger tableCapacity;     // a power of 2
+// Set while table points into a restored snapshot, which can't be written to
+@property(nonatomic, strong) NSData *restoredTable;
+@property(nonatomic, readwrite) NSUInteger stringCount;
+
+@end
+
+// FNV-1a
+static NSUInteger StringArenaHash(const uint8_t *bytes, NSUInteger length) {
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Calls block with the UTF-8 bytes of string, without allocating for short strings
+static void StringArenaWithUTF8(NSString *string, void (^block)(const uint8_t *bytes, NSUInteger length)) {
+    uint8_t buffer[kStackBufferLength];
+    NSUInteger length = 0;
+    NSRange range = NSMakeRange(0, string.length);
+    NSRange remaining;
+    [string getBytes:buffer maxLength:sizeof(buffer) usedLength:&length encoding:NSUTF8StringEncoding options:0 range:range remainingRange:&remaining];
+    if (remaining.length == 0) {
+        block(buffer, length);
+        return;
+    }
+    NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    block(data.bytes, data.length);
+}
+
+@implementation StringArena
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        // offset 0 is never a string, so it can stand for nil
+        _bytes = [NSMutableData dataWithLength:1];
+        _tableCapacity = kInitialTableCapacity;
+        _table = calloc(_tableCapacity, sizeof(StringRef));
+    }
+    return self;
+}
+
+-(instancetype)initWithSnapshotBytes:(NSData *)bytes table:(NSData *)table stringCount:(NSUInteger)stringCount {
+    NSUInteger capacity = table.length / sizeof(StringRef);
+    // the capacity must be a power of 2, and the strings must start with the nil byte
+    if (bytes.length == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0 || stringCount * 2 > capacity) {
+        return nil;
+    }
+    if ((self = [super init])) {
+        _restoredBytes = bytes;
+        _bytes = [NSMutableData data];
+        _restoredTable = table;
+        _table = (StringRef *)table.bytes;
+        _tableCapacity = capacity;
+        _stringCount = stringCount;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (!_restoredTable) {
+        free(_table);
+    }
+}
+
+-(NSUInteger)byteCount {
+    return self.restoredBytes.length + self.bytes.length + self.tableCapacity * sizeof(StringRef);
+}
+
+-(NSData *)snapshotBytes {
+    NSMutableData *bytes = [NSMutableData dataWithCapacity:self.restoredBytes.length + self.bytes.length];
+    [bytes appendData:self.restoredBytes ?: [NSData data]];
+    [bytes appendData:self.bytes];
+    return bytes;
+}
+
+-(NSData *)snapshotTable {
+    return [NSData dataWithBytes:self.table length:self.tableCapacity * sizeof(StringRef)];
+}
+
+-(const uint8_t *)bytesForRef:(StringRef)ref length:(NSUInteger *)length {
+    NSUInteger restoredLength = self.restoredBytes.length;
+    const uint8_t *base = ref < restoredLength ? (const uint8_t *)self.restoredBytes.bytes + ref
+                                               : (const uint8_t *)self.bytes.bytes + (ref - restoredLength);
+    StringLength stored;
+    memcpy(&stored, base, sizeof(stored));
+    *length = stored;
+    return base + sizeof(stored);
+}
+
+// Returns the slot holding the string, or the empty slot it would go in
+-(NSUInteger)slotForBytes:(const uint8_t *)bytes length:(NSUInteger)length hash:(NSUInteger)hash {
+    NSUInteger mask = self.tableCapacity - 1;
+    for (NSUInteger slot = hash & mask;; slot = (slot + 1) & mask) {
+        StringRef ref = self.table[slot];
+        if (ref == kNilStringRef) {
+            return slot;
+        }
+        NSUInteger storedLength;
+        const uint8_t *stored = [self bytesForRef:ref length:&storedLength];
+        if (storedLength == length && memcmp(stored, bytes, length) == 0) {
+            return slot;
+        }
+    }
+}
+
+-(void)growTable {
+    StringRef *oldTable = self.table;
+    NSUInteger oldCapacity = self.tableCapacity;
+    self.tableCapacity = oldCapacity * 2;
+    self.table = calloc(self.tableCapacity, sizeof(StringRef));
+    for (NSUInteger i = 0; i < oldCapacity; i++) {
+        StringRef ref = oldTable[i];
+        if (ref == kNilStringRef) {
+            continue;
+        }
+        NSUInteger length;
+        const uint8_t *bytes = [self bytesForRef:ref length:&length];
+        self.table[[self slotForBytes:bytes length:length hash:StringArenaHash(bytes, length)]] = ref;
+    }
+    if (self.restoredTable) {
+        self.restoredTable = nil;
+    } else {
+        free(oldTable);
+    }
+}
+
+// A restored table is read only, copy it before the first change
+-(void)makeTableWritable {
+    if (!self.restoredTable) {
+        return;
+    }
+    StringRef *table = malloc(self.tableCapacity * sizeof(StringRef));
+    memcpy(table, self.table, self.tableCapacity * sizeof(StringRef));
+    self.table = table;
+    self.restoredTable = nil;
+}
+
+-(StringRef)internString:(id)string {
+    return [self internString:string maximumRef:UINT32_MAX];
+}
+
+-(StringRef)internString:(id)string maximumRef:(StringRef)maximumRef {
+    if (![string isKindOfClass:[NSString class]]) {
+        return kNilStringRef;
+    }
+    __block StringRef ref = kNilStringRef;
+    StringArenaWithUTF8(string, ^(const uint8_t *bytes, NSUInteger length) {
+        ref = [self internBytes:bytes length:length maximumRef:maximumRef];
+    });
+    return ref;
+}
+
+-(StringRef)internRef:(StringRef)ref ofArena:(StringArena *)arena {
+    if (ref == kNilStringRef) {
+        return kNilStringRef;
+    }
+    NSUInteger length;
+    const uint8_t *bytes = [arena bytesForRef:ref length:&length];
+    return [self internBytes:bytes length:length maximumRef:UINT32_MAX];
+}
+
+-(StringRef)internBytes:(const uint8_t *)bytes length:(NSUInteger)length maximumRef:(StringRef)maximumRef {
+    NSUInteger slot = [self slotForBytes:bytes length:length hash:StringArenaHash(bytes, length)];
+    if (self.table[slot] != kNilStringRef) {
+        return self.table[slot];
+    }
+    NSUInteger offset = self.restoredBytes.length + self.bytes.length;
+    if (offset > maximumRef) {
+        return kNilStringRef;
+    }
+    [self makeTableWritable];
+    StringRef ref = (StringRef)offset;
+    StringLength storedLength = (StringLength)length;
+    [self.bytes appendBytes:&storedLength length:sizeof(storedLength)];
+    [self.bytes appendBytes:bytes length:length];
+    self.table[slot] = ref;
+    self.stringCount++;
+    // keep probes short
+    if (self.stringCount * 2 > self.tableCapacity) {
+        [self growTable];
+    }
+    return ref;
+}
+
+-(StringRef)refForString:(NSString *)string {
+    if (![string isKindOfClass:[NSString class]]) {
+        return kNilStringRef;
+    }
+    __block StringRef ref = kNilStringRef;
+    StringArenaWithUTF8(string, ^(const uint8_t *bytes, NSUInteger length) {
+        ref = self.table[[self slotForBytes:bytes length:length hash:StringArenaHash(bytes, length)]];
+    });
+    return ref;
+}
+
+-(NSString *)stringForRef:(StringRef)ref {
+    if (ref == kNilStringRef) {
+        return nil;
+    }
+    NSUInteger length;
+    const uint8_t *bytes = [self bytesForRef:ref length:&length];
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+}
+
+@end
@@ -0,0 +1,17 @@
+//
+//  UITableView+ListChanges.h
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+@class ListChanges;
+
+@interface UITableView (ListChanges)
+
+// Applies changes to the rows of section in one batch, or reloads the table if they can't be expressed as one
+- (void)applyListChanges:(ListChanges *)changes inSection:(NSInteger)section;
+
+@end
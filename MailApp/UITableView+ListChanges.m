@@ -0,0 +1,40 @@
+//
+//  UITableView+ListChanges.m
+//  MailApp
+//
+//  Copyright © 2015 KatyHo. All rights reserved.
+//
+
+#import "UITableView+ListChanges.h"
+#import "ListChanges.h"
+
+@implementation UITableView (ListChanges)
+
++ (NSArray *)indexPathsForIndexes:(NSIndexSet *)indexes inSection:(NSInteger)section {
+    NSMutableArray *indexPaths = [NSMutableArray arrayWithCapacity:indexes.count];
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        [indexPaths addObject:[NSIndexPath indexPathForRow:(NSInteger)index inSection:section]];
+    }];
+    return indexPaths;
+}
+
+- (void)applyListChanges:(ListChanges *)changes inSection:(NSInteger)section {
+    if (!self.window) {
+        [self reloadData];
+        return;
+    }
+    [self beginUpdates];
+    [self deleteRowsAtIndexPaths:[UITableView indexPathsForIndexes:changes.deletedIndexes inSection:section]
+                withRowAnimation:UITableViewRowAnimationFade];
+    [self insertRowsAtIndexPaths:[UITableView indexPathsForIndexes:changes.insertedIndexes inSection:section]
+                withRowAnimation:UITableViewRowAnimationFade];
+    [self reloadRowsAtIndexPaths:[UITableView indexPathsForIndexes:changes.reloadedIndexes inSection:section]
+                withRowAnimation:UITableViewRowAnimationNone];
+    [changes enumerateMovesUsingBlock:^(NSUInteger from, NSUInteger to) {
+        [self moveRowAtIndexPath:[NSIndexPath indexPathForRow:(NSInteger)from inSection:section]
+                     toIndexPath:[NSIndexPath indexPathForRow:(NSInteger)to inSection:section]];
+    }];
+    [self endUpdates];
+}
+
+@end
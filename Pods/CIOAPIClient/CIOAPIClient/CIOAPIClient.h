@@ -10,4 +10,10 @@
 #import "CIOAPISession.h"
 #import "CIOSourceRequests.h"
 #import "CIOV2Client.h"
-#import "CIOLiteClient.h"
\ No newline at end of file
+#import "CIOLiteClient.h"
+#import "CIOSigningPipeline.h"
+#import "CIOClientPool.h"
+#import "CIOAdaptivePager.h"
+#import "CIOWebhookReceiver.h"
+#import "CIOWebhookSender.h"
+#import "CIOLiteFolderSync.h"
\ No newline at end of file
@@ -8,15 +8,35 @@
 
 #import "CIOAPIClientHeader.h"
 
-#import <SSKeychain/SSKeychain.h>
+#import "CIOCredentialStore.h"
 #import "TDOAuth.h"
+#import "TDOAuthSigner.h"
 #import "CIOAPISession.h"
+#import "CIOClientPool.h"
 
 // Keychain keys
 static NSString *const kCIOKeyChainServicePrefix = @"Context-IO-";
-static NSString *const kCIOAccountIDKeyChainKey = @"kCIOAccountID";
-static NSString *const kCIOTokenKeyChainKey = @"kCIOToken";
-static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
+
+static id<CIOCredentialStore> CIODefaultCredentialStore = nil;
+
+// Stands in for the account ID in paths built while saved credentials are still being read, replaced when signing
+static NSString *const CIOAccountIDPlaceholder = @"{account_id}";
+
+// A request on the wire and the completion blocks of every caller waiting for it, several for a single-flight GET.
+// Guarded by @synchronized on the client's inFlightRequests.
+@interface CIOInFlightRequest : NSObject
+
+@property (nonatomic) NSMutableArray *completions;
+// The running attempt, replaced when a clock skew retry takes over
+@property (nullable, nonatomic) id<CIOTransportTask> task;
+// Set once every caller has cancelled
+@property (nonatomic) BOOL cancelled;
+
+@end
+
+@implementation CIOInFlightRequest
+
+@end
 
 @interface CIOAPIClient () {
 
@@ -28,11 +48,19 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
 
     NSString *_tmpOAuthToken;
     NSString *_tmpOAuthTokenSecret;
+
+    // Non-nil while saved credentials are loading in the background, wait on it before touching the ivars above. The
+    // ivars above and _isAuthorized are only read and written under @synchronized(self), requests are signed on
+    // other threads.
+    dispatch_group_t _credentialsLoading;
 }
 
 @property (nonatomic) NSURL *baseURL;
 @property (nonatomic) NSString *basePath;
 @property (nonatomic) CIOAPISession *session;
+@property (nonatomic) id<CIOCredentialStore> credentialStore;
+// GETs on the wire, fingerprint to their CIOInFlightRequest. Guarded by @synchronized on itself.
+@property (nonatomic) NSMutableDictionary *inFlightRequests;
 
 - (void)loadCredentials;
 - (void)saveCredentials;
@@ -65,10 +93,11 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
     self.basePath = [self.baseURL path];
 
     self.timeoutInterval = 60;
+    self.inFlightRequests = [NSMutableDictionary dictionary];
 
     _isAuthorized = NO;
 
-    [self loadCredentials];
+    self.credentialStore = [[self class] defaultCredentialStore];
 
     if (accountID && token && tokenSecret) {
 
@@ -77,11 +106,32 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
         _accountID = accountID;
 
         _isAuthorized = YES;
+    } else {
+        [self loadCredentials];
     }
 
     return self;
 }
 
++ (id<CIOCredentialStore>)defaultCredentialStore {
+    @synchronized(self) {
+        if (CIODefaultCredentialStore == nil) {
+#if defined(__APPLE__)
+            CIODefaultCredentialStore = [CIOKeychainCredentialStore new];
+#else
+            CIODefaultCredentialStore = [CIOFileCredentialStore new];
+#endif
+        }
+        return CIODefaultCredentialStore;
+    }
+}
+
++ (void)setDefaultCredentialStore:(id<CIOCredentialStore>)credentialStore {
+    @synchronized(self) {
+        CIODefaultCredentialStore = credentialStore;
+    }
+}
+
 - (NSString * __nonnull)keychainPrefix {
     return kCIOKeyChainServicePrefix;
 }
@@ -93,7 +143,7 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
                                             params:(NSDictionary *)params {
 
     NSString *connectTokenPath = nil;
-    if (_isAuthorized) {
+    if (self.isAuthorized) {
         connectTokenPath = [[self accountPath] stringByAppendingPathComponent:@"connect_tokens"];
     } else {
         connectTokenPath = @"connect_tokens";
@@ -125,9 +175,11 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
 }
 
 - (NSURL *)redirectURLFromResponse:(NSDictionary *)responseDict {
-    if (_isAuthorized == NO) {
-        _tmpOAuthToken = responseDict[@"access_token"];
-        _tmpOAuthTokenSecret = responseDict[@"access_token_secret"];
+    if (self.isAuthorized == NO) {
+        @synchronized(self) {
+            _tmpOAuthToken = responseDict[@"access_token"];
+            _tmpOAuthTokenSecret = responseDict[@"access_token_secret"];
+        }
     }
 
     return [NSURL URLWithString:responseDict[@"browser_redirect_url"]];
@@ -150,11 +202,14 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
         (OAuthTokenSecret && ![OAuthTokenSecret isEqual:[NSNull null]]) &&
         (accountID && ![accountID isEqual:[NSNull null]])) {
 
-        _OAuthToken = OAuthToken;
-        _OAuthTokenSecret = OAuthTokenSecret;
-        _accountID = accountID;
+        [self waitForCredentials];
+        @synchronized(self) {
+            _OAuthToken = OAuthToken;
+            _OAuthTokenSecret = OAuthTokenSecret;
+            _accountID = accountID;
 
-        _isAuthorized = YES;
+            _isAuthorized = YES;
+        }
         if (saveCredentials) {
             [self saveCredentials];
         }
@@ -164,36 +219,96 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
     }
 }
 
+- (NSString *)credentialServiceName {
+    return [NSString stringWithFormat:@"%@-%@", [self keychainPrefix], _OAuthConsumerKey];
+}
+
+// Reads the saved credentials off the calling thread. Requests wait for them in -afterCredentialsLoad:, only the
+// synchronous getters wait in -waitForCredentials.
 - (void)loadCredentials {
 
-    NSString *serviceName = [NSString stringWithFormat:@"%@-%@", [self keychainPrefix], _OAuthConsumerKey];
+    id<CIOCredentialStore> store = self.credentialStore;
+    NSString *serviceName = [self credentialServiceName];
+    dispatch_group_t group = dispatch_group_create();
+    _credentialsLoading = group;
+
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+        CIOCredentials *credentials = [store credentialsForService:serviceName];
+        if (credentials) {
+            @synchronized(self) {
+                self->_accountID = credentials.accountID;
+                self->_OAuthToken = credentials.token;
+                self->_OAuthTokenSecret = credentials.tokenSecret;
+
+                self->_isAuthorized = YES;
+            }
+        }
+    });
+}
+
+- (void)waitForCredentials {
+    dispatch_group_t group = _credentialsLoading;
+    if (group) {
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    }
+}
 
-    NSString *accountID = [SSKeychain passwordForService:serviceName account:kCIOAccountIDKeyChainKey];
-    NSString *OAuthToken = [SSKeychain passwordForService:serviceName account:kCIOTokenKeyChainKey];
-    NSString *OAuthTokenSecret = [SSKeychain passwordForService:serviceName account:kCIOTokenSecretKeyChainKey];
+- (BOOL)credentialsLoaded {
+    dispatch_group_t group = _credentialsLoading;
+    return group == nil || dispatch_group_wait(group, DISPATCH_TIME_NOW) == 0;
+}
 
-    if (accountID && OAuthToken && OAuthTokenSecret) {
+// Runs block right away if the saved credentials are loaded, otherwise on a global queue once they are
+- (void)afterCredentialsLoad:(dispatch_block_t)block {
+    if ([self credentialsLoaded]) {
+        block();
+        return;
+    }
+    dispatch_group_notify(_credentialsLoading, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), block);
+}
 
-        _accountID = accountID;
-        _OAuthToken = OAuthToken;
-        _OAuthTokenSecret = OAuthTokenSecret;
+- (void)loadCredentialsWithCompletion:(void (^)(BOOL))completion {
+    [self afterCredentialsLoad:^{
+        BOOL authorized = self.isAuthorized;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(authorized);
+        });
+    }];
+}
 
-        _isAuthorized = YES;
+- (BOOL)isAuthorized {
+    [self waitForCredentials];
+    @synchronized(self) {
+        return _isAuthorized;
     }
 }
 
-- (void)saveCredentials {
+- (NSString *)accountID {
+    [self waitForCredentials];
+    @synchronized(self) {
+        return _accountID;
+    }
+}
 
-    if (_accountID && _OAuthToken && _OAuthTokenSecret) {
+// The token and secret to sign with, nil for both unless authorized
+- (void)getToken:(NSString **)token tokenSecret:(NSString **)tokenSecret {
+    [self waitForCredentials];
+    @synchronized(self) {
+        *token = _isAuthorized ? _OAuthToken : nil;
+        *tokenSecret = _isAuthorized ? _OAuthTokenSecret : nil;
+    }
+}
 
-        NSString *serviceName = [NSString stringWithFormat:@"%@-%@", [self keychainPrefix], _OAuthConsumerKey];
-        BOOL accountIDSaved =
-            [SSKeychain setPassword:_accountID forService:serviceName account:kCIOAccountIDKeyChainKey];
-        BOOL tokenSaved = [SSKeychain setPassword:_OAuthToken forService:serviceName account:kCIOTokenKeyChainKey];
-        BOOL secretSaved =
-            [SSKeychain setPassword:_OAuthTokenSecret forService:serviceName account:kCIOTokenSecretKeyChainKey];
+- (void)saveCredentials {
 
-        if (accountIDSaved && tokenSaved && secretSaved) {
+    CIOCredentials *credentials = nil;
+    @synchronized(self) {
+        if (_accountID && _OAuthToken && _OAuthTokenSecret) {
+            credentials = [[CIOCredentials alloc] initWithAccountID:_accountID token:_OAuthToken tokenSecret:_OAuthTokenSecret];
+        }
+    }
+    if (credentials && [self.credentialStore saveCredentials:credentials forService:[self credentialServiceName]]) {
+        @synchronized(self) {
             _isAuthorized = YES;
         }
     }
@@ -201,13 +316,14 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
 
 - (void)clearCredentials {
 
-    _isAuthorized = NO;
-    _accountID = nil;
+    [self waitForCredentials];
+    @synchronized(self) {
+        _isAuthorized = NO;
+        _accountID = nil;
+    }
 
-    NSString *serviceName = [NSString stringWithFormat:@"%@-%@", [self keychainPrefix], _OAuthConsumerKey];
-    [SSKeychain deletePasswordForService:serviceName account:kCIOAccountIDKeyChainKey];
-    [SSKeychain deletePasswordForService:serviceName account:kCIOTokenKeyChainKey];
-    [SSKeychain deletePasswordForService:serviceName account:kCIOTokenSecretKeyChainKey];
+    [self.credentialStore deleteCredentialsForService:[self credentialServiceName]];
+    [TDOAuthSigner purgeCache];
 }
 
 #pragma mark -
@@ -219,6 +335,9 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
                            tokenSecret:(NSString *)tokenSecret
                            contentType:(TDOAuthContentType)contentType {
 
+    if ([path rangeOfString:CIOAccountIDPlaceholder].location != NSNotFound) {
+        path = [path stringByReplacingOccurrencesOfString:CIOAccountIDPlaceholder withString:self.accountID ?: @""];
+    }
     NSMutableURLRequest *signedRequest = [[TDOAuth URLRequestForPath:[self.basePath stringByAppendingPathComponent:path]
                                                           parameters:params
                                                                 host:self.baseURL.host
@@ -238,29 +357,38 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
 }
 
 - (NSString *)accountPath {
-    return [@"accounts" stringByAppendingPathComponent:self.accountID];
+    return [@"accounts" stringByAppendingPathComponent:self.accountIDPathComponent];
+}
+
+- (NSString *)accountIDPathComponent {
+    return [self credentialsLoaded] ? self.accountID : CIOAccountIDPlaceholder;
 }
 
 #pragma mark -
 
 - (NSURLRequest *)requestForPath:(NSString *)path method:(NSString *)method params:(NSDictionary *)params {
-    NSString *token = self.isAuthorized ? _OAuthToken : nil;
-    NSString *tokenSecret = self.isAuthorized ? _OAuthTokenSecret : nil;
+    NSString *token, *tokenSecret;
+    [self getToken:&token tokenSecret:&tokenSecret];
     return [self signedRequestForPath:path method:method parameters:params token:token tokenSecret:tokenSecret contentType:TDOAuthContentTypeUrlEncodedForm];
 }
 
 - (NSURLRequest *)requestForPath:(NSString *)path method:(NSString *)method body:(id)body {
     // TDOAuth does not support JSON encoded body for GETs
     NSParameterAssert(![method isEqualToString:@"GET"]);
-    NSString *token = self.isAuthorized ? _OAuthToken : nil;
-    NSString *tokenSecret = self.isAuthorized ? _OAuthTokenSecret : nil;
+    NSString *token, *tokenSecret;
+    [self getToken:&token tokenSecret:&tokenSecret];
     return [self signedRequestForPath:path method:method parameters:body token:token tokenSecret:tokenSecret contentType:TDOAuthContentTypeJsonObject];
 }
 
 - (NSURLRequest *)requestForCIORequest:(CIORequest *)request {
     if ([request isKindOfClass:[CIOConnectTokenRequest class]]) {
         // This is a special case due to the use of the temporary token/secret during auth
-        return [self signedRequestForPath:request.path method:request.method parameters:request.parameters token:_tmpOAuthToken tokenSecret:_tmpOAuthTokenSecret contentType:TDOAuthContentTypeUrlEncodedForm];
+        NSString *token, *tokenSecret;
+        @synchronized(self) {
+            token = _tmpOAuthToken;
+            tokenSecret = _tmpOAuthTokenSecret;
+        }
+        return [self signedRequestForPath:request.path method:request.method parameters:request.parameters token:token tokenSecret:tokenSecret contentType:TDOAuthContentTypeUrlEncodedForm];
     } else if (request.requestBody != nil) {
         return [self requestForPath:request.path method:request.method body:request.requestBody];
     } else {
@@ -290,6 +418,10 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
 
 #pragma mark - Executing Requests
 
+- (void)preconnectWithConnections:(NSUInteger)connections {
+    [self.session preconnectToURL:self.baseURL connections:connections];
+}
+
 - (CIOAPISession *)session {
     if (_session == nil) {
         _session = [[CIOAPISession alloc] init];
@@ -299,14 +431,230 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
 
 - (void)executeRequest:(CIORequest *)request success:(void (^)(id))success
                failure:(void (^)(NSError *))failure {
-    [self.session executeRequest:[self requestForCIORequest:request] success:^(id result) {
+    if (![self credentialsLoaded]) {
+        // signing and the pool need the token and account ID, which must not keep the caller waiting
+        [self afterCredentialsLoad:^{
+            [self executeRequest:request success:success failure:failure];
+        }];
+        return;
+    }
+    CIOClientPool *clientPool = self.clientPool;
+    if (clientPool) {
+        // The pool runs it with executeSignedRequest: once the account's turn comes
+        [clientPool executeRequest:request success:success failure:failure];
+        return;
+    }
+    [self executeRequest:request sign:^{
+        return [self requestForCIORequest:request];
+    } success:success failure:failure];
+}
+
+- (void)executeSignedRequest:(NSURLRequest *)signedRequest
+                  forRequest:(CIORequest *)request
+                     success:(void (^)(id))success
+                     failure:(void (^)(NSError *))failure {
+    [self executeRequest:request sign:^{
+        return signedRequest;
+    } success:success failure:failure];
+}
+
+// Key of a GET in inFlightRequests, by class and fingerprint; nil for other methods, which are never shared
+- (NSString *)inFlightKeyForRequest:(CIORequest *)request {
+    if (![request.method isEqualToString:@"GET"]) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@ %@", NSStringFromClass(request.class), request.fingerprint.stringValue];
+}
+
+- (void (^)(id, NSError *))completionForRequest:(CIORequest *)request
+                                        success:(void (^)(id))success
+                                        failure:(void (^)(NSError *))failure {
+    return ^(id responseObject, NSError *error) {
+        // Also breaks the cycle through the cancellation handler, which holds on to this block
+        [request setCancellationHandler:nil];
+        if (error) {
+            if (failure) {
+                failure(error);
+            }
+        } else if (success) {
+            success(responseObject);
+        }
+    };
+}
+
+- (BOOL)joinInFlightRequest:(CIORequest *)request success:(void (^)(id))success failure:(void (^)(NSError *))failure {
+    NSString *key = [self inFlightKeyForRequest:request];
+    if (key == nil || request.isCancelled) {
+        return NO;
+    }
+    void (^completion)(id, NSError *) = [self completionForRequest:request success:success failure:failure];
+    CIOInFlightRequest *inFlightRequest = nil;
+    @synchronized(self.inFlightRequests) {
+        inFlightRequest = self.inFlightRequests[key];
+        if (inFlightRequest == nil) {
+            return NO;
+        }
+        [inFlightRequest.completions addObject:completion];
+    }
+    [request setCancellationHandler:^{
+        [self cancelCompletion:completion ofInFlightRequest:inFlightRequest key:key];
+    }];
+    return YES;
+}
+
+- (void)executeRequest:(CIORequest *)request
+                  sign:(NSURLRequest * (^)(void))sign
+               success:(void (^)(id))success
+               failure:(void (^)(NSError *))failure {
+    void (^completion)(id, NSError *) = [self completionForRequest:request success:success failure:failure];
+    if (request.isCancelled) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(nil, [self cancellationError]);
+        });
+        return;
+    }
+
+    // Taken now, the request may be changed and executed again later
+    NSString *key = [self inFlightKeyForRequest:request];
+    CIOInFlightRequest *inFlightRequest = nil;
+    BOOL joined = NO;
+    @synchronized(self.inFlightRequests) {
+        inFlightRequest = key ? self.inFlightRequests[key] : nil;
+        joined = inFlightRequest != nil;
+        if (inFlightRequest == nil) {
+            inFlightRequest = [CIOInFlightRequest new];
+            inFlightRequest.completions = [NSMutableArray array];
+            if (key) {
+                self.inFlightRequests[key] = inFlightRequest;
+            }
+        }
+        [inFlightRequest.completions addObject:completion];
+    }
+    [request setCancellationHandler:^{
+        [self cancelCompletion:completion ofInFlightRequest:inFlightRequest key:key];
+    }];
+    if (joined) {
+        return;
+    }
+    [self executeSignedRequest:sign()
+                    forRequest:request
+               inFlightRequest:inFlightRequest
+              retryOnClockSkew:YES
+                       success:^(id responseObject) {
+                           [self finishInFlightRequest:inFlightRequest key:key responseObject:responseObject error:nil];
+                       }
+                       failure:^(NSError *error) {
+                           [self finishInFlightRequest:inFlightRequest key:key responseObject:nil error:error];
+                       }];
+}
+
+- (void)finishInFlightRequest:(CIOInFlightRequest *)inFlightRequest
+                          key:(NSString *)key
+               responseObject:(id)responseObject
+                        error:(NSError *)error {
+    NSArray *completions;
+    @synchronized(self.inFlightRequests) {
+        completions = [inFlightRequest.completions copy];
+        [inFlightRequest.completions removeAllObjects];
+        inFlightRequest.task = nil;
+        if (key && self.inFlightRequests[key] == inFlightRequest) {
+            [self.inFlightRequests removeObjectForKey:key];
+        }
+    }
+    for (void (^completion)(id, NSError *) in completions) {
+        completion(responseObject, error);
+    }
+}
+
+// Fails one caller at once. The request itself is only cancelled when nobody else is waiting for its response.
+- (void)cancelCompletion:(void (^)(id, NSError *))completion
+       ofInFlightRequest:(CIOInFlightRequest *)inFlightRequest
+                     key:(NSString *)key {
+    BOOL waiting;
+    id<CIOTransportTask> task = nil;
+    @synchronized(self.inFlightRequests) {
+        waiting = [inFlightRequest.completions indexOfObjectIdenticalTo:completion] != NSNotFound;
+        if (!waiting) {
+            // Already finished
+            return;
+        }
+        [inFlightRequest.completions removeObjectIdenticalTo:completion];
+        if (inFlightRequest.completions.count == 0) {
+            inFlightRequest.cancelled = YES;
+            task = inFlightRequest.task;
+            if (key && self.inFlightRequests[key] == inFlightRequest) {
+                [self.inFlightRequests removeObjectForKey:key];
+            }
+        }
+    }
+    [task cancel];
+    NSError *error = [self cancellationError];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        completion(nil, error);
+    });
+}
+
+- (NSError *)cancellationError {
+    return [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+}
+
+- (NSError *)signingErrorForRequest:(CIORequest *)request {
+    NSString *description = [NSString stringWithFormat:@"Could not sign %@ %@", request.method, request.path];
+    return [NSError errorWithDomain:@"io.context.error.request.signing"
+                               code:NSURLErrorBadURL
+                           userInfo:@{NSLocalizedDescriptionKey: description}];
+}
+
+// A request rejected for its timestamp has already corrected the clock offset, so it is signed again with a fresh
+// timestamp and nonce and retried, once.
+- (void)executeSignedRequest:(NSURLRequest *)signedRequest
+                  forRequest:(CIORequest *)request
+             inFlightRequest:(CIOInFlightRequest *)inFlightRequest
+            retryOnClockSkew:(BOOL)retryOnClockSkew
+                     success:(void (^)(id))success
+                     failure:(void (^)(NSError *))failure {
+    if (signedRequest == nil) {
+        NSError *error = [self signingErrorForRequest:request];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (failure) {
+                failure(error);
+            }
+        });
+        return;
+    }
+    NSURLRequest * (^hedgeRequestFactory)(void) = nil;
+    if ([request.method isEqualToString:@"GET"]) {
+        hedgeRequestFactory = ^{
+            return [self requestForCIORequest:request];
+        };
+    }
+    id<CIOTransportTask> task = [self.session executeRequest:signedRequest hedgeRequestFactory:hedgeRequestFactory success:^(id result) {
         NSError *error = [request validateResponseObject:result];
         if (error) {
             failure(error);
         } else {
             success(result);
         }
-    } failure:failure];
+    } failure:^(NSError *error) {
+        if (retryOnClockSkew && [self.session isClockSkewError:error]) {
+            [self executeSignedRequest:[self requestForCIORequest:request]
+                            forRequest:request
+                       inFlightRequest:inFlightRequest
+                      retryOnClockSkew:NO
+                               success:success
+                               failure:failure];
+        } else if (failure) {
+            failure(error);
+        }
+    }];
+    BOOL cancelled;
+    @synchronized(self.inFlightRequests) {
+        inFlightRequest.task = task;
+        cancelled = inFlightRequest.cancelled;
+    }
+    if (cancelled) {
+        [task cancel];
+    }
 }
 
 - (void)executeDictionaryRequest:(CIODictionaryRequest *)request
@@ -328,7 +676,23 @@ static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
 }
 
 - (void)downloadRequest:(CIORequest * __nonnull)request toFileURL:(NSURL * __nonnull)fileURL success:(nullable void (^)())successBlock failure:(nullable void (^)(NSError * __nonnull))failureBlock progress:(nullable CIOSessionDownloadProgressBlock)progressBlock {
-    [self.session downloadRequest:[self requestForCIORequest:request]
+    if (![self credentialsLoaded]) {
+        [self afterCredentialsLoad:^{
+            [self downloadRequest:request toFileURL:fileURL success:successBlock failure:failureBlock progress:progressBlock];
+        }];
+        return;
+    }
+    NSURLRequest *signedRequest = [self requestForCIORequest:request];
+    if (signedRequest == nil) {
+        NSError *error = [self signingErrorForRequest:request];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (failureBlock) {
+                failureBlock(error);
+            }
+        });
+        return;
+    }
+    [self.session downloadRequest:signedRequest
                         toFileURL:fileURL
                           success:successBlock
                           failure:failureBlock
@@ -8,11 +8,15 @@
 
 #import <Foundation/Foundation.h>
 #import "CIORequest.h"
+#import "CIORequestFingerprint.h"
 #import "CIOMessageRequests.h"
 #import "CIOContactsRequest.h"
 #import "CIOFilesRequest.h"
 #import "CIOSourceRequests.h"
 #import "CIOAPISession.h"
+#import "CIOCredentialStore.h"
+
+@class CIOClientPool;
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -29,6 +33,11 @@ typedef NS_ENUM(NSInteger, CIOEmailProviderType) {
  */
 extern NSString *const CIOAPISessionURLResponseErrorKey;
 
+/**
+ *  Present with a value of `@YES` in an `NSError`'s `userInfo` when the failed response also moved the OAuth clock offset.
+ */
+extern NSString *const CIOAPISessionClockSkewAdjustedErrorKey;
+
 /**
  `CIOAPIClient` provides an easy to use interface for constructing requests against the Context.IO API. The client
  handles authentication and all signing of requests.
@@ -36,6 +45,10 @@ extern NSString *const CIOAPISessionURLResponseErrorKey;
  Each `CIOAPIClient` instance handles its own authentication credentials. If the credentials are saved to the keychain
  via `completeLoginWithResponse:saveCredentials:`, they are keyed off of the consumer key. `CIOAPIClient` will restore
  saved credentials if it is initalized with a previously-authenticated consumer key/secret.
+
+ A GET identical to one the client still has in flight, same class and same `fingerprint`, is not sent again. It
+ completes with the response of the request already on the wire. Cancelling one of them with `-[CIORequest cancel]`
+ only stops the request on the wire once none of the others is waiting for it.
  */
 @interface CIOAPIClient : NSObject
 
@@ -51,10 +64,26 @@ extern NSString *const CIOAPISessionURLResponseErrorKey;
  */
 @property (nonatomic) NSTimeInterval timeoutInterval;
 
-@property (readonly, nonatomic) CIOAPISession *session;
+/**
+ The session requests are executed in. Created on first use unless one is assigned first; clients of a `CIOClientPool`
+ share one.
+ */
+@property (nonatomic) CIOAPISession *session;
+
+/**
+ The pool this client belongs to, set by `CIOClientPool`. Requests executed on a pooled client are queued by the pool
+ and scheduled fairly with those of its other accounts.
+ */
+@property (nullable, weak) CIOClientPool *clientPool;
 
 @property (readonly, nonatomic) NSString *accountPath;
 
+/**
+ The account ID to build request paths with. While saved credentials are still being read it is a placeholder, replaced
+ with the account ID when the request is signed, so building a request never waits for them.
+ */
+@property (readonly, nonatomic, nullable) NSString *accountIDPathComponent;
+
 - (NSString *)keychainPrefix;
 
 #pragma mark - Creating and Initializing API Clients
@@ -83,6 +112,23 @@ extern NSString *const CIOAPISessionURLResponseErrorKey;
 
 - (instancetype)init NS_UNAVAILABLE;
 
+/**
+ Store that clients created afterwards save credentials to and restore them from. Defaults to a
+ `CIOKeychainCredentialStore`, or a `CIOFileCredentialStore` where there is no keychain.
+
+ Saved credentials are read in the background when a client is initialized without a token. Requests built and executed
+ meanwhile are signed and sent once the read finishes, without blocking the caller. `isAuthorized` and `accountID`
+ wait for it, so at launch use `loadCredentialsWithCompletion:` instead.
+ */
++ (id<CIOCredentialStore>)defaultCredentialStore;
+
++ (void)setDefaultCredentialStore:(id<CIOCredentialStore>)credentialStore;
+
+/**
+ Calls `completion` on the main queue once saved credentials have been read, with the value of `isAuthorized`.
+ */
+- (void)loadCredentialsWithCompletion:(void (^)(BOOL authorized))completion;
+
 /**
  *  Create a signed `NSURLRequest` for the context.io API using current OAuth credentials
  *
@@ -111,7 +157,18 @@ extern NSString *const CIOAPISessionURLResponseErrorKey;
  */
 - (NSString *)accountPath:(NSArray *)components;
 
-- (NSURLRequest *)requestForCIORequest:(CIORequest *)request;
+/**
+ Signs `request` for sending.
+
+ @return the signed URL request, or `nil` if `request` can't be encoded, e.g. a body that isn't valid JSON
+ */
+- (nullable NSURLRequest *)requestForCIORequest:(CIORequest *)request;
+
+/**
+ Opens `connections` connections to the API host ahead of the first request and keeps them warm while the client is in
+ use, see `-[CIOAPISession preconnectToURL:connections:]`. Call it at launch and when returning to the foreground.
+ */
+- (void)preconnectWithConnections:(NSUInteger)connections;
 
 #pragma mark - Authenticating the API Client
 
@@ -182,6 +239,47 @@ extern NSString *const CIOAPISessionURLResponseErrorKey;
                      success:(nullable void (^)(NSString *responseString))success
                      failure:(nullable void (^)(NSError *error))failure;
 
+/**
+ *  Execute a request which has already been signed with `requestForCIORequest:`, for callers that sign ahead of time such
+ * as `CIOSigningPipeline`. The response is validated against `request`.
+ *
+ *  @param signedRequest the signed URL request to send, `nil` if signing failed, which fails the request
+ *  @param request       the request `signedRequest` was created from
+ *  @param success       Handler block that takes the parsed response object
+ *  @param failure       Failure block
+ */
+- (void)executeSignedRequest:(nullable NSURLRequest *)signedRequest
+                  forRequest:(CIORequest *)request
+                     success:(void (^)(id responseObject))success
+                     failure:(nullable void (^)(NSError *error))failure;
+
+/**
+ *  Execute a request that the caller signs, for callers that sign off their own queue such as `CIOClientPool`. A GET
+ * identical to one already in flight, same class and same `fingerprint`, waits for that response and `sign` isn't
+ * called, so it costs no HMAC or nonce.
+ *
+ *  @param request the request to execute
+ *  @param sign    returns `request` signed, e.g. with `requestForCIORequest:`, or `nil` if signing failed, which fails
+ *                 the request
+ *  @param success Handler block that takes the parsed response object
+ *  @param failure Failure block
+ */
+- (void)executeRequest:(CIORequest *)request
+                  sign:(NSURLRequest *_Nullable (^)(void))sign
+               success:(nullable void (^)(id responseObject))success
+               failure:(nullable void (^)(NSError *error))failure;
+
+/**
+ *  Attaches `request` to an identical GET already in flight, for callers that sign ahead of time such as
+ * `CIOSigningPipeline`, so they need not sign it at all.
+ *
+ *  @return YES if `request` now completes with the response of the request in flight, NO if there is none and it must be
+ * signed and executed
+ */
+- (BOOL)joinInFlightRequest:(CIORequest *)request
+                    success:(nullable void (^)(id responseObject))success
+                    failure:(nullable void (^)(NSError *error))failure;
+
 /**
  *  Execute a request against the Context.IO API and save the body of the response to a file on disk. Typically used for
  * saving attachments or raw message content.
@@ -7,6 +7,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "CIOTransport.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -15,7 +16,7 @@ typedef void (^CIOSessionDownloadProgressBlock)(int64_t bytesRead, int64_t total
 
 /**
  *  `CIOAPISession` provides the underlying support for executing requests against the Context.IO API via
- `NSURLSession` used by `CIOAPIClient`.
+ a `CIOTransport` (by default `NSURLSession`) used by `CIOAPIClient`.
     The requests are typed based on their result data type: dictionary, array, and string.
 
     Untyped requests that are simply `CIORequest` can only be downloaded to a file via
@@ -29,10 +30,122 @@ typedef void (^CIOSessionDownloadProgressBlock)(int64_t bytesRead, int64_t total
  */
 @interface CIOAPISession : NSObject
 
+/**
+ *  The transport requests are sent with. Defaults to a `CIOURLSessionTransport`, or a `CIOCurlTransport` on Linux builds
+ * with `CIO_HAVE_LIBCURL` defined.
+ */
+@property (readonly, nonatomic) id<CIOTransport> transport;
+
+- (instancetype)initWithTransport:(id<CIOTransport>)transport NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  A session using the default transport for the platform.
+ */
+- (instancetype)init;
+
+/**
+ *  When `YES` (the default), the session compares the `Date` header of every response with the device clock and keeps
+ * `+[TDOAuth utcTimeOffset]` in step with the server, so OAuth timestamps stay valid on devices with a drifting clock.
+ */
+@property (nonatomic) BOOL calibratesClockSkew;
+
+/**
+ *  Last measured offset in seconds between the server clock and the device clock. Positive when the server is ahead.
+ */
+@property (readonly) NSTimeInterval clockSkew;
+
+/**
+ *  Number of times the offset applied to OAuth timestamps has been changed by calibration.
+ */
+@property (readonly) NSUInteger clockSkewAdjustments;
+
 - (void)executeRequest:(NSURLRequest *)request
                success:(void (^)(id responseObject))successBlock
                failure:(void (^)(NSError *error))failureBlock;
 
+/**
+ *  Execute a request, sending a duplicate if it is slow to answer and hedging is enabled.
+ *
+ *  Only `GET` requests are hedged. When `hedgesIdempotentRequests` is set and the request has been outstanding longer
+ * than `hedgePercentile` of recent requests to the same endpoint, a second copy made by `hedgeRequestFactory` is sent.
+ * The first to answer is delivered and the other is cancelled. The factory is needed because an OAuth signature and
+ * its nonce cannot be sent twice.
+ *
+ *  @param hedgeRequestFactory returns a freshly signed copy of `request`, or nil to send no hedge; called at most once, on a background queue.
+ * Pass `nil` to never hedge.
+ *
+ *  @return the running request. Cancelling it cancels every attempt and calls `failureBlock` with `NSURLErrorCancelled`.
+ */
+- (id<CIOTransportTask>)executeRequest:(NSURLRequest *)request
+    hedgeRequestFactory:(nullable NSURLRequest * (^)(void))hedgeRequestFactory
+                success:(void (^)(id responseObject))successBlock
+                failure:(void (^)(NSError *error))failureBlock;
+
+#pragma mark - Hedging
+
+/**
+ *  Whether slow `GET` requests executed with a hedge request factory get a duplicate. Defaults to `NO`.
+ */
+@property (nonatomic) BOOL hedgesIdempotentRequests;
+
+/**
+ *  Percentile of recent latencies of an endpoint after which a request to it is hedged. Defaults to 0.95.
+ */
+@property (nonatomic) double hedgePercentile;
+
+/**
+ *  Upper bound on hedges as a fraction of eligible requests, to protect API quota. Defaults to 0.05.
+ */
+@property (nonatomic) double maxHedgeRate;
+
+/**
+ *  Shortest time a request is given before it is hedged. Defaults to 50 milliseconds.
+ */
+@property (nonatomic) NSTimeInterval minimumHedgeDelay;
+
+/**
+ *  Number of hedges sent.
+ */
+@property (readonly) NSUInteger hedgedRequestCount;
+
+/**
+ *  Number of hedges that answered before the original request.
+ */
+@property (readonly) NSUInteger hedgeWinCount;
+
+/**
+ *  Number of hedges not sent because `maxHedgeRate` had been reached.
+ */
+@property (readonly) NSUInteger suppressedHedgeCount;
+
+#pragma mark - Connection Warming
+
+/**
+ *  Seconds between keep-alive pings on connections opened by `preconnectToURL:connections:`. Must stay below the
+ * server's idle timeout for the connections to survive. Defaults to 25 seconds; 0 disables keep-alive.
+ */
+@property (nonatomic) NSTimeInterval keepAliveInterval;
+
+/**
+ *  Keep-alive pings stop once no request has been executed for this many seconds, so an idle app does not keep the radio
+ * awake. Defaults to 120 seconds.
+ */
+@property (nonatomic) NSTimeInterval keepAliveIdleLimit;
+
+/**
+ *  Opens up to `connections` connections to the host of `url` ahead of the first real request, so that request does not
+ * pay for DNS, TCP and TLS handshakes, then keeps them warm according to `keepAliveInterval` and `keepAliveIdleLimit`.
+ * The number of connections is capped by the session's `HTTPMaximumConnectionsPerHost`.
+ *
+ *  Connections are opened with unauthenticated `HEAD` requests whose responses are ignored.
+ */
+- (void)preconnectToURL:(NSURL *)url connections:(NSUInteger)connections;
+
+/**
+ *  Stops keep-alive pings, e.g. when the app moves to the background. Open connections are left to time out.
+ */
+- (void)stopKeepAlive;
+
 /**
  *  Execute a request against the Context.IO API and save the body of the response to a file on disk. Typically used for
  * saving attachments or raw message content.
@@ -54,6 +167,12 @@ typedef void (^CIOSessionDownloadProgressBlock)(int64_t bytesRead, int64_t total
 
 - (NSError *)errorForResponse:(NSHTTPURLResponse *)response responseObject:(nullable id)responseObject;
 
+/**
+ *  Whether `error` is an authentication failure caused by a stale OAuth timestamp, i.e. one worth re-signing and
+ * retrying once now that the clock offset has been corrected.
+ */
+- (BOOL)isClockSkewError:(NSError *)error;
+
 - (nullable id)parseResponse:(NSURLResponse *)response data:(NSData *)data error:(NSError **)error;
 
 @end
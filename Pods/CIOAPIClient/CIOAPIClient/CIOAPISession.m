@@ -7,62 +7,259 @@
 //
 
 #import "CIOAPISession.h"
+#import "TDOAuth.h"
+#import "CIOLatencyHistogram.h"
+#if defined(__linux__) && defined(CIO_HAVE_LIBCURL)
+#import "CIOCurlTransport.h"
+#endif
+#import <limits.h>
+#import <math.h>
+#import <time.h>
 
 NSString *const CIOAPISessionURLResponseErrorKey = @"io.context.error.response";
+NSString *const CIOAPISessionClockSkewAdjustedErrorKey = @"io.context.error.clockskewadjusted";
 
-@interface CIODownloadTask : NSObject
+// The Date header only has a resolution of one second, so smaller differences are noise
+static const NSTimeInterval CIOAPISessionClockSkewTolerance = 1.0;
 
-@property (nullable, nonatomic) NSURL *saveToURL;
-@property (nullable, nonatomic, copy) CIOSessionDownloadProgressBlock progressBlock;
-@property (nullable, nonatomic, copy) void (^successBlock)();
-@property (nullable, nonatomic, copy) void (^failureBlock)(NSError *error);
+// Hedging waits for this many latency samples of an endpoint before trusting its percentiles
+static const NSUInteger CIOAPISessionMinimumHedgeSamples = 20;
+// Most hedges that may be sent back to back after a quiet period
+static const double CIOAPISessionHedgeBurst = 10;
+static const NSUInteger CIOAPISessionMaxLatencyHistograms = 64;
+
+// Parses an RFC 7231 IMF-fixdate such as "Sun, 06 Nov 1994 08:49:37 GMT". Returns NO for anything else. Day and month
+// names are always English, so they are matched here rather than with strptime, which reads them in the current locale.
+static BOOL CIOParseHTTPDate(NSString *header, NSTimeInterval *timestamp) {
+    static const char *const months[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    char date[32];
+    if (![header getCString:date maxLength:sizeof(date) encoding:NSASCIIStringEncoding] || strlen(date) != 29) {
+        return NO;
+    }
+    // "Sun, 06 Nov 1994 08:49:37 GMT": fixed width, digits at known offsets
+    static const char *const pattern = "Aaa, 00 Aaa 0000 00:00:00 GMT";
+    for (size_t i = 0; i < 29; i++) {
+        BOOL digit = date[i] >= '0' && date[i] <= '9';
+        if ((pattern[i] == '0') != digit || (pattern[i] != '0' && pattern[i] != 'A' && pattern[i] != 'a' && date[i] != pattern[i])) {
+            return NO;
+        }
+    }
+    int month = -1;
+    for (int i = 0; i < 12; i++) {
+        if (strncmp(date + 8, months[i], 3) == 0) {
+            month = i;
+            break;
+        }
+    }
+    if (month < 0) {
+        return NO;
+    }
+#define CIO_DIGITS2(offset) ((date[offset] - '0') * 10 + (date[(offset) + 1] - '0'))
+    struct tm components = {0};
+    components.tm_mday = CIO_DIGITS2(5);
+    components.tm_mon = month;
+    components.tm_year = CIO_DIGITS2(12) * 100 + CIO_DIGITS2(14) - 1900;
+    components.tm_hour = CIO_DIGITS2(17);
+    components.tm_min = CIO_DIGITS2(20);
+    components.tm_sec = CIO_DIGITS2(23);
+#undef CIO_DIGITS2
+    if (components.tm_mday < 1 || components.tm_mday > 31 || components.tm_hour > 23 || components.tm_min > 59 ||
+        components.tm_sec > 60) {
+        return NO;
+    }
+    time_t seconds = timegm(&components);
+    if (seconds == (time_t)-1) {
+        return NO;
+    }
+    *timestamp = (NSTimeInterval)seconds;
+    return YES;
+}
+
+// The attempts of one request, the original and possibly a hedge. Guarded by @synchronized on itself.
+@interface CIOHedgedRequest : NSObject <CIOTransportTask>
+
+@property (nonatomic) BOOL finished;
+@property (nonatomic) BOOL cancelled;
+@property (nonatomic) NSMutableArray *tasks;
+// When the original attempt was sent. Latency is recorded from here whichever attempt wins.
+@property (nonatomic) NSTimeInterval sentAt;
 
 @end
 
-@implementation CIODownloadTask
+@implementation CIOHedgedRequest
+
+// Attempts are resumed as they are started
+- (void)resume {
+}
+
+// The last cancelled attempt to complete reports the cancellation
+- (void)cancel {
+    NSArray *tasks;
+    @synchronized(self) {
+        if (self.finished || self.cancelled) {
+            return;
+        }
+        self.cancelled = YES;
+        tasks = [self.tasks copy];
+    }
+    for (id<CIOTransportTask> task in tasks) {
+        [task cancel];
+    }
+}
 
 @end
 
 #pragma mark -
 
-@interface CIOAPISession () <NSURLSessionDownloadDelegate>
+@interface CIOAPISession ()
 
-@property (nonatomic) NSURLSession *urlSession;
+@property (readwrite, nonatomic) id<CIOTransport> transport;
 @property (nonatomic) NSIndexSet *acceptableStatusCodes;
-// Mapping from Task ID to CIODownloadTask. Must only be read/written on the underlying NSURLSession queue.
-@property (nonatomic) NSMutableDictionary *downloadTaskIDToCIOTask;
+@property (readwrite) NSTimeInterval clockSkew;
+@property (readwrite) NSUInteger clockSkewAdjustments;
+// Keep-alive state, must only be read/written on keepAliveQueue
+@property (nonatomic) dispatch_queue_t keepAliveQueue;
+@property (nonatomic, nullable) dispatch_source_t keepAliveTimer;
+@property (nonatomic, nullable) NSURL *keepAliveURL;
+@property (nonatomic) NSUInteger keepAliveConnections;
+@property (readwrite) NSUInteger hedgedRequestCount;
+@property (readwrite) NSUInteger hedgeWinCount;
+@property (readwrite) NSUInteger suppressedHedgeCount;
+// Hedges that may still be sent, earned at maxHedgeRate per eligible request. Guarded by @synchronized(self).
+@property (nonatomic) double hedgeBudget;
+// Path to CIOLatencyHistogram. Guarded by @synchronized on itself.
+@property (nonatomic) NSMutableDictionary *latencyHistograms;
+@property (nonatomic) CIOLatencyHistogram *sharedLatencyHistogram;
+// Time of the last request executed, as seconds since the reference date. Read and written atomically.
+@property (atomic) NSTimeInterval lastActivity;
 
 @end
 
 @implementation CIOAPISession
 
++ (id<CIOTransport>)defaultTransport {
+#if defined(__linux__) && defined(CIO_HAVE_LIBCURL)
+    return [[CIOCurlTransport alloc] init];
+#else
+    return [[CIOURLSessionTransport alloc] init];
+#endif
+}
+
 - (instancetype)init {
+    return [self initWithTransport:[[self class] defaultTransport]];
+}
+
+- (instancetype)initWithTransport:(id<CIOTransport>)transport {
     if ((self = [super init])) {
-        self.urlSession = [NSURLSession sessionWithConfiguration:[NSURLSessionConfiguration defaultSessionConfiguration]
-                                                        delegate:self
-                                                   delegateQueue:nil];
+        self.transport = transport;
         // Hat tip to AFNetworking
         self.acceptableStatusCodes = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(200, 100)];
-        self.downloadTaskIDToCIOTask = [NSMutableDictionary dictionary];
+        self.calibratesClockSkew = YES;
+        self.keepAliveInterval = 25;
+        self.keepAliveIdleLimit = 120;
+        self.keepAliveQueue = dispatch_queue_create("io.context.keepalive", DISPATCH_QUEUE_SERIAL);
+        self.hedgePercentile = 0.95;
+        self.maxHedgeRate = 0.05;
+        self.minimumHedgeDelay = 0.05;
+        self.latencyHistograms = [NSMutableDictionary dictionary];
+        self.sharedLatencyHistogram = [CIOLatencyHistogram new];
     }
     return self;
 }
 
+- (void)dealloc {
+    if (_keepAliveTimer) {
+        dispatch_source_cancel(_keepAliveTimer);
+    }
+}
+
+#pragma mark - Connection Warming
+
+- (void)preconnectToURL:(NSURL *)url connections:(NSUInteger)connections {
+    NSUInteger maximum = self.transport.maximumConnectionsPerHost;
+    connections = MAX(MIN(connections, maximum), (NSUInteger)1);
+    self.lastActivity = [NSDate timeIntervalSinceReferenceDate];
+    dispatch_async(self.keepAliveQueue, ^{
+        self.keepAliveURL = url;
+        self.keepAliveConnections = connections;
+        [self _sendKeepAlivePings];
+        [self _startKeepAliveTimer];
+    });
+}
+
+- (void)stopKeepAlive {
+    dispatch_async(self.keepAliveQueue, ^{
+        [self _cancelKeepAliveTimer];
+    });
+}
+
+// Concurrent requests make the transport open one connection each instead of queueing them on a single one
+- (void)_sendKeepAlivePings {
+    NSURL *rootURL = [NSURL URLWithString:@"/" relativeToURL:self.keepAliveURL];
+    for (NSUInteger i = 0; i < self.keepAliveConnections; i++) {
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:rootURL
+                                                               cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
+                                                           timeoutInterval:10];
+        request.HTTPMethod = @"HEAD";
+        [[self.transport dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response,
+                                                                         NSError *error){
+        }] resume];
+    }
+}
+
+- (void)_startKeepAliveTimer {
+    [self _cancelKeepAliveTimer];
+    if (self.keepAliveInterval <= 0) {
+        return;
+    }
+    uint64_t interval = (uint64_t)(self.keepAliveInterval * NSEC_PER_SEC);
+    self.keepAliveTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.keepAliveQueue);
+    // Generous leeway lets the system coalesce the pings with other wakeups
+    dispatch_source_set_timer(self.keepAliveTimer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval,
+                              interval / 5);
+    __weak CIOAPISession *weakSelf = self;
+    dispatch_source_set_event_handler(self.keepAliveTimer, ^{
+        CIOAPISession *strongSelf = weakSelf;
+        NSTimeInterval idle = [NSDate timeIntervalSinceReferenceDate] - strongSelf.lastActivity;
+        if (idle > strongSelf.keepAliveIdleLimit) {
+            [strongSelf _cancelKeepAliveTimer];
+        } else {
+            [strongSelf _sendKeepAlivePings];
+        }
+    });
+    dispatch_resume(self.keepAliveTimer);
+}
+
+- (void)_cancelKeepAliveTimer {
+    if (self.keepAliveTimer) {
+        dispatch_source_cancel(self.keepAliveTimer);
+        self.keepAliveTimer = nil;
+    }
+}
+
 - (void)downloadRequest:(NSURLRequest *)request
               toFileURL:(NSURL *)saveToURL
                 success:(void (^)())successBlock
                 failure:(void (^)(NSError *))failureBlock
                progress:(void (^)(int64_t, int64_t, int64_t))progressBlock {
-    NSURLSessionDownloadTask *downloadTask = [self.urlSession downloadTaskWithRequest:request];
-    CIODownloadTask *cioTask = [CIODownloadTask new];
-    cioTask.saveToURL = saveToURL;
-    cioTask.successBlock = successBlock;
-    cioTask.failureBlock = failureBlock;
-    cioTask.progressBlock = progressBlock;
-    [self.urlSession.delegateQueue addOperationWithBlock:^{
-        self.downloadTaskIDToCIOTask[@(downloadTask.taskIdentifier)] = cioTask;
-        [downloadTask resume];
-    }];
+    id<CIOTransportTask> downloadTask =
+        [self.transport downloadTaskWithRequest:request
+                                      toFileURL:saveToURL
+                                       progress:^(int64_t bytesRead, int64_t totalBytesRead, int64_t totalBytesExpected) {
+                                           if (progressBlock) {
+                                               dispatch_async(dispatch_get_main_queue(), ^{
+                                                 progressBlock(bytesRead, totalBytesRead, totalBytesExpected);
+                                               });
+                                           }
+                                       }
+                              completionHandler:^(NSError *error) {
+                                  if (error) {
+                                      [self _dispatchMain:failureBlock parameter:error];
+                                  } else if (successBlock) {
+                                      dispatch_async(dispatch_get_main_queue(), successBlock);
+                                  }
+                              }];
+    [downloadTask resume];
 }
 
 #pragma mark -
@@ -98,6 +295,60 @@ NSString *const CIOAPISessionURLResponseErrorKey = @"io.context.error.response";
                         userInfo:@{NSLocalizedDescriptionKey: errorString, CIOAPISessionURLResponseErrorKey: response}];
 }
 
+- (BOOL)isClockSkewError:(NSError *)error {
+    NSHTTPURLResponse *response = error.userInfo[CIOAPISessionURLResponseErrorKey];
+    if (![response isKindOfClass:[NSHTTPURLResponse class]] || response.statusCode != 401) {
+        return NO;
+    }
+    if ([error.userInfo[CIOAPISessionClockSkewAdjustedErrorKey] boolValue]) {
+        return YES;
+    }
+    // Context.IO reports rejected timestamps in the error body, e.g. "Invalid timestamp"
+    return [error.localizedDescription rangeOfString:@"timestamp" options:NSCaseInsensitiveSearch].location != NSNotFound;
+}
+
+#pragma mark - Clock skew
+
+// Measures the server clock against the device clock and moves the OAuth timestamp offset when they disagree. `sentAt`
+// and `receivedAt` bracket the request, the server stamped its Date somewhere in between. Returns YES if the offset
+// changed.
+- (BOOL)calibrateClockWithResponse:(NSURLResponse *)response
+                            sentAt:(NSTimeInterval)sentAt
+                        receivedAt:(NSTimeInterval)receivedAt {
+    if (!self.calibratesClockSkew || ![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return NO;
+    }
+    NSString *dateHeader = [(NSHTTPURLResponse *)response valueForHTTPHeaderField:@"Date"];
+    NSTimeInterval serverTime;
+    if (!dateHeader || !CIOParseHTTPDate(dateHeader, &serverTime)) {
+        return NO;
+    }
+    NSTimeInterval skew = serverTime - (sentAt + receivedAt) / 2;
+    self.clockSkew = skew;
+
+    // The OAuth offset is an int; a clock decades off can't be fixed by it anyway
+    int offset = (int)lround(MAX(MIN(skew, (NSTimeInterval)INT_MAX), (NSTimeInterval)INT_MIN));
+    if (fabs(skew - (NSTimeInterval)[TDOAuth utcTimeOffset]) <= CIOAPISessionClockSkewTolerance) {
+        return NO;
+    }
+    [TDOAuth setUtcTimeOffset:offset];
+    @synchronized(self) {
+        self.clockSkewAdjustments++;
+    }
+    return YES;
+}
+
+- (NSError *)error:(NSError *)error markingClockSkewAdjusted:(BOOL)adjusted {
+    if (!adjusted || !error.userInfo[CIOAPISessionURLResponseErrorKey]) {
+        return error;
+    }
+    NSMutableDictionary *userInfo = [error.userInfo mutableCopy];
+    userInfo[CIOAPISessionClockSkewAdjustedErrorKey] = @YES;
+    return [NSError errorWithDomain:error.domain code:error.code userInfo:userInfo];
+}
+
+#pragma mark -
+
 - (id)parseResponse:(NSURLResponse *)response data:(NSData *)data error:(NSError **)error {
     id responseObject = nil;
     if (data && [data length] > 0) {
@@ -132,63 +383,151 @@ NSString *const CIOAPISessionURLResponseErrorKey = @"io.context.error.response";
 - (void)executeRequest:(NSURLRequest *)request
                success:(void (^)(id responseObject))successBlock
                failure:(void (^)(NSError *error))failureBlock {
-    NSURLSessionDataTask *dataTask =
-    [self.urlSession dataTaskWithRequest:request
-                       completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    [self executeRequest:request hedgeRequestFactory:nil success:successBlock failure:failureBlock];
+}
+
+- (id<CIOTransportTask>)executeRequest:(NSURLRequest *)request
+                   hedgeRequestFactory:(NSURLRequest * (^)(void))hedgeRequestFactory
+                               success:(void (^)(id responseObject))successBlock
+                               failure:(void (^)(NSError *error))failureBlock {
+    CIOHedgedRequest *hedgedRequest = [CIOHedgedRequest new];
+    hedgedRequest.tasks = [NSMutableArray arrayWithCapacity:2];
+    BOOL idempotent = [request.HTTPMethod isEqualToString:@"GET"];
+    CIOLatencyHistogram *histogram = idempotent ? [self latencyHistogramForURL:request.URL] : nil;
+    self.lastActivity = [NSDate timeIntervalSinceReferenceDate];
+    [self _startAttempt:request
+          hedgedRequest:hedgedRequest
+                isHedge:NO
+              histogram:histogram
+                success:successBlock
+                failure:failureBlock];
+
+    if (!idempotent || hedgeRequestFactory == nil || !self.hedgesIdempotentRequests) {
+        return hedgedRequest;
+    }
+    @synchronized(self) {
+        self.hedgeBudget = MIN(self.hedgeBudget + self.maxHedgeRate, CIOAPISessionHedgeBurst);
+    }
+    if (histogram.sampleCount < CIOAPISessionMinimumHedgeSamples) {
+        return hedgedRequest;
+    }
+    NSTimeInterval delay = MAX([histogram latencyAtPercentile:self.hedgePercentile], self.minimumHedgeDelay);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+                   dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        @synchronized(hedgedRequest) {
+            if (hedgedRequest.finished || hedgedRequest.cancelled) {
+                return;
+            }
+        }
+        @synchronized(self) {
+            if (self.hedgeBudget < 1) {
+                self.suppressedHedgeCount++;
+                return;
+            }
+            self.hedgeBudget -= 1;
+            self.hedgedRequestCount++;
+        }
+        // OAuth nonces are single use, so the duplicate needs a signature of its own. Signing on this queue is safe, TDOAuth
+        // only borrows the thread's canonicalizer for the duration of one signature.
+        NSURLRequest *hedge = hedgeRequestFactory();
+        if (hedge == nil) {
+            return;
+        }
+        [self _startAttempt:hedge
+              hedgedRequest:hedgedRequest
+                    isHedge:YES
+                  histogram:histogram
+                    success:successBlock
+                    failure:failureBlock];
+    });
+    return hedgedRequest;
+}
+
+// Runs one attempt of a request. The first attempt to finish wins and cancels the others, except that a transport error
+// is ignored while another attempt may still succeed.
+- (void)_startAttempt:(NSURLRequest *)request
+        hedgedRequest:(CIOHedgedRequest *)hedgedRequest
+              isHedge:(BOOL)isHedge
+            histogram:(CIOLatencyHistogram *)histogram
+              success:(void (^)(id responseObject))successBlock
+              failure:(void (^)(NSError *error))failureBlock {
+    __block NSTimeInterval sentAt = 0;
+    __block id<CIOTransportTask> dataTask =
+    [self.transport dataTaskWithRequest:request
+                      completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+                           NSTimeInterval receivedAt = [[NSDate date] timeIntervalSince1970];
+                           id<CIOTransportTask> task = dataTask;
+                           dataTask = nil;
+                           NSTimeInterval requestSentAt;
+                           @synchronized(hedgedRequest) {
+                               requestSentAt = hedgedRequest.sentAt;
+                               [hedgedRequest.tasks removeObject:task];
+                               if (hedgedRequest.finished || (error && hedgedRequest.tasks.count > 0)) {
+                                   return;
+                               }
+                               hedgedRequest.finished = YES;
+                               for (id<CIOTransportTask> loser in hedgedRequest.tasks) {
+                                   [loser cancel];
+                               }
+                           }
+                           if (isHedge) {
+                               @synchronized(self) {
+                                   self.hedgeWinCount++;
+                               }
+                           }
                            if (error) {
                                [self _dispatchMain:failureBlock parameter:error];
                                return;
                            }
+                           // What the caller waited, i.e. the original attempt's latency, cut off when a hedge wins.
+                           // Recording only the winner's own time would skew the percentiles towards the fast
+                           // attempts and make hedging ever more eager.
+                           [histogram addLatency:receivedAt - requestSentAt];
+                           BOOL adjusted = [self calibrateClockWithResponse:response sentAt:sentAt receivedAt:receivedAt];
                            id responseObject = [self parseResponse:response data:data error:&error];
                            if (error) {
-                               [self _dispatchMain:failureBlock parameter:error];
+                               [self _dispatchMain:failureBlock
+                                         parameter:[self error:error markingClockSkewAdjusted:adjusted]];
                                return;
                            }
                            [self _dispatchMain:successBlock parameter:responseObject];
                        }];
-    [dataTask resume];
-}
-
-#pragma mark - NSURLSessionTaskDelegate
-
-- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
-    CIODownloadTask *cioTask = self.downloadTaskIDToCIOTask[@(task.taskIdentifier)];
-    if (cioTask) {
-        if (error) {
-            [self _dispatchMain:cioTask.failureBlock parameter:error];
-        } else if (cioTask.successBlock) {
-            dispatch_async(dispatch_get_main_queue(), cioTask.successBlock);
+    id<CIOTransportTask> task = dataTask;
+    BOOL cancelled;
+    @synchronized(hedgedRequest) {
+        [hedgedRequest.tasks addObject:task];
+        cancelled = hedgedRequest.cancelled;
+    }
+    sentAt = [[NSDate date] timeIntervalSince1970];
+    if (!isHedge) {
+        @synchronized(hedgedRequest) {
+            hedgedRequest.sentAt = sentAt;
         }
-        [self.downloadTaskIDToCIOTask removeObjectForKey:@(task.taskIdentifier)];
     }
-}
-
-#pragma mark - NSURLSessionDownloadDelegate
-
-- (void)URLSession:(NSURLSession *)session
-                 downloadTask:(NSURLSessionDownloadTask *)downloadTask
-                 didWriteData:(int64_t)bytesWritten
-            totalBytesWritten:(int64_t)totalBytesWritten
-    totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite {
-    CIODownloadTask *cioTask = self.downloadTaskIDToCIOTask[@(downloadTask.taskIdentifier)];
-    if (cioTask.progressBlock) {
-        dispatch_async(dispatch_get_main_queue(), ^{
-          cioTask.progressBlock(bytesWritten, totalBytesWritten, totalBytesExpectedToWrite);
-        });
+    [task resume];
+    if (cancelled) {
+        // A hedge that lost the race with -cancel
+        [task cancel];
     }
 }
 
-- (void)URLSession:(NSURLSession *)session
-                 downloadTask:(NSURLSessionDownloadTask *)downloadTask
-    didFinishDownloadingToURL:(NSURL *)location {
-    CIODownloadTask *cioTask = self.downloadTaskIDToCIOTask[@(downloadTask.taskIdentifier)];
-    if (cioTask.saveToURL) {
-        NSError *error = nil;
-        [[NSFileManager defaultManager] moveItemAtURL:location toURL:cioTask.saveToURL error:&error];
-        if (error) {
-            [self _dispatchMain:cioTask.failureBlock parameter:error];
-            [self.downloadTaskIDToCIOTask removeObjectForKey:@(downloadTask.taskIdentifier)];
+#pragma mark - Hedging
+
+// One histogram per endpoint path, since a message list and a single contact have very different latencies. Beyond
+// CIOAPISessionMaxLatencyHistograms paths (e.g. one per message ID) everything shares a single histogram.
+- (CIOLatencyHistogram *)latencyHistogramForURL:(NSURL *)url {
+    NSString *path = url.path ?: @"";
+    @synchronized(self.latencyHistograms) {
+        CIOLatencyHistogram *histogram = self.latencyHistograms[path];
+        if (histogram == nil) {
+            if (self.latencyHistograms.count < CIOAPISessionMaxLatencyHistograms) {
+                histogram = [CIOLatencyHistogram new];
+                self.latencyHistograms[path] = histogram;
+            } else {
+                histogram = self.sharedLatencyHistogram;
+            }
         }
+        return histogram;
     }
 }
 
@@ -0,0 +1,120 @@
+//
+//  CIOAdaptivePager.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CIOArrayRequest;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  `CIOAdaptivePager` pages through a list endpoint, choosing each page's `limit` from the latency of earlier pages.
+ *
+ *  The first page is small so the first rows show up quickly. After each page the pager fits page latency to a fixed
+ * cost per request plus a cost per item. It then picks the largest page expected to load within `targetPageLatency`.
+ * On a fast link pages grow toward `maximumPageSize`. When a page comes back slower than the target, the next page
+ * shrinks right away in proportion.
+ *
+ *  A pager must only be used from the main thread.
+ */
+@interface CIOAdaptivePager : NSObject
+
+/**
+ *  Size of the first page, and the page size to go back to after `reset`. Defaults to 10.
+ */
+@property (nonatomic) NSInteger initialPageSize;
+
+/**
+ *  Defaults to 5.
+ */
+@property (nonatomic) NSInteger minimumPageSize;
+
+/**
+ *  Defaults to 100, the API limit for array requests.
+ */
+@property (nonatomic) NSInteger maximumPageSize;
+
+/**
+ *  Time one page should take, from execution to parsed response. Defaults to 0.8 seconds.
+ */
+@property (nonatomic) NSTimeInterval targetPageLatency;
+
+/**
+ *  The `limit` the next page will be requested with.
+ */
+@property (readonly, nonatomic) NSInteger pageSize;
+
+/**
+ *  How long the next page is expected to take, from the latency measured so far. `targetPageLatency` until a page
+ * has been measured.
+ */
+@property (readonly, nonatomic) NSTimeInterval expectedPageLatency;
+
+/**
+ *  Number of items received so far, and the `offset` of the next page.
+ */
+@property (readonly, nonatomic) NSInteger offset;
+
+/**
+ *  NO once a page came back with fewer items than its `limit`.
+ */
+@property (readonly, nonatomic) BOOL hasMorePages;
+
+/**
+ *  YES while a page is being fetched.
+ */
+@property (readonly, nonatomic, getter=isLoading) BOOL loading;
+
+/**
+ *  @param requestFactory called for every page to create a fresh request with all filters set. The pager sets its
+ *                        `limit` and `offset`.
+ */
+- (instancetype)initWithRequestFactory:(CIOArrayRequest * (^)(void))requestFactory NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Fetches the next page unless one is already loading or the list is exhausted, in which case nothing happens.
+ *
+ *  @param success called on the main queue with the items of the page
+ *  @param failure called on the main queue if the page fails. The page can be fetched again.
+ */
+- (void)fetchNextPageWithSuccess:(nullable void (^)(NSArray *page))success
+                         failure:(nullable void (^)(NSError *error))failure;
+
+/**
+ *  Fetches a page of `pageSize` items at `offset` without moving the pager's own position, e.g. to reload items that
+ * were dropped from memory. Its latency still counts toward page sizing. Any number of these can run at once.
+ *
+ *  @param success called on the main queue with the items of the page
+ *  @param failure called on the main queue if the page fails
+ */
+- (void)fetchPageAtOffset:(NSInteger)offset
+                  success:(nullable void (^)(NSArray *page))success
+                  failure:(nullable void (^)(NSError *error))failure;
+
+/**
+ *  Cancels every page being fetched. Their failure blocks are called with `NSURLErrorCancelled`; the next page can be
+ * fetched again afterwards.
+ */
+- (void)cancel;
+
+/**
+ *  Moves the pager's position to `offset` without fetching, e.g. past items the app restored from its own copy of
+ * the list. Ignored while a page is loading.
+ */
+- (void)skipToOffset:(NSInteger)offset;
+
+/**
+ *  Starts over at offset 0, e.g. for pull to refresh. What the pager learned about latency is kept, but the page size
+ * goes back to `initialPageSize` so the first rows are quick again.
+ */
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
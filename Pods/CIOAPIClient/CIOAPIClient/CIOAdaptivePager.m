@@ -0,0 +1,189 @@
+//
+//  CIOAdaptivePager.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOAdaptivePager.h"
+#import "CIOAPIClientHeader.h"
+
+// Weight kept by older pages each time a new one is measured, so the fit follows the link as it changes
+static const double CIOAdaptivePagerForgettingFactor = 0.7;
+// Pages never grow by more than this factor at once, to confirm a fast link before betting a big page on it
+static const double CIOAdaptivePagerMaximumGrowth = 2.0;
+
+@interface CIOAdaptivePager ()
+
+@property (nonatomic, copy) CIOArrayRequest * (^requestFactory)(void);
+@property (readwrite, nonatomic) NSInteger pageSize;
+@property (readwrite, nonatomic) NSInteger offset;
+@property (readwrite, nonatomic) BOOL hasMorePages;
+@property (readwrite, nonatomic, getter=isLoading) BOOL loading;
+@property (readwrite, nonatomic) NSTimeInterval expectedPageLatency;
+// Bumped by -reset so responses to pages of an earlier run are dropped
+@property (nonatomic) NSUInteger generation;
+// Requests of the pages being fetched, for -cancel
+@property (nonatomic) NSMutableSet *runningRequests;
+
+@end
+
+@implementation CIOAdaptivePager {
+    // Exponentially weighted sums for the least squares fit latency = overhead + perItem * items
+    double _weight;
+    double _sumItems;
+    double _sumItemsSquared;
+    double _sumLatency;
+    double _sumItemsLatency;
+}
+
+- (instancetype)init {
+    [NSException raise:NSInternalInconsistencyException
+                format:@"%@ must be constructed with a request factory", NSStringFromClass([self class])];
+    return nil;
+}
+
+- (instancetype)initWithRequestFactory:(CIOArrayRequest * (^)(void))requestFactory {
+    if ((self = [super init])) {
+        self.requestFactory = requestFactory;
+        _initialPageSize = 10;
+        _minimumPageSize = 5;
+        _maximumPageSize = 100;
+        _targetPageLatency = 0.8;
+        self.pageSize = _initialPageSize;
+        self.expectedPageLatency = _targetPageLatency;
+        self.hasMorePages = YES;
+        self.runningRequests = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (void)setInitialPageSize:(NSInteger)initialPageSize {
+    _initialPageSize = initialPageSize;
+    if (self.offset == 0 && !self.loading) {
+        self.pageSize = [self clampedPageSize:initialPageSize];
+    }
+}
+
+- (NSInteger)clampedPageSize:(double)pageSize {
+    return (NSInteger)MAX((double)self.minimumPageSize, MIN((double)self.maximumPageSize, floor(pageSize)));
+}
+
+- (void)skipToOffset:(NSInteger)offset {
+    if (self.loading) {
+        return;
+    }
+    self.offset = offset;
+}
+
+- (void)reset {
+    self.generation++;
+    self.loading = NO;
+    self.offset = 0;
+    self.hasMorePages = YES;
+    self.pageSize = [self clampedPageSize:self.initialPageSize];
+}
+
+- (void)cancel {
+    for (CIOArrayRequest *request in [self.runningRequests copy]) {
+        [request cancel];
+    }
+}
+
+- (void)fetchNextPageWithSuccess:(void (^)(NSArray *))success failure:(void (^)(NSError *))failure {
+    if (self.loading || !self.hasMorePages) {
+        return;
+    }
+    NSInteger limit = self.pageSize;
+    NSUInteger generation = self.generation;
+    self.loading = YES;
+    __weak CIOAdaptivePager *weakSelf = self;
+    [self executePageAtOffset:self.offset limit:limit success:^(NSArray *page) {
+        CIOAdaptivePager *strongSelf = weakSelf;
+        if (strongSelf == nil || strongSelf.generation != generation) {
+            return;
+        }
+        strongSelf.loading = NO;
+        strongSelf.offset += (NSInteger)page.count;
+        strongSelf.hasMorePages = (NSInteger)page.count >= limit;
+        if (success) {
+            success(page);
+        }
+    } failure:^(NSError *error) {
+        CIOAdaptivePager *strongSelf = weakSelf;
+        if (strongSelf == nil || strongSelf.generation != generation) {
+            return;
+        }
+        strongSelf.loading = NO;
+        if (failure) {
+            failure(error);
+        }
+    }];
+}
+
+- (void)fetchPageAtOffset:(NSInteger)offset success:(void (^)(NSArray *))success failure:(void (^)(NSError *))failure {
+    [self executePageAtOffset:offset limit:self.pageSize success:success failure:failure];
+}
+
+- (void)executePageAtOffset:(NSInteger)offset
+                      limit:(NSInteger)limit
+                    success:(void (^)(NSArray *))success
+                    failure:(void (^)(NSError *))failure {
+    CIOArrayRequest *request = self.requestFactory();
+    request.limit = limit;
+    request.offset = offset;
+
+    [self.runningRequests addObject:request];
+    NSTimeInterval startedAt = [NSDate timeIntervalSinceReferenceDate];
+    __weak CIOAdaptivePager *weakSelf = self;
+    [request executeWithSuccess:^(NSArray *page) {
+        CIOAdaptivePager *strongSelf = weakSelf;
+        [strongSelf.runningRequests removeObject:request];
+        if (page.count > 0) {
+            [strongSelf recordPageOfSize:(NSInteger)page.count latency:[NSDate timeIntervalSinceReferenceDate] - startedAt];
+        }
+        if (success) {
+            success(page);
+        }
+    } failure:^(NSError *error) {
+        [weakSelf.runningRequests removeObject:request];
+        if (failure) {
+            failure(error);
+        }
+    }];
+}
+
+- (void)recordPageOfSize:(NSInteger)items latency:(NSTimeInterval)latency {
+    double n = (double)items;
+    _weight = _weight * CIOAdaptivePagerForgettingFactor + 1.0;
+    _sumItems = _sumItems * CIOAdaptivePagerForgettingFactor + n;
+    _sumItemsSquared = _sumItemsSquared * CIOAdaptivePagerForgettingFactor + n * n;
+    _sumLatency = _sumLatency * CIOAdaptivePagerForgettingFactor + latency;
+    _sumItemsLatency = _sumItemsLatency * CIOAdaptivePagerForgettingFactor + n * latency;
+
+    double overhead = 0;
+    double perItem = latency / n;
+    // The two costs can only be told apart once pages of different sizes have been seen
+    double denominator = _weight * _sumItemsSquared - _sumItems * _sumItems;
+    if (denominator > 1e-6 * _weight * _sumItemsSquared) {
+        double slope = (_weight * _sumItemsLatency - _sumItems * _sumLatency) / denominator;
+        double intercept = (_sumLatency - slope * _sumItems) / _weight;
+        if (slope > 0 && intercept >= 0) {
+            perItem = slope;
+            overhead = intercept;
+        }
+    }
+
+    double target = self.targetPageLatency;
+    double ideal = target > overhead ? (target - overhead) / perItem : 0;
+    double next;
+    if (latency > target) {
+        next = MIN(ideal, n * target / latency);
+    } else {
+        next = MIN(ideal, n * CIOAdaptivePagerMaximumGrowth);
+    }
+    self.pageSize = [self clampedPageSize:next];
+    self.expectedPageLatency = overhead + perItem * (double)self.pageSize;
+}
+
+@end
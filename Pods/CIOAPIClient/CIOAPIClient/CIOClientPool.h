@@ -0,0 +1,84 @@
+//
+//  CIOClientPool.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CIOAPISession;
+@class CIORequest;
+@class CIOV2Client;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  `CIOClientPool` manages one `CIOV2Client` per account for an application that works with many mailboxes at once.
+ *
+ *  All clients of a pool share a single `CIOAPISession`, and with it one `NSURLSession` connection pool, as well as the
+ * process wide OAuth signer cache. Clients that have been idle for `idleTimeout` are evicted, and the pool never holds
+ * more than `maxClients` of them. An evicted client that is still referenced somewhere is taken back when its account
+ * is asked for or used again, so there is never more than one client per account.
+ *
+ *  Every request executed on a pooled client, e.g. with `-[CIODictionaryRequest executeWithSuccess:failure:]`, goes
+ * through the pool and is scheduled fairly: every account has its own queue and accounts take turns whenever a
+ * connection frees up, so a large sync of one mailbox cannot starve the others. Requests are signed when they are
+ * dispatched, not when they are queued, so waiting in the queue never ages a signature.
+ */
+@interface CIOClientPool : NSObject
+
+@property (readonly, nonatomic) CIOAPISession *session;
+
+/**
+ *  Seconds a client without queued or running requests is kept before it is evicted. Defaults to 300.
+ */
+@property (nonatomic) NSTimeInterval idleTimeout;
+
+/**
+ *  Maximum number of clients kept. When a new account exceeds it, the least recently used idle client is evicted.
+ * Defaults to 256.
+ */
+@property (nonatomic) NSUInteger maxClients;
+
+/**
+ *  Maximum number of requests running across all accounts. Defaults to 16.
+ */
+@property (nonatomic) NSUInteger maxConcurrentRequests;
+
+/**
+ *  Maximum number of requests running for a single account. Defaults to 4.
+ */
+@property (nonatomic) NSUInteger maxConcurrentRequestsPerAccount;
+
+- (instancetype)initWithConsumerKey:(NSString *)consumerKey
+                     consumerSecret:(NSString *)consumerSecret NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Returns the client for `accountID`, creating it with `token` and `tokenSecret` if the pool has none.
+ */
+- (CIOV2Client *)clientForAccountID:(NSString *)accountID token:(NSString *)token tokenSecret:(NSString *)tokenSecret;
+
+/**
+ *  Returns the client for `accountID` if the pool currently holds one.
+ */
+- (nullable CIOV2Client *)clientForAccountID:(NSString *)accountID;
+
+- (void)removeClientForAccountID:(NSString *)accountID;
+
+/**
+ *  Queues `request` behind the other requests of its account. A client not yet in the pool, e.g. a `CIOLiteClient`, is
+ * added to it.
+ *
+ *  @param success called on the main queue with the parsed response object
+ *  @param failure called on the main queue if the request fails
+ */
+- (void)executeRequest:(CIORequest *)request
+               success:(nullable void (^)(id responseObject))success
+               failure:(nullable void (^)(NSError *error))failure;
+
+@end
+
+NS_ASSUME_NONNULL_END
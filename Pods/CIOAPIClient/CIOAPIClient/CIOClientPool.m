@@ -0,0 +1,321 @@
+//
+//  CIOClientPool.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOClientPool.h"
+#import "CIOV2Client.h"
+
+@interface CIOClientPoolRequest : NSObject
+
+@property (nonatomic) CIORequest *request;
+@property (nullable, nonatomic, copy) void (^successBlock)(id responseObject);
+@property (nullable, nonatomic, copy) void (^failureBlock)(NSError *error);
+
+@end
+
+@implementation CIOClientPoolRequest
+
+@end
+
+@interface CIOClientPoolAccount : NSObject
+
+@property (nonatomic) NSString *accountID;
+@property (nonatomic) CIOAPIClient *client;
+@property (nonatomic) NSMutableArray *pendingRequests;
+@property (nonatomic) NSUInteger runningCount;
+@property (nonatomic) NSTimeInterval lastUsed;
+
+@end
+
+@implementation CIOClientPoolAccount
+
+- (BOOL)isIdle {
+    return self.runningCount == 0 && self.pendingRequests.count == 0;
+}
+
+@end
+
+#pragma mark -
+
+@interface CIOClientPool ()
+
+@property (readwrite, nonatomic) CIOAPISession *session;
+@property (nonatomic) NSString *consumerKey;
+@property (nonatomic) NSString *consumerSecret;
+// All of the following must only be read/written on stateQueue.
+@property (nonatomic) dispatch_queue_t stateQueue;
+@property (nonatomic) NSMutableDictionary *accounts;
+// Account ID to clients evicted while someone may still hold them. Taken back instead of creating a second client for
+// the same account.
+@property (nonatomic) NSMapTable *evictedClients;
+// Accounts with pending requests, in the order they get their next turn
+@property (nonatomic) NSMutableArray *readyAccounts;
+@property (nonatomic) NSUInteger runningCount;
+@property (nonatomic) dispatch_source_t evictionTimer;
+
+@end
+
+@implementation CIOClientPool
+
+- (instancetype)init {
+    [NSException raise:NSInternalInconsistencyException
+                format:@"%@ must be constructed with a consumer key and secret.", NSStringFromClass(self.class)];
+    return nil;
+}
+
+- (instancetype)initWithConsumerKey:(NSString *)consumerKey consumerSecret:(NSString *)consumerSecret {
+    if ((self = [super init])) {
+        self.consumerKey = consumerKey;
+        self.consumerSecret = consumerSecret;
+        self.session = [[CIOAPISession alloc] init];
+        self.idleTimeout = 300;
+        self.maxClients = 256;
+        self.maxConcurrentRequests = 16;
+        self.maxConcurrentRequestsPerAccount = 4;
+        self.stateQueue = dispatch_queue_create("io.context.clientpool", DISPATCH_QUEUE_SERIAL);
+        self.accounts = [NSMutableDictionary dictionary];
+        self.evictedClients = [NSMapTable strongToWeakObjectsMapTable];
+        self.readyAccounts = [NSMutableArray array];
+        [self startEvictionTimer];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_evictionTimer) {
+        dispatch_source_cancel(_evictionTimer);
+    }
+}
+
+#pragma mark - Clients
+
+- (CIOV2Client *)clientForAccountID:(NSString *)accountID token:(NSString *)token tokenSecret:(NSString *)tokenSecret {
+    __block CIOV2Client *client = nil;
+    dispatch_sync(self.stateQueue, ^{
+        CIOClientPoolAccount *account = [self accountForID:accountID adoptingClient:nil];
+        if (account == nil) {
+            CIOV2Client *newClient = [[CIOV2Client alloc] initWithConsumerKey:self.consumerKey
+                                                               consumerSecret:self.consumerSecret
+                                                                        token:token
+                                                                  tokenSecret:tokenSecret
+                                                                    accountID:accountID];
+            account = [self accountForID:accountID adoptingClient:newClient];
+        }
+        account.lastUsed = [NSDate timeIntervalSinceReferenceDate];
+        client = [account.client isKindOfClass:[CIOV2Client class]] ? (CIOV2Client *)account.client : nil;
+    });
+    return client;
+}
+
+- (CIOV2Client *)clientForAccountID:(NSString *)accountID {
+    __block CIOV2Client *client = nil;
+    dispatch_sync(self.stateQueue, ^{
+        CIOClientPoolAccount *account = [self accountForID:accountID adoptingClient:nil];
+        account.lastUsed = [NSDate timeIntervalSinceReferenceDate];
+        client = [account.client isKindOfClass:[CIOV2Client class]] ? (CIOV2Client *)account.client : nil;
+    });
+    return client;
+}
+
+- (void)removeClientForAccountID:(NSString *)accountID {
+    dispatch_async(self.stateQueue, ^{
+        // Queued requests keep their account alive until they have run
+        CIOClientPoolAccount *account = self.accounts[accountID];
+        if (account && [account isIdle]) {
+            [self evictAccount:account];
+        }
+    });
+}
+
+// The pooled account for `accountID`. Without one, takes back a client evicted earlier that is still alive, or else
+// `client` if given. Returns nil if there is none of these. Must be called on stateQueue.
+- (CIOClientPoolAccount *)accountForID:(NSString *)accountID adoptingClient:(CIOAPIClient *)client {
+    CIOClientPoolAccount *account = self.accounts[accountID];
+    if (account) {
+        return account;
+    }
+    CIOAPIClient *evictedClient = [self.evictedClients objectForKey:accountID];
+    if (evictedClient) {
+        client = evictedClient;
+        [self.evictedClients removeObjectForKey:accountID];
+    }
+    if (client == nil) {
+        return nil;
+    }
+    [self evictForNewAccount];
+    account = [CIOClientPoolAccount new];
+    account.accountID = accountID;
+    account.pendingRequests = [NSMutableArray array];
+    account.client = client;
+    client.session = self.session;
+    client.clientPool = self;
+    self.accounts[accountID] = account;
+    return account;
+}
+
+// Evicted clients stay usable: their requests still come to the pool, which takes them back in
+- (void)evictAccount:(CIOClientPoolAccount *)account {
+    [self.accounts removeObjectForKey:account.accountID];
+    [self.evictedClients setObject:account.client forKey:account.accountID];
+}
+
+#pragma mark - Eviction
+
+- (void)setIdleTimeout:(NSTimeInterval)idleTimeout {
+    _idleTimeout = idleTimeout;
+    if (self.evictionTimer) {
+        [self scheduleEvictionTimer];
+    }
+}
+
+// Checks twice per timeout, so a client is evicted at most 1.5 timeouts after its last use
+- (void)scheduleEvictionTimer {
+    uint64_t interval = (uint64_t)(MAX(self.idleTimeout / 2, 1.0) * NSEC_PER_SEC);
+    dispatch_source_set_timer(self.evictionTimer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval,
+                              interval / 10);
+}
+
+- (void)startEvictionTimer {
+    self.evictionTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.stateQueue);
+    [self scheduleEvictionTimer];
+    __weak CIOClientPool *weakSelf = self;
+    dispatch_source_set_event_handler(self.evictionTimer, ^{
+        [weakSelf evictIdleClients];
+    });
+    dispatch_resume(self.evictionTimer);
+}
+
+- (void)evictIdleClients {
+    NSTimeInterval cutoff = [NSDate timeIntervalSinceReferenceDate] - self.idleTimeout;
+    for (NSString *accountID in [self.accounts allKeys]) {
+        CIOClientPoolAccount *account = self.accounts[accountID];
+        if ([account isIdle] && account.lastUsed < cutoff) {
+            [self evictAccount:account];
+        }
+    }
+}
+
+// Makes room for one more client by evicting the least recently used idle one. Busy clients are never evicted, so the
+// pool can briefly exceed maxClients when every client has work.
+- (void)evictForNewAccount {
+    if (self.accounts.count < self.maxClients) {
+        return;
+    }
+    CIOClientPoolAccount *oldest = nil;
+    for (CIOClientPoolAccount *account in [self.accounts objectEnumerator]) {
+        if ([account isIdle] && (oldest == nil || account.lastUsed < oldest.lastUsed)) {
+            oldest = account;
+        }
+    }
+    if (oldest) {
+        [self evictAccount:oldest];
+    }
+}
+
+#pragma mark - Scheduling
+
+- (void)executeRequest:(CIORequest *)request
+               success:(void (^)(id))success
+               failure:(void (^)(NSError *))failure {
+    NSString *accountID = request.client.accountID;
+    NSParameterAssert(accountID != nil);
+    CIOClientPoolRequest *poolRequest = [CIOClientPoolRequest new];
+    poolRequest.request = request;
+    poolRequest.successBlock = success;
+    poolRequest.failureBlock = failure;
+
+    dispatch_async(self.stateQueue, ^{
+        // Evicted while the caller held on to the client, or a client new to the pool: take it in
+        CIOClientPoolAccount *account = [self accountForID:accountID adoptingClient:request.client];
+        account.lastUsed = [NSDate timeIntervalSinceReferenceDate];
+        if (account.pendingRequests.count == 0) {
+            [self.readyAccounts addObject:account];
+        }
+        [account.pendingRequests addObject:poolRequest];
+        // Replaced by the client's own handler once the request runs
+        [request setCancellationHandler:^{
+            dispatch_async(self.stateQueue, ^{
+                [self cancelPendingRequest:poolRequest forAccount:account];
+            });
+        }];
+        [self schedule];
+    });
+}
+
+- (void)cancelPendingRequest:(CIOClientPoolRequest *)poolRequest forAccount:(CIOClientPoolAccount *)account {
+    NSUInteger index = [account.pendingRequests indexOfObjectIdenticalTo:poolRequest];
+    if (index == NSNotFound) {
+        // Already running, the client cancels it
+        return;
+    }
+    [account.pendingRequests removeObjectAtIndex:index];
+    if (account.pendingRequests.count == 0) {
+        [self.readyAccounts removeObjectIdenticalTo:account];
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (poolRequest.failureBlock) {
+            poolRequest.failureBlock([NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]);
+        }
+    });
+}
+
+// Round robin over accounts with pending requests: each pass takes one request from the account at the head of
+// readyAccounts and moves that account to the back. Accounts at their own limit are skipped until a request finishes.
+- (void)schedule {
+    NSUInteger skipped = 0;
+    while (self.runningCount < self.maxConcurrentRequests && skipped < self.readyAccounts.count) {
+        CIOClientPoolAccount *account = self.readyAccounts[0];
+        [self.readyAccounts removeObjectAtIndex:0];
+        if (account.runningCount >= self.maxConcurrentRequestsPerAccount) {
+            [self.readyAccounts addObject:account];
+            skipped++;
+            continue;
+        }
+        skipped = 0;
+        CIOClientPoolRequest *poolRequest = account.pendingRequests[0];
+        [account.pendingRequests removeObjectAtIndex:0];
+        if (account.pendingRequests.count > 0) {
+            [self.readyAccounts addObject:account];
+        }
+        [self run:poolRequest forAccount:account];
+    }
+}
+
+- (void)run:(CIOClientPoolRequest *)poolRequest forAccount:(CIOClientPoolAccount *)account {
+    account.runningCount++;
+    self.runningCount++;
+    void (^finished)() = ^{
+        dispatch_async(self.stateQueue, ^{
+            account.runningCount--;
+            account.lastUsed = [NSDate timeIntervalSinceReferenceDate];
+            self.runningCount--;
+            [self schedule];
+        });
+    };
+    CIOAPIClient *client = account.client;
+    // Signed off stateQueue so the scheduler never waits on HMACs or on credentials still loading, and only if no
+    // identical GET is in flight already
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [client executeRequest:poolRequest.request
+                          sign:^{
+                              return [client requestForCIORequest:poolRequest.request];
+                          }
+                       success:^(id responseObject) {
+                           if (poolRequest.successBlock) {
+                               poolRequest.successBlock(responseObject);
+                           }
+                           finished();
+                       }
+                       failure:^(NSError *error) {
+                           if (poolRequest.failureBlock) {
+                               poolRequest.failureBlock(error);
+                           }
+                           finished();
+                       }];
+    });
+}
+
+@end
@@ -0,0 +1,83 @@
+//
+//  CIOCredentialStore.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The account ID, OAuth token and token secret of an authorized `CIOAPIClient`, stored and loaded as one unit.
+ */
+@interface CIOCredentials : NSObject
+
+@property (readonly, nonatomic) NSString *accountID;
+@property (readonly, nonatomic) NSString *token;
+@property (readonly, nonatomic) NSString *tokenSecret;
+
+- (instancetype)initWithAccountID:(NSString *)accountID
+                            token:(NSString *)token
+                      tokenSecret:(NSString *)tokenSecret NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/**
+ *  Persistent storage for `CIOCredentials`, keyed by a service name derived from the consumer key. Implementations must be
+ * safe to call from any thread.
+ */
+@protocol CIOCredentialStore <NSObject>
+
+/**
+ *  @return the credentials saved for `service`, or `nil` if there are none
+ */
+- (nullable CIOCredentials *)credentialsForService:(NSString *)service;
+
+/**
+ *  Saves `credentials` for `service`, replacing what was there.
+ *
+ *  @return `YES` if the credentials were written
+ */
+- (BOOL)saveCredentials:(CIOCredentials *)credentials forService:(NSString *)service;
+
+- (void)deleteCredentialsForService:(NSString *)service;
+
+@end
+
+#if defined(__APPLE__)
+
+/**
+ *  Stores each credential triple as a single keychain item and keeps what it has read in memory, so a client costs at most
+ * one keychain lookup per process. Triples saved by earlier versions as three separate items are migrated on first read.
+ */
+@interface CIOKeychainCredentialStore : NSObject <CIOCredentialStore>
+
+@end
+
+#endif
+
+/**
+ *  Stores each credential triple as a property list readable only by the current user, one file per service, and keeps
+ * what it has read in memory. This is the default store on platforms without a keychain.
+ */
+@interface CIOFileCredentialStore : NSObject <CIOCredentialStore>
+
+@property (readonly, nonatomic) NSURL *directoryURL;
+
+/**
+ *  @param directoryURL directory holding the credential files, created on first save
+ */
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  A store in a "ContextIO" directory under the user's application support directory.
+ */
+- (instancetype)init;
+
+@end
+
+NS_ASSUME_NONNULL_END
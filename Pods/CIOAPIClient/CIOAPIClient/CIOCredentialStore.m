@@ -0,0 +1,304 @@
+//
+//  CIOCredentialStore.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOCredentialStore.h"
+#if defined(__APPLE__)
+#import <SSKeychain/SSKeychain.h>
+#endif
+#import <errno.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+// Keys of the serialized credential dictionary
+static NSString *const kCIOCredentialsAccountIDKey = @"account_id";
+static NSString *const kCIOCredentialsTokenKey = @"token";
+static NSString *const kCIOCredentialsTokenSecretKey = @"token_secret";
+
+@implementation CIOCredentials
+
+- (instancetype)init {
+    [NSException raise:NSInternalInconsistencyException
+                format:@"%@ must be constructed with an account ID, token and secret.", NSStringFromClass(self.class)];
+    return nil;
+}
+
+- (instancetype)initWithAccountID:(NSString *)accountID token:(NSString *)token tokenSecret:(NSString *)tokenSecret {
+    if ((self = [super init])) {
+        _accountID = [accountID copy];
+        _token = [token copy];
+        _tokenSecret = [tokenSecret copy];
+    }
+    return self;
+}
+
++ (instancetype)credentialsWithData:(NSData *)data {
+    if (data == nil) {
+        return nil;
+    }
+    NSDictionary *dictionary = [NSPropertyListSerialization propertyListWithData:data
+                                                                         options:NSPropertyListImmutable
+                                                                          format:NULL
+                                                                           error:NULL];
+    if (![dictionary isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+    NSString *accountID = dictionary[kCIOCredentialsAccountIDKey];
+    NSString *token = dictionary[kCIOCredentialsTokenKey];
+    NSString *tokenSecret = dictionary[kCIOCredentialsTokenSecretKey];
+    if (![accountID isKindOfClass:[NSString class]] || ![token isKindOfClass:[NSString class]] ||
+        ![tokenSecret isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    return [[self alloc] initWithAccountID:accountID token:token tokenSecret:tokenSecret];
+}
+
+- (NSData *)data {
+    NSDictionary *dictionary = @{
+        kCIOCredentialsAccountIDKey: self.accountID,
+        kCIOCredentialsTokenKey: self.token,
+        kCIOCredentialsTokenSecretKey: self.tokenSecret
+    };
+    return [NSPropertyListSerialization dataWithPropertyList:dictionary
+                                                      format:NSPropertyListBinaryFormat_v1_0
+                                                     options:0
+                                                       error:NULL];
+}
+
+@end
+
+#pragma mark -
+
+#if defined(__APPLE__)
+
+// Keychain account of the single item holding the serialized triple
+static NSString *const kCIOCredentialsKeyChainKey = @"kCIOCredentials";
+
+// Keychain accounts of the three items used before the triple was stored as one
+static NSString *const kCIOAccountIDKeyChainKey = @"kCIOAccountID";
+static NSString *const kCIOTokenKeyChainKey = @"kCIOToken";
+static NSString *const kCIOTokenSecretKeyChainKey = @"kCIOTokenSecret";
+
+@interface CIOKeychainCredentialStore ()
+
+// Service name to CIOCredentials, or NSNull when the keychain is known to have none. Guarded by @synchronized(self).
+@property (nonatomic) NSMutableDictionary *cachedCredentials;
+
+@end
+
+@implementation CIOKeychainCredentialStore
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        self.cachedCredentials = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (CIOCredentials *)credentialsForService:(NSString *)service {
+    @synchronized(self) {
+        id cached = self.cachedCredentials[service];
+        if (cached) {
+            return cached == [NSNull null] ? nil : cached;
+        }
+    }
+
+    SSKeychainQuery *query = [SSKeychainQuery new];
+    query.service = service;
+    query.account = kCIOCredentialsKeyChainKey;
+    NSError *error = nil;
+    CIOCredentials *credentials = nil;
+    if ([query fetch:&error]) {
+        credentials = [CIOCredentials credentialsWithData:query.passwordData];
+    } else if (error.code == errSecItemNotFound) {
+        credentials = [self migrateLegacyCredentialsForService:service];
+    } else {
+        // Locked keychain or similar, try again next time rather than remembering there is nothing
+        return nil;
+    }
+
+    @synchronized(self) {
+        self.cachedCredentials[service] = credentials ?: (id)[NSNull null];
+    }
+    return credentials;
+}
+
+- (CIOCredentials *)migrateLegacyCredentialsForService:(NSString *)service {
+    NSString *accountID = [SSKeychain passwordForService:service account:kCIOAccountIDKeyChainKey];
+    if (accountID == nil) {
+        return nil;
+    }
+    NSString *token = [SSKeychain passwordForService:service account:kCIOTokenKeyChainKey];
+    NSString *tokenSecret = [SSKeychain passwordForService:service account:kCIOTokenSecretKeyChainKey];
+    if (token == nil || tokenSecret == nil) {
+        return nil;
+    }
+    CIOCredentials *credentials = [[CIOCredentials alloc] initWithAccountID:accountID token:token tokenSecret:tokenSecret];
+    if ([self writeCredentials:credentials forService:service]) {
+        [self deleteLegacyCredentialsForService:service];
+    }
+    return credentials;
+}
+
+- (void)deleteLegacyCredentialsForService:(NSString *)service {
+    [SSKeychain deletePasswordForService:service account:kCIOAccountIDKeyChainKey];
+    [SSKeychain deletePasswordForService:service account:kCIOTokenKeyChainKey];
+    [SSKeychain deletePasswordForService:service account:kCIOTokenSecretKeyChainKey];
+}
+
+- (BOOL)writeCredentials:(CIOCredentials *)credentials forService:(NSString *)service {
+    SSKeychainQuery *query = [SSKeychainQuery new];
+    query.service = service;
+    query.account = kCIOCredentialsKeyChainKey;
+    query.passwordData = [credentials data];
+    return [query save:NULL];
+}
+
+- (BOOL)saveCredentials:(CIOCredentials *)credentials forService:(NSString *)service {
+    BOOL saved = [self writeCredentials:credentials forService:service];
+    @synchronized(self) {
+        if (saved) {
+            self.cachedCredentials[service] = credentials;
+        } else {
+            [self.cachedCredentials removeObjectForKey:service];
+        }
+    }
+    return saved;
+}
+
+- (void)deleteCredentialsForService:(NSString *)service {
+    [SSKeychain deletePasswordForService:service account:kCIOCredentialsKeyChainKey];
+    [self deleteLegacyCredentialsForService:service];
+    @synchronized(self) {
+        self.cachedCredentials[service] = [NSNull null];
+    }
+}
+
+@end
+
+#endif
+
+#pragma mark -
+
+@interface CIOFileCredentialStore ()
+
+// Service name to CIOCredentials, or NSNull when there is no file. Guarded by @synchronized(self).
+@property (nonatomic) NSMutableDictionary *cachedCredentials;
+
+@end
+
+@implementation CIOFileCredentialStore
+
+- (instancetype)init {
+    NSString *supportDirectory =
+        [NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES) firstObject];
+    if (supportDirectory == nil) {
+        supportDirectory = NSTemporaryDirectory();
+    }
+    NSURL *directoryURL = [NSURL fileURLWithPath:[supportDirectory stringByAppendingPathComponent:@"ContextIO"]
+                                     isDirectory:YES];
+    return [self initWithDirectoryURL:directoryURL];
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL {
+    if ((self = [super init])) {
+        _directoryURL = directoryURL;
+        _cachedCredentials = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSURL *)fileURLForService:(NSString *)service {
+    // Service names are built from consumer keys; keep them from escaping the directory
+    NSString *fileName = [[service componentsSeparatedByCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"/:"]]
+        componentsJoinedByString:@"_"];
+    return [self.directoryURL URLByAppendingPathComponent:[fileName stringByAppendingPathExtension:@"plist"]];
+}
+
+- (CIOCredentials *)credentialsForService:(NSString *)service {
+    @synchronized(self) {
+        id cached = self.cachedCredentials[service];
+        if (cached) {
+            return cached == [NSNull null] ? nil : cached;
+        }
+    }
+
+    NSError *error = nil;
+    NSData *data = [NSData dataWithContentsOfURL:[self fileURLForService:service] options:0 error:&error];
+    if (data == nil && !([error.domain isEqualToString:NSCocoaErrorDomain] && error.code == NSFileReadNoSuchFileError)) {
+        // Unreadable for now, try again next time rather than remembering there is nothing
+        return nil;
+    }
+    CIOCredentials *credentials = [CIOCredentials credentialsWithData:data];
+
+    @synchronized(self) {
+        self.cachedCredentials[service] = credentials ?: (id)[NSNull null];
+    }
+    return credentials;
+}
+
+- (BOOL)saveCredentials:(CIOCredentials *)credentials forService:(NSString *)service {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSDictionary *directoryAttributes = @{NSFilePosixPermissions: @(0700)};
+    if (![fileManager createDirectoryAtURL:self.directoryURL
+               withIntermediateDirectories:YES
+                                attributes:directoryAttributes
+                                     error:NULL]) {
+        return NO;
+    }
+    NSURL *fileURL = [self fileURLForService:service];
+    NSString *temporaryPath = [NSString stringWithFormat:@"%@.%@.tmp", fileURL.path, [NSUUID UUID].UUIDString];
+
+    // Created 0600 so the secret is never readable by others, not even before a chmod; renamed over the old file only
+    // once it is on disk
+    int fd = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return NO;
+    }
+    NSData *data = [credentials data];
+    const uint8_t *bytes = data.bytes;
+    size_t remaining = data.length;
+    BOOL written = YES;
+    while (remaining > 0) {
+        ssize_t count = write(fd, bytes, remaining);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            written = NO;
+            break;
+        }
+        bytes += count;
+        remaining -= (size_t)count;
+    }
+    written = written && fsync(fd) == 0;
+    written = (close(fd) == 0) && written;
+    if (!written || rename(temporaryPath.fileSystemRepresentation, fileURL.path.fileSystemRepresentation) != 0) {
+        unlink(temporaryPath.fileSystemRepresentation);
+        @synchronized(self) {
+            [self.cachedCredentials removeObjectForKey:service];
+        }
+        return NO;
+    }
+    @synchronized(self) {
+        self.cachedCredentials[service] = credentials;
+    }
+    int directory = open(self.directoryURL.path.fileSystemRepresentation, O_RDONLY);
+    if (directory >= 0) {
+        fsync(directory);
+        close(directory);
+    }
+    return YES;
+}
+
+- (void)deleteCredentialsForService:(NSString *)service {
+    [[NSFileManager defaultManager] removeItemAtURL:[self fileURLForService:service] error:NULL];
+    @synchronized(self) {
+        self.cachedCredentials[service] = [NSNull null];
+    }
+}
+
+@end
@@ -0,0 +1,46 @@
+//
+//  CIOCurlTransport.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOTransport.h"
+
+#if defined(__linux__) && defined(CIO_HAVE_LIBCURL)
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  A transport for Linux servers built on the libcurl multi interface, driven by epoll on a single event thread.
+ *
+ *  All transports in a process share DNS and TLS session caches; each transport keeps its own connections. Its requests
+ * to the same host are multiplexed over HTTP/2 connections where the server supports it, so thousands of concurrent
+ * requests need only a handful of sockets. Completion and progress handlers run on a global dispatch queue, never on the event thread. Releasing the
+ * transport cancels its outstanding tasks and ends its event thread.
+ *
+ *  Response header names are given the usual HTTP/1.1 capitalization, e.g. `Content-Type`, also when the server sent
+ * them in lowercase over HTTP/2.
+ *
+ *  Build with `CIO_HAVE_LIBCURL` defined and link against libcurl 7.57 or later.
+ */
+@interface CIOCurlTransport : NSObject <CIOTransport>
+
+/**
+ *  Most connections opened across all hosts. 0, the default, means no limit.
+ */
+@property (readonly, nonatomic) NSUInteger maximumConnections;
+
+- (instancetype)initWithMaximumConnectionsPerHost:(NSUInteger)maximumConnectionsPerHost
+                               maximumConnections:(NSUInteger)maximumConnections NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  A transport with up to 6 connections per host and no overall limit.
+ */
+- (instancetype)init;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
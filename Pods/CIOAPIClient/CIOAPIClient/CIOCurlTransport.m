@@ -0,0 +1,694 @@
+//
+//  CIOCurlTransport.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOCurlTransport.h"
+
+#if defined(__linux__) && defined(CIO_HAVE_LIBCURL)
+
+#import <curl/curl.h>
+#import <errno.h>
+#import <pthread.h>
+#import <stdio.h>
+#import <stdlib.h>
+#import <sys/epoll.h>
+#import <sys/eventfd.h>
+#import <time.h>
+#import <unistd.h>
+
+enum {
+    CIOCurlEpollBatchSize = 64,
+    CIOCurlDefaultMaximumConnectionsPerHost = 6,
+};
+
+#pragma mark - Shared caches
+
+static pthread_mutex_t CIOCurlShareLocks[CURL_LOCK_DATA_LAST];
+
+static void CIOCurlShareLock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    pthread_mutex_lock(&CIOCurlShareLocks[data]);
+}
+
+static void CIOCurlShareUnlock(CURL *handle, curl_lock_data data, void *userptr) {
+    pthread_mutex_unlock(&CIOCurlShareLocks[data]);
+}
+
+// DNS and TLS sessions shared by every transport in the process. Live connections stay with each transport's multi
+// handle: libcurl doesn't support sharing a connection cache between threads, and every transport has its own.
+static CURLSH *CIOCurlSharedCaches(void) {
+    static CURLSH *share = NULL;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        curl_global_init(CURL_GLOBAL_ALL);
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_init(&CIOCurlShareLocks[i], NULL);
+        }
+        share = curl_share_init();
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, CIOCurlShareLock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, CIOCurlShareUnlock);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    });
+    return share;
+}
+
+#pragma mark - Event loop state
+
+// Plain C so the libcurl callbacks never touch Objective-C objects
+typedef struct {
+    CURLM *multi;
+    int epollFD;
+    int wakeFD;
+    int64_t timeoutDeadline; // CLOCK_MONOTONIC milliseconds, -1 when libcurl has no timeout pending
+} CIOCurlLoop;
+
+static int64_t CIOCurlNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int CIOCurlSocketCallback(CURL *easy, curl_socket_t socket, int what, void *userp, void *socketp) {
+    CIOCurlLoop *loop = userp;
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(loop->epollFD, EPOLL_CTL_DEL, socket, NULL);
+        return 0;
+    }
+    struct epoll_event event = {0};
+    event.data.fd = socket;
+    event.events = ((what & CURL_POLL_IN) ? EPOLLIN : 0) | ((what & CURL_POLL_OUT) ? EPOLLOUT : 0);
+    if (epoll_ctl(loop->epollFD, EPOLL_CTL_MOD, socket, &event) != 0 && errno == ENOENT) {
+        epoll_ctl(loop->epollFD, EPOLL_CTL_ADD, socket, &event);
+    }
+    return 0;
+}
+
+static int CIOCurlTimerCallback(CURLM *multi, long timeoutMs, void *userp) {
+    CIOCurlLoop *loop = userp;
+    loop->timeoutDeadline = timeoutMs < 0 ? -1 : CIOCurlNow() + timeoutMs;
+    return 0;
+}
+
+static NSError *CIOCurlError(CURLcode code) {
+    NSInteger errorCode;
+    switch (code) {
+        case CURLE_OPERATION_TIMEDOUT:
+            errorCode = NSURLErrorTimedOut;
+            break;
+        case CURLE_COULDNT_RESOLVE_HOST:
+            errorCode = NSURLErrorCannotFindHost;
+            break;
+        case CURLE_COULDNT_CONNECT:
+            errorCode = NSURLErrorCannotConnectToHost;
+            break;
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_PEER_FAILED_VERIFICATION:
+            errorCode = NSURLErrorSecureConnectionFailed;
+            break;
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+            errorCode = NSURLErrorNetworkConnectionLost;
+            break;
+        case CURLE_TOO_MANY_REDIRECTS:
+            errorCode = NSURLErrorHTTPTooManyRedirects;
+            break;
+        case CURLE_WRITE_ERROR:
+            errorCode = NSURLErrorCannotWriteToFile;
+            break;
+        default:
+            errorCode = NSURLErrorUnknown;
+            break;
+    }
+    return [NSError errorWithDomain:NSURLErrorDomain
+                               code:errorCode
+                           userInfo:@{NSLocalizedDescriptionKey: @(curl_easy_strerror(code))}];
+}
+
+#pragma mark - Tasks
+
+@class CIOCurlTask;
+
+// Owns the multi handle and the event thread. The thread retains the event loop, never the transport, so releasing a
+// transport stops its loop: running tasks are cancelled and the thread exits.
+@interface CIOCurlEventLoop : NSObject
+
+- (instancetype)initWithMaximumConnectionsPerHost:(NSUInteger)maximumConnectionsPerHost
+                               maximumConnections:(NSUInteger)maximumConnections;
+- (void)enqueueTask:(CIOCurlTask *)task;
+- (void)cancelTask:(CIOCurlTask *)task;
+- (void)stop;
+
+@end
+
+@interface CIOCurlTask : NSObject <CIOTransportTask>
+{
+  @public
+    CURL *_easy;
+    struct curl_slist *_headerList;
+    FILE *_file;
+}
+
+@property (nonatomic) CIOCurlEventLoop *eventLoop;
+@property (nonatomic) NSURL *URL;
+@property (nonatomic) NSMutableData *body;
+@property (nonatomic) NSMutableDictionary *headers;
+@property (nullable, nonatomic, copy) CIOTransportDataCompletionBlock dataCompletionBlock;
+@property (nullable, nonatomic, copy) void (^downloadCompletionBlock)(NSError *_Nullable error);
+@property (nullable, nonatomic, copy) CIOTransportProgressBlock progressBlock;
+@property (nullable, nonatomic) NSURL *fileURL;
+@property (nullable, nonatomic) NSString *temporaryPath;
+@property (nonatomic) int64_t reportedBytes;
+// Guarded by @synchronized(self)
+@property (nonatomic) BOOL resumed;
+@property (nonatomic) BOOL finished;
+
+@end
+
+static size_t CIOCurlWriteCallback(char *bytes, size_t size, size_t count, void *userdata) {
+    CIOCurlTask *task = (__bridge CIOCurlTask *)userdata;
+    size_t length = size * count;
+    if (task->_file) {
+        return fwrite(bytes, 1, length, task->_file);
+    }
+    [task.body appendBytes:bytes length:length];
+    return length;
+}
+
+// HTTP/2 sends header names in lowercase. NSHTTPURLResponse only matches names case-insensitively in
+// -valueForHTTPHeaderField:, so names are stored the way HTTP/1.1 servers spell them, e.g. "Content-Type", for lookups in
+// allHeaderFields to work with either protocol.
+static NSString *CIOCurlCanonicalHeaderName(const char *bytes, size_t length) {
+    char name[length];
+    BOOL upper = YES;
+    for (size_t i = 0; i < length; i++) {
+        char c = bytes[i];
+        if (upper && c >= 'a' && c <= 'z') {
+            c = (char)(c - 'a' + 'A');
+        } else if (!upper && c >= 'A' && c <= 'Z') {
+            c = (char)(c - 'A' + 'a');
+        }
+        name[i] = c;
+        upper = (c == '-');
+    }
+    return [[NSString alloc] initWithBytes:name length:length encoding:NSASCIIStringEncoding];
+}
+
+static size_t CIOCurlHeaderCallback(char *bytes, size_t size, size_t count, void *userdata) {
+    CIOCurlTask *task = (__bridge CIOCurlTask *)userdata;
+    size_t length = size * count;
+    if (length >= 5 && memcmp(bytes, "HTTP/", 5) == 0) {
+        // A new status line, e.g. after a redirect or 100 Continue, starts a new set of headers
+        [task.headers removeAllObjects];
+        return length;
+    }
+    const char *colon = memchr(bytes, ':', length);
+    if (colon) {
+        NSString *name = colon > bytes ? CIOCurlCanonicalHeaderName(bytes, (size_t)(colon - bytes)) : nil;
+        NSString *value = [[NSString alloc] initWithBytes:colon + 1
+                                                   length:(NSUInteger)(bytes + length - colon - 1)
+                                                 encoding:NSISOLatin1StringEncoding];
+        value = [value stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+        if (name && value) {
+            // Repeated fields are combined into one, as NSURLSession does
+            NSString *previous = task.headers[name];
+            task.headers[name] = previous ? [NSString stringWithFormat:@"%@, %@", previous, value] : value;
+        }
+    }
+    return length;
+}
+
+static int CIOCurlProgressCallback(void *userdata, curl_off_t downloadTotal, curl_off_t downloadNow,
+                                   curl_off_t uploadTotal, curl_off_t uploadNow) {
+    CIOCurlTask *task = (__bridge CIOCurlTask *)userdata;
+    CIOTransportProgressBlock progressBlock = task.progressBlock;
+    int64_t reported = task.reportedBytes;
+    if (progressBlock && downloadNow > reported) {
+        task.reportedBytes = downloadNow;
+        int64_t expected = downloadTotal > 0 ? downloadTotal : NSURLResponseUnknownLength;
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            progressBlock(downloadNow - reported, downloadNow, expected);
+        });
+    }
+    return 0;
+}
+
+@implementation CIOCurlTask
+
+- (instancetype)initWithRequest:(NSURLRequest *)request eventLoop:(CIOCurlEventLoop *)eventLoop {
+    if ((self = [super init])) {
+        self.eventLoop = eventLoop;
+        self.URL = request.URL;
+        self.body = [NSMutableData data];
+        self.headers = [NSMutableDictionary dictionary];
+
+        _easy = curl_easy_init();
+        curl_easy_setopt(_easy, CURLOPT_URL, request.URL.absoluteString.UTF8String);
+        curl_easy_setopt(_easy, CURLOPT_PRIVATE, (__bridge void *)self);
+        curl_easy_setopt(_easy, CURLOPT_SHARE, CIOCurlSharedCaches());
+        curl_easy_setopt(_easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(_easy, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+        // Wait for an existing connection to multiplex on rather than opening another one
+        curl_easy_setopt(_easy, CURLOPT_PIPEWAIT, 1L);
+        curl_easy_setopt(_easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(_easy, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(_easy, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(_easy, CURLOPT_WRITEFUNCTION, CIOCurlWriteCallback);
+        curl_easy_setopt(_easy, CURLOPT_WRITEDATA, (__bridge void *)self);
+        curl_easy_setopt(_easy, CURLOPT_HEADERFUNCTION, CIOCurlHeaderCallback);
+        curl_easy_setopt(_easy, CURLOPT_HEADERDATA, (__bridge void *)self);
+
+        // NSURLRequest timeouts are idle timeouts, not limits on the whole transfer
+        long timeout = (long)ceil(request.timeoutInterval);
+        if (timeout > 0) {
+            curl_easy_setopt(_easy, CURLOPT_CONNECTTIMEOUT, timeout);
+            curl_easy_setopt(_easy, CURLOPT_LOW_SPEED_LIMIT, 1L);
+            curl_easy_setopt(_easy, CURLOPT_LOW_SPEED_TIME, timeout);
+        }
+
+        NSString *method = request.HTTPMethod ?: @"GET";
+        NSData *body = request.HTTPBody;
+        if (body.length > 0) {
+            curl_easy_setopt(_easy, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)body.length);
+            curl_easy_setopt(_easy, CURLOPT_COPYPOSTFIELDS, body.bytes);
+        }
+        if ([method isEqualToString:@"HEAD"]) {
+            curl_easy_setopt(_easy, CURLOPT_NOBODY, 1L);
+        } else if (![method isEqualToString:@"GET"] || body.length > 0) {
+            curl_easy_setopt(_easy, CURLOPT_CUSTOMREQUEST, method.UTF8String);
+        }
+
+        NSDictionary *headerFields = request.allHTTPHeaderFields;
+        for (NSString *name in headerFields) {
+            NSString *line = [NSString stringWithFormat:@"%@: %@", name, headerFields[name]];
+            _headerList = curl_slist_append(_headerList, line.UTF8String);
+        }
+        // Request bodies are small, skip the 100 Continue round trip
+        _headerList = curl_slist_append(_headerList, "Expect:");
+        curl_easy_setopt(_easy, CURLOPT_HTTPHEADER, _headerList);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_easy) {
+        curl_easy_cleanup(_easy);
+    }
+    curl_slist_free_all(_headerList);
+    if (_file) {
+        fclose(_file);
+    }
+    if (self.temporaryPath) {
+        unlink(self.temporaryPath.fileSystemRepresentation);
+    }
+}
+
+- (BOOL)prepareDownloadToFileURL:(NSURL *)fileURL {
+    NSString *template = [fileURL.path stringByAppendingString:@".download-XXXXXX"];
+    char *path = strdup(template.fileSystemRepresentation);
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        _file = fdopen(fd, "wb");
+        self.temporaryPath = [[NSFileManager defaultManager] stringWithFileSystemRepresentation:path length:strlen(path)];
+    }
+    free(path);
+    if (_file == NULL) {
+        return NO;
+    }
+    self.fileURL = fileURL;
+    curl_easy_setopt(_easy, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(_easy, CURLOPT_XFERINFOFUNCTION, CIOCurlProgressCallback);
+    curl_easy_setopt(_easy, CURLOPT_XFERINFODATA, (__bridge void *)self);
+    return YES;
+}
+
+- (void)resume {
+    @synchronized(self) {
+        if (self.resumed || self.finished) {
+            return;
+        }
+        self.resumed = YES;
+    }
+    [self.eventLoop enqueueTask:self];
+}
+
+- (void)cancel {
+    @synchronized(self) {
+        if (self.finished) {
+            return;
+        }
+        if (!self.resumed) {
+            [self finishWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]];
+            return;
+        }
+    }
+    [self.eventLoop cancelTask:self];
+}
+
+// Called on the event thread once libcurl is done with the handle, or on any thread for failures before that
+- (void)finishWithError:(NSError *)error {
+    @synchronized(self) {
+        if (self.finished) {
+            return;
+        }
+        self.finished = YES;
+    }
+
+    NSHTTPURLResponse *response = nil;
+    if (error == nil) {
+        long statusCode = 0;
+        char *effectiveURL = NULL;
+        long httpVersion = 0;
+        curl_easy_getinfo(_easy, CURLINFO_RESPONSE_CODE, &statusCode);
+        curl_easy_getinfo(_easy, CURLINFO_EFFECTIVE_URL, &effectiveURL);
+        curl_easy_getinfo(_easy, CURLINFO_HTTP_VERSION, &httpVersion);
+        NSURL *URL = effectiveURL ? [NSURL URLWithString:@(effectiveURL)] : self.URL;
+        response = [[NSHTTPURLResponse alloc] initWithURL:URL ?: self.URL
+                                               statusCode:statusCode
+                                              HTTPVersion:httpVersion >= CURL_HTTP_VERSION_2_0 ? @"HTTP/2" : @"HTTP/1.1"
+                                             headerFields:[self.headers copy]];
+    }
+
+    if (_file) {
+        if (fclose(_file) != 0 && error == nil) {
+            error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotWriteToFile userInfo:nil];
+        }
+        _file = NULL;
+        if (error == nil) {
+            NSError *moveError = nil;
+            [[NSFileManager defaultManager] moveItemAtPath:self.temporaryPath toPath:self.fileURL.path error:&moveError];
+            error = moveError;
+        }
+        if (error == nil) {
+            self.temporaryPath = nil;
+        }
+    }
+
+    CIOTransportDataCompletionBlock dataCompletionBlock = self.dataCompletionBlock;
+    void (^downloadCompletionBlock)(NSError *) = self.downloadCompletionBlock;
+    NSData *body = error ? nil : [self.body copy];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        if (dataCompletionBlock) {
+            dataCompletionBlock(body, response, error);
+        }
+        if (downloadCompletionBlock) {
+            downloadCompletionBlock(error);
+        }
+    });
+}
+
+@end
+
+#pragma mark - Event loop
+
+@interface CIOCurlEventLoop ()
+{
+    CIOCurlLoop *_loop;
+    pthread_mutex_t _commandLock;
+}
+
+// Guarded by _commandLock
+@property (nonatomic) NSMutableArray *tasksToAdd;
+@property (nonatomic) NSMutableArray *tasksToCancel;
+@property (nonatomic) BOOL stopped;
+// Tasks added to the multi handle. Only touched on the event thread.
+@property (nonatomic) NSMutableSet *runningTasks;
+
+- (void)run;
+
+@end
+
+static void *CIOCurlEventThreadMain(void *context) {
+    @autoreleasepool {
+        CIOCurlEventLoop *eventLoop = (__bridge_transfer CIOCurlEventLoop *)context;
+        [eventLoop run];
+    }
+    return NULL;
+}
+
+@implementation CIOCurlEventLoop
+
+- (instancetype)initWithMaximumConnectionsPerHost:(NSUInteger)maximumConnectionsPerHost
+                               maximumConnections:(NSUInteger)maximumConnections {
+    if ((self = [super init])) {
+        self.tasksToAdd = [NSMutableArray array];
+        self.tasksToCancel = [NSMutableArray array];
+        self.runningTasks = [NSMutableSet set];
+        pthread_mutex_init(&_commandLock, NULL);
+
+        CIOCurlSharedCaches();
+        _loop = calloc(1, sizeof(CIOCurlLoop));
+        _loop->timeoutDeadline = -1;
+        _loop->epollFD = epoll_create1(EPOLL_CLOEXEC);
+        _loop->wakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_loop->epollFD < 0 || _loop->wakeFD < 0) {
+            [NSException raise:NSInternalInconsistencyException format:@"CIOCurlTransport could not create its event loop (errno %d)", errno];
+        }
+        struct epoll_event wakeEvent = {0};
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.fd = _loop->wakeFD;
+        epoll_ctl(_loop->epollFD, EPOLL_CTL_ADD, _loop->wakeFD, &wakeEvent);
+
+        _loop->multi = curl_multi_init();
+        curl_multi_setopt(_loop->multi, CURLMOPT_SOCKETFUNCTION, CIOCurlSocketCallback);
+        curl_multi_setopt(_loop->multi, CURLMOPT_SOCKETDATA, _loop);
+        curl_multi_setopt(_loop->multi, CURLMOPT_TIMERFUNCTION, CIOCurlTimerCallback);
+        curl_multi_setopt(_loop->multi, CURLMOPT_TIMERDATA, _loop);
+        curl_multi_setopt(_loop->multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(_loop->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)maximumConnectionsPerHost);
+        curl_multi_setopt(_loop->multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)maximumConnections);
+
+        // Balanced by the __bridge_transfer in CIOCurlEventThreadMain, released when -run returns after -stop
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, CIOCurlEventThreadMain, (__bridge_retained void *)self) != 0) {
+            [NSException raise:NSInternalInconsistencyException format:@"CIOCurlTransport could not start its event thread"];
+        }
+        pthread_detach(thread);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_loop) {
+        if (_loop->multi) {
+            curl_multi_cleanup(_loop->multi);
+        }
+        if (_loop->epollFD >= 0) {
+            close(_loop->epollFD);
+        }
+        if (_loop->wakeFD >= 0) {
+            close(_loop->wakeFD);
+        }
+        free(_loop);
+    }
+    pthread_mutex_destroy(&_commandLock);
+}
+
+- (void)wake {
+    uint64_t one = 1;
+    ssize_t written = write(_loop->wakeFD, &one, sizeof(one));
+    (void)written; // EAGAIN means a wakeup is already pending
+}
+
+- (void)enqueueTask:(CIOCurlTask *)task {
+    pthread_mutex_lock(&_commandLock);
+    BOOL stopped = self.stopped;
+    if (!stopped) {
+        [self.tasksToAdd addObject:task];
+    }
+    pthread_mutex_unlock(&_commandLock);
+    if (stopped) {
+        [task finishWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]];
+        return;
+    }
+    [self wake];
+}
+
+- (void)cancelTask:(CIOCurlTask *)task {
+    pthread_mutex_lock(&_commandLock);
+    // Once stopped, the event thread cancels everything it still has
+    BOOL stopped = self.stopped;
+    if (!stopped) {
+        [self.tasksToCancel addObject:task];
+    }
+    pthread_mutex_unlock(&_commandLock);
+    if (!stopped) {
+        [self wake];
+    }
+}
+
+- (void)stop {
+    pthread_mutex_lock(&_commandLock);
+    self.stopped = YES;
+    pthread_mutex_unlock(&_commandLock);
+    [self wake];
+}
+
+// Returns NO once the loop has been stopped
+- (BOOL)processCommands {
+    pthread_mutex_lock(&_commandLock);
+    NSArray *tasksToAdd = [self.tasksToAdd copy];
+    NSArray *tasksToCancel = [self.tasksToCancel copy];
+    [self.tasksToAdd removeAllObjects];
+    [self.tasksToCancel removeAllObjects];
+    BOOL stopped = self.stopped;
+    pthread_mutex_unlock(&_commandLock);
+
+    NSError *cancelled = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+    if (stopped) {
+        for (CIOCurlTask *task in self.runningTasks) {
+            curl_multi_remove_handle(_loop->multi, task->_easy);
+            [task finishWithError:cancelled];
+        }
+        [self.runningTasks removeAllObjects];
+        for (CIOCurlTask *task in tasksToAdd) {
+            [task finishWithError:cancelled];
+        }
+        return NO;
+    }
+
+    for (CIOCurlTask *task in tasksToAdd) {
+        if (task.finished) {
+            continue;
+        }
+        [self.runningTasks addObject:task];
+        curl_multi_add_handle(_loop->multi, task->_easy);
+    }
+    for (CIOCurlTask *task in tasksToCancel) {
+        if ([self.runningTasks containsObject:task]) {
+            curl_multi_remove_handle(_loop->multi, task->_easy);
+            [self.runningTasks removeObject:task];
+        }
+        [task finishWithError:cancelled];
+    }
+    return YES;
+}
+
+- (void)processCompletedTransfers {
+    int remaining = 0;
+    CURLMsg *message;
+    while ((message = curl_multi_info_read(_loop->multi, &remaining))) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        char *private = NULL;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &private);
+        CIOCurlTask *task = (__bridge CIOCurlTask *)(void *)private;
+        CURLcode result = message->data.result;
+        curl_multi_remove_handle(_loop->multi, message->easy_handle);
+        [task finishWithError:result == CURLE_OK ? nil : CIOCurlError(result)];
+        [self.runningTasks removeObject:task];
+    }
+}
+
+- (void)run {
+    struct epoll_event events[CIOCurlEpollBatchSize];
+    int running = 0;
+    for (;;) {
+        @autoreleasepool {
+            int timeout = -1;
+            if (_loop->timeoutDeadline >= 0) {
+                timeout = (int)MAX(MIN(_loop->timeoutDeadline - CIOCurlNow(), (int64_t)INT32_MAX), (int64_t)0);
+            }
+            int count = epoll_wait(_loop->epollFD, events, CIOCurlEpollBatchSize, timeout);
+            if (count < 0 && errno != EINTR) {
+                NSLog(@"CIOCurlTransport: epoll_wait failed (errno %d)", errno);
+                [self stop];
+                [self processCommands];
+                return;
+            }
+
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd == _loop->wakeFD) {
+                    uint64_t value;
+                    ssize_t drained = read(_loop->wakeFD, &value, sizeof(value));
+                    (void)drained;
+                    if (![self processCommands]) {
+                        return;
+                    }
+                    continue;
+                }
+                int flags = 0;
+                if (events[i].events & EPOLLIN) {
+                    flags |= CURL_CSELECT_IN;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    flags |= CURL_CSELECT_OUT;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    flags |= CURL_CSELECT_ERR;
+                }
+                curl_multi_socket_action(_loop->multi, fd, flags, &running);
+            }
+
+            if (_loop->timeoutDeadline >= 0 && CIOCurlNow() >= _loop->timeoutDeadline) {
+                _loop->timeoutDeadline = -1;
+                curl_multi_socket_action(_loop->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+            }
+            [self processCompletedTransfers];
+        }
+    }
+}
+
+@end
+
+#pragma mark - Transport
+
+@interface CIOCurlTransport ()
+
+@property (readwrite, nonatomic) NSUInteger maximumConnectionsPerHost;
+@property (readwrite, nonatomic) NSUInteger maximumConnections;
+@property (nonatomic) CIOCurlEventLoop *eventLoop;
+
+@end
+
+@implementation CIOCurlTransport
+
+- (instancetype)init {
+    return [self initWithMaximumConnectionsPerHost:CIOCurlDefaultMaximumConnectionsPerHost maximumConnections:0];
+}
+
+- (instancetype)initWithMaximumConnectionsPerHost:(NSUInteger)maximumConnectionsPerHost
+                               maximumConnections:(NSUInteger)maximumConnections {
+    if ((self = [super init])) {
+        self.maximumConnectionsPerHost = maximumConnectionsPerHost;
+        self.maximumConnections = maximumConnections;
+        self.eventLoop = [[CIOCurlEventLoop alloc] initWithMaximumConnectionsPerHost:maximumConnectionsPerHost
+                                                                  maximumConnections:maximumConnections];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_eventLoop stop];
+}
+
+#pragma mark - CIOTransport
+
+- (id<CIOTransportTask>)dataTaskWithRequest:(NSURLRequest *)request
+                          completionHandler:(CIOTransportDataCompletionBlock)completionHandler {
+    CIOCurlTask *task = [[CIOCurlTask alloc] initWithRequest:request eventLoop:self.eventLoop];
+    task.dataCompletionBlock = completionHandler;
+    return task;
+}
+
+- (id<CIOTransportTask>)downloadTaskWithRequest:(NSURLRequest *)request
+                                      toFileURL:(NSURL *)fileURL
+                                       progress:(CIOTransportProgressBlock)progressBlock
+                              completionHandler:(void (^)(NSError *))completionHandler {
+    CIOCurlTask *task = [[CIOCurlTask alloc] initWithRequest:request eventLoop:self.eventLoop];
+    task.downloadCompletionBlock = completionHandler;
+    task.progressBlock = progressBlock;
+    if (![task prepareDownloadToFileURL:fileURL]) {
+        [task finishWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotCreateFile userInfo:nil]];
+    }
+    return task;
+}
+
+@end
+
+#endif
@@ -0,0 +1,39 @@
+//
+//  CIOLatencyHistogram.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  A thread-safe histogram of request latencies with logarithmic buckets from 1 ms to about 70 seconds, each 12.5%
+ * wide. Counts are halved whenever `decayThreshold` samples have accumulated, so percentiles follow the latency the
+ * server is showing now rather than over the whole life of the process.
+ */
+@interface CIOLatencyHistogram : NSObject
+
+/**
+ *  Number of samples after which all counts are halved. Defaults to 2000.
+ */
+@property (nonatomic) NSUInteger decayThreshold;
+
+/**
+ *  Number of samples currently counted, after decay.
+ */
+@property (readonly) NSUInteger sampleCount;
+
+- (void)addLatency:(NSTimeInterval)latency;
+
+/**
+ *  Returns the latency below which `percentile` (between 0 and 1) of the samples fall, rounded up to the end of its
+ * bucket, or a negative value when no samples have been counted.
+ */
+- (NSTimeInterval)latencyAtPercentile:(double)percentile;
+
+@end
+
+NS_ASSUME_NONNULL_END
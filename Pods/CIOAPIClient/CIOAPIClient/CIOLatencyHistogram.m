@@ -0,0 +1,87 @@
+//
+//  CIOLatencyHistogram.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOLatencyHistogram.h"
+#import <math.h>
+#import <pthread.h>
+
+enum {
+    CIOLatencyHistogramBucketCount = 96,
+};
+
+// Bucket i covers latencies up to CIOLatencyHistogramBase * CIOLatencyHistogramGrowth^i seconds
+static const double CIOLatencyHistogramBase = 0.001;
+static const double CIOLatencyHistogramGrowth = 1.125;
+
+@implementation CIOLatencyHistogram
+{
+    pthread_mutex_t _lock;
+    uint32_t _counts[CIOLatencyHistogramBucketCount];
+    NSUInteger _sampleCount;
+}
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        pthread_mutex_init(&_lock, NULL);
+        _decayThreshold = 2000;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_lock);
+}
+
+static NSUInteger CIOLatencyHistogramBucket(NSTimeInterval latency) {
+    if (latency <= CIOLatencyHistogramBase) {
+        return 0;
+    }
+    double bucket = ceil(log(latency / CIOLatencyHistogramBase) / log(CIOLatencyHistogramGrowth));
+    return (NSUInteger)MIN(bucket, (double)(CIOLatencyHistogramBucketCount - 1));
+}
+
+- (NSUInteger)sampleCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger count = _sampleCount;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (void)addLatency:(NSTimeInterval)latency {
+    NSUInteger bucket = CIOLatencyHistogramBucket(latency);
+    pthread_mutex_lock(&_lock);
+    _counts[bucket]++;
+    _sampleCount++;
+    if (_sampleCount >= self.decayThreshold) {
+        _sampleCount = 0;
+        for (NSUInteger i = 0; i < CIOLatencyHistogramBucketCount; i++) {
+            _counts[i] /= 2;
+            _sampleCount += _counts[i];
+        }
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSTimeInterval)latencyAtPercentile:(double)percentile {
+    pthread_mutex_lock(&_lock);
+    NSTimeInterval latency = -1;
+    if (_sampleCount > 0) {
+        NSUInteger rank = (NSUInteger)ceil(MAX(MIN(percentile, 1.0), 0.0) * _sampleCount);
+        NSUInteger seen = 0;
+        for (NSUInteger i = 0; i < CIOLatencyHistogramBucketCount; i++) {
+            seen += _counts[i];
+            if (seen >= MAX(rank, (NSUInteger)1)) {
+                latency = CIOLatencyHistogramBase * pow(CIOLatencyHistogramGrowth, (double)i);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&_lock);
+    return latency;
+}
+
+@end
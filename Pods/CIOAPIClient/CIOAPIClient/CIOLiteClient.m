@@ -33,7 +33,7 @@ NSString *const CIOLiteAPIBaseURLString = @"https://api.context.io/lite/";
 }
 
 - (NSString * __nonnull)accountPath {
-    return [@"users" stringByAppendingPathComponent:self.accountID];
+    return [@"users" stringByAppendingPathComponent:self.accountIDPathComponent];
 }
 
 - (NSString * __nonnull)keychainPrefix {
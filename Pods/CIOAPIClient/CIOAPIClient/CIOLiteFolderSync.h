@@ -0,0 +1,142 @@
+//
+//  CIOLiteFolderSync.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CIOLiteClient;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  What syncing one folder found since its last sync.
+ */
+@interface CIOLiteFolderChanges : NSObject
+
+@property (readonly, nonatomic) NSString *folderPath;
+
+/**
+ *  Messages new to the folder, as returned by `-[CIOLiteClient getMessagesForFolderWithPath:accountLabel:]`. All of
+ * them on the first sync.
+ */
+@property (readonly, nonatomic) NSArray *addedMessages;
+
+/**
+ *  `message_id`s of messages no longer in the folder.
+ */
+@property (readonly, nonatomic) NSSet *deletedMessageIDs;
+
+/**
+ *  YES if the folder's message count didn't add up, so all of it was listed to find what was deleted or moved in.
+ */
+@property (readonly, nonatomic) BOOL reconciled;
+
+@end
+
+/**
+ *  `CIOLiteFolderSync` keeps a local copy of an email account's folders up to date, fetching only what changed.
+ *
+ *  Every folder has a watermark: the date of its newest message and the set of its `message_id`s. Lite doesn't expose
+ * IMAP UIDs, so dates stand in for them. A sync lists the folders, then pages each folder newest first only until it
+ * passes its watermark. If the folder's message count then equals the known messages plus the new ones, nothing was
+ * deleted and the folder is done, usually after one small page. Otherwise the whole folder is listed once and
+ * deletions are the difference between the known and the listed sets.
+ *
+ *  Folders sync side by side with one request each, at most `maximumConcurrentFolders` of this sync and at most
+ * `+maximumConcurrentRequests` of all syncs at a time. The watermarks are in `state`; save it after a sync and pass it
+ * to the next `CIOLiteFolderSync` to pick up where this one stopped.
+ *
+ *  A folder sync must only be used from the main thread.
+ */
+@interface CIOLiteFolderSync : NSObject
+
+/**
+ *  Folders to sync. nil, the default, syncs every folder of the account and forgets folders that no longer exist.
+ */
+@property (nullable, nonatomic, copy) NSArray *folderPaths;
+
+/**
+ *  Defaults to 4.
+ */
+@property (nonatomic) NSUInteger maximumConcurrentFolders;
+
+/**
+ *  Folder requests all folder syncs may have in flight together, so syncing several accounts at once doesn't multiply
+ * the load on the API. Defaults to 4.
+ */
++ (NSUInteger)maximumConcurrentRequests;
+
++ (void)setMaximumConcurrentRequests:(NSUInteger)maximumConcurrentRequests;
+
+/**
+ *  Watermarks of every folder synced so far, as a property list.
+ */
+@property (readonly, nonatomic) NSDictionary *state;
+
+@property (readonly, nonatomic, getter=isSyncing) BOOL syncing;
+
+#pragma mark - Progress
+
+/**
+ *  Folders in the running or last sync, and how many of them are done, successfully or not.
+ */
+@property (readonly, nonatomic) NSUInteger folderCount;
+@property (readonly, nonatomic) NSUInteger completedFolderCount;
+
+/**
+ *  Requests made and messages received by the running or last sync, including those listed to reconcile.
+ */
+@property (readonly, nonatomic) NSUInteger requestCount;
+@property (readonly, nonatomic) NSUInteger fetchedMessageCount;
+
+/**
+ *  From 0 to 1. Folders in progress count in proportion to the messages fetched of their count.
+ */
+@property (readonly, nonatomic) double fractionCompleted;
+
+/**
+ *  Messages received per second from the start of the running or last sync until it finished or was cancelled.
+ */
+@property (readonly, nonatomic) double messagesPerSecond;
+
+/**
+ *  Called on the main queue after every page and every folder.
+ */
+@property (nullable, nonatomic, copy) void (^progressHandler)(CIOLiteFolderSync *sync);
+
+/**
+ *  Called on the main queue with the changes of each folder that changed, as soon as it is synced. Folders that
+ * disappeared are reported with all their messages deleted.
+ */
+@property (nullable, nonatomic, copy) void (^changesHandler)(CIOLiteFolderChanges *changes);
+
+/**
+ *  @param client       client of the user whose folders to sync
+ *  @param accountLabel email account to sync, `nil` for the first one
+ *  @param state        `state` of an earlier sync of the same account, or `nil` to start from scratch
+ */
+- (instancetype)initWithClient:(CIOLiteClient *)client
+                  accountLabel:(nullable NSString *)accountLabel
+                         state:(nullable NSDictionary *)state NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Syncs the folders. A folder that fails keeps its old watermark and the others go on. If a sync is already running,
+ * no other one is started and `completion` is called when the running one finishes.
+ *
+ *  @param completion called on the main queue once every folder is done, with the first error if any failed
+ */
+- (void)syncWithCompletion:(nullable void (^)(NSError *_Nullable error))completion;
+
+/**
+ *  Stops the running sync. Folders already done keep their new watermarks; no completion waiting for it is called.
+ */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
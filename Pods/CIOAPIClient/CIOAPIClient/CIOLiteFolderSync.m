@@ -0,0 +1,440 @@
+//
+//  CIOLiteFolderSync.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOLiteFolderSync.h"
+#import "CIOLiteClient.h"
+#import "CIOAdaptivePager.h"
+
+static const NSUInteger CIOLiteFolderSyncDefaultMaximumConcurrentFolders = 4;
+static const NSUInteger CIOLiteFolderSyncDefaultMaximumConcurrentRequests = 4;
+
+static NSString *const CIOLiteWatermarkDateKey = @"date";
+static NSString *const CIOLiteWatermarkIDsKey = @"ids";
+
+static NSString *CIOLiteMessageID(NSDictionary *message) {
+    id messageID = message[@"message_id"] ?: message[@"email_message_id"];
+    return [messageID isKindOfClass:[NSString class]] ? messageID : nil;
+}
+
+@interface CIOLiteFolderChanges ()
+
+@property (readwrite, nonatomic) NSString *folderPath;
+@property (readwrite, nonatomic) NSArray *addedMessages;
+@property (readwrite, nonatomic) NSSet *deletedMessageIDs;
+@property (readwrite, nonatomic) BOOL reconciled;
+
+@end
+
+@implementation CIOLiteFolderChanges
+
+@end
+
+// Hands out the request slots shared by all folder syncs, first come first served. Main thread only.
+@interface CIOLiteFolderSyncLimiter : NSObject
+
+@property (nonatomic) NSUInteger maximumConcurrentRequests;
+@property (nonatomic) NSUInteger runningCount;
+@property (nonatomic) NSMutableArray *waitingBlocks;
+
+@end
+
+@implementation CIOLiteFolderSyncLimiter
+
++ (instancetype)sharedLimiter {
+    static CIOLiteFolderSyncLimiter *sharedLimiter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedLimiter = [[CIOLiteFolderSyncLimiter alloc] init];
+        sharedLimiter.maximumConcurrentRequests = CIOLiteFolderSyncDefaultMaximumConcurrentRequests;
+        sharedLimiter.waitingBlocks = [NSMutableArray array];
+    });
+    return sharedLimiter;
+}
+
+// Runs block once a slot is free, now if one is. Whoever block starts must give the slot back with -releaseSlot.
+- (void)acquireSlot:(dispatch_block_t)block {
+    [self.waitingBlocks addObject:[block copy]];
+    [self startWaitingBlocks];
+}
+
+- (void)releaseSlot {
+    NSParameterAssert(self.runningCount > 0);
+    self.runningCount--;
+    [self startWaitingBlocks];
+}
+
+- (void)startWaitingBlocks {
+    while (self.runningCount < MAX(self.maximumConcurrentRequests, (NSUInteger)1) && self.waitingBlocks.count > 0) {
+        dispatch_block_t block = self.waitingBlocks.firstObject;
+        [self.waitingBlocks removeObjectAtIndex:0];
+        self.runningCount++;
+        block();
+    }
+}
+
+@end
+
+// One folder being synced
+@interface CIOLiteFolderTask : NSObject
+
+@property (nonatomic, copy) NSString *folderPath;
+@property (nullable, nonatomic, copy) NSString *delimiter;
+// From the folder listing, -1 if the folder wasn't listed
+@property (nonatomic) NSInteger messageCount;
+@property (nonatomic) BOOL firstSync;
+@property (nonatomic) NSTimeInterval watermarkDate;
+@property (nonatomic) NSSet *knownIDs;
+@property (nonatomic) NSMutableArray *addedMessages;
+@property (nonatomic) NSMutableSet *addedIDs;
+// Set once the whole folder is being listed, with the IDs it listed so far
+@property (nonatomic) BOOL reconciling;
+@property (nonatomic) NSMutableSet *listedIDs;
+@property (nonatomic) NSTimeInterval newestDate;
+@property (nonatomic) NSUInteger fetchedMessageCount;
+@property (nonatomic) CIOAdaptivePager *pager;
+// Set while the task has a slot of the shared limiter
+@property (nonatomic) BOOL holdsSlot;
+
+@end
+
+@implementation CIOLiteFolderTask
+
+- (void)releaseSlot {
+    if (self.holdsSlot) {
+        self.holdsSlot = NO;
+        [[CIOLiteFolderSyncLimiter sharedLimiter] releaseSlot];
+    }
+}
+
+// Returns NO once page reaches messages older than the watermark, everything past them is known
+- (BOOL)addPage:(NSArray *)page {
+    BOOL passedWatermark = NO;
+    for (NSDictionary *message in page) {
+        NSString *messageID = CIOLiteMessageID(message);
+        NSTimeInterval date = [message[@"date"] doubleValue];
+        self.newestDate = MAX(self.newestDate, date);
+        if (!self.firstSync && date < self.watermarkDate) {
+            passedWatermark = YES;
+        }
+        if (!messageID) {
+            continue;
+        }
+        [self.listedIDs addObject:messageID];
+        // moved in with an old date, or sent at the same second as the watermark
+        if (![self.knownIDs containsObject:messageID] && ![self.addedIDs containsObject:messageID]) {
+            [self.addedIDs addObject:messageID];
+            [self.addedMessages addObject:message];
+        }
+    }
+    self.fetchedMessageCount += page.count;
+    return self.reconciling || !passedWatermark;
+}
+
+@end
+
+@interface CIOLiteFolderSync ()
+
+@property (nonatomic) CIOLiteClient *client;
+@property (nullable, nonatomic, copy) NSString *accountLabel;
+// folder path -> watermark dictionary
+@property (nonatomic) NSMutableDictionary *watermarks;
+@property (readwrite, nonatomic, getter=isSyncing) BOOL syncing;
+@property (readwrite, nonatomic) NSUInteger folderCount;
+@property (readwrite, nonatomic) NSUInteger completedFolderCount;
+@property (readwrite, nonatomic) NSUInteger requestCount;
+@property (readwrite, nonatomic) NSUInteger fetchedMessageCount;
+// Bumped by every sync and cancel, responses of an older generation are dropped
+@property (nonatomic) NSUInteger generation;
+@property (nonatomic) NSMutableArray *pendingTasks;
+@property (nonatomic) NSMutableSet *runningTasks;
+@property (nonatomic) NSTimeInterval startedAt;
+@property (nonatomic) NSTimeInterval finishedAt;
+@property (nullable, nonatomic) NSError *firstError;
+// Completions of the running sync, including those of syncs asked for while it ran
+@property (nonatomic) NSMutableArray *completions;
+
+@end
+
+@implementation CIOLiteFolderSync
+
+- (instancetype)initWithClient:(CIOLiteClient *)client accountLabel:(NSString *)accountLabel state:(NSDictionary *)state {
+    if ((self = [super init])) {
+        _client = client;
+        _accountLabel = [accountLabel copy];
+        _watermarks = [NSMutableDictionary dictionaryWithDictionary:state ?: @{}];
+        _maximumConcurrentFolders = CIOLiteFolderSyncDefaultMaximumConcurrentFolders;
+        _pendingTasks = [NSMutableArray array];
+        _runningTasks = [NSMutableSet set];
+        _completions = [NSMutableArray array];
+    }
+    return self;
+}
+
++ (NSUInteger)maximumConcurrentRequests {
+    return [CIOLiteFolderSyncLimiter sharedLimiter].maximumConcurrentRequests;
+}
+
++ (void)setMaximumConcurrentRequests:(NSUInteger)maximumConcurrentRequests {
+    CIOLiteFolderSyncLimiter *limiter = [CIOLiteFolderSyncLimiter sharedLimiter];
+    limiter.maximumConcurrentRequests = maximumConcurrentRequests;
+    [limiter startWaitingBlocks];
+}
+
+- (NSDictionary *)state {
+    return [self.watermarks copy];
+}
+
+- (double)fractionCompleted {
+    if (self.folderCount == 0) {
+        return self.syncing ? 0 : 1;
+    }
+    double completed = self.completedFolderCount;
+    for (CIOLiteFolderTask *task in self.runningTasks) {
+        if (task.messageCount > 0) {
+            completed += MIN(1.0, (double)task.fetchedMessageCount / task.messageCount);
+        }
+    }
+    return completed / self.folderCount;
+}
+
+- (double)messagesPerSecond {
+    NSTimeInterval endedAt = self.syncing ? [NSDate timeIntervalSinceReferenceDate] : self.finishedAt;
+    NSTimeInterval elapsed = endedAt - self.startedAt;
+    return elapsed > 0 ? self.fetchedMessageCount / elapsed : 0;
+}
+
+#pragma mark - Syncing
+
+- (void)syncWithCompletion:(void (^)(NSError *))completion {
+    if (completion) {
+        [self.completions addObject:[completion copy]];
+    }
+    if (self.syncing) {
+        return;
+    }
+    self.syncing = YES;
+    self.generation++;
+    self.folderCount = 0;
+    self.completedFolderCount = 0;
+    self.requestCount = 1;
+    self.fetchedMessageCount = 0;
+    self.startedAt = [NSDate timeIntervalSinceReferenceDate];
+    self.firstError = nil;
+
+    NSUInteger generation = self.generation;
+    __weak CIOLiteFolderSync *weakSelf = self;
+    [[self.client getFoldersForAccountWithLabel:self.accountLabel includeNamesOnly:NO] executeWithSuccess:^(NSArray *folders) {
+        CIOLiteFolderSync *strongSelf = weakSelf;
+        if (strongSelf == nil || strongSelf.generation != generation) {
+            return;
+        }
+        [strongSelf startTasksForFolders:folders];
+    } failure:^(NSError *error) {
+        CIOLiteFolderSync *strongSelf = weakSelf;
+        if (strongSelf == nil || strongSelf.generation != generation) {
+            return;
+        }
+        [strongSelf finishWithError:error];
+    }];
+}
+
+- (void)cancel {
+    if (self.syncing) {
+        self.finishedAt = [NSDate timeIntervalSinceReferenceDate];
+    }
+    self.generation++;
+    self.syncing = NO;
+    [self.completions removeAllObjects];
+    [self.pendingTasks removeAllObjects];
+    // tasks waiting on a request give their slot back when it completes
+    [self.runningTasks removeAllObjects];
+}
+
+- (void)startTasksForFolders:(NSArray *)folders {
+    NSMutableDictionary *listedFolders = [NSMutableDictionary dictionary];
+    for (NSDictionary *folder in folders) {
+        if ([folder isKindOfClass:[NSDictionary class]] && [folder[@"name"] isKindOfClass:[NSString class]]) {
+            listedFolders[folder[@"name"]] = folder;
+        }
+    }
+
+    if (self.folderPaths == nil) {
+        for (NSString *folderPath in self.watermarks.allKeys) {
+            if (listedFolders[folderPath] == nil) {
+                [self forgetFolderWithPath:folderPath];
+            }
+        }
+    }
+
+    for (NSString *folderPath in self.folderPaths ?: listedFolders.allKeys) {
+        NSDictionary *folder = listedFolders[folderPath];
+        NSDictionary *watermark = self.watermarks[folderPath];
+        CIOLiteFolderTask *task = [[CIOLiteFolderTask alloc] init];
+        task.folderPath = folderPath;
+        task.delimiter = [folder[@"delimiter"] isKindOfClass:[NSString class]] ? folder[@"delimiter"] : nil;
+        task.messageCount = folder[@"nb_messages"] ? [folder[@"nb_messages"] integerValue] : -1;
+        task.firstSync = watermark == nil;
+        task.watermarkDate = [watermark[CIOLiteWatermarkDateKey] doubleValue];
+        task.knownIDs = [NSSet setWithArray:watermark[CIOLiteWatermarkIDsKey] ?: @[]];
+        task.addedMessages = [NSMutableArray array];
+        task.addedIDs = [NSMutableSet set];
+        task.listedIDs = [NSMutableSet set];
+        task.pager = [self pagerForTask:task];
+        [self.pendingTasks addObject:task];
+    }
+    self.folderCount = self.pendingTasks.count;
+    if (self.folderCount == 0) {
+        [self finishWithError:nil];
+        return;
+    }
+    [self startPendingTasks];
+}
+
+- (void)forgetFolderWithPath:(NSString *)folderPath {
+    NSArray *messageIDs = self.watermarks[folderPath][CIOLiteWatermarkIDsKey];
+    [self.watermarks removeObjectForKey:folderPath];
+    if (messageIDs.count > 0 && self.changesHandler) {
+        CIOLiteFolderChanges *changes = [[CIOLiteFolderChanges alloc] init];
+        changes.folderPath = folderPath;
+        changes.addedMessages = @[];
+        changes.deletedMessageIDs = [NSSet setWithArray:messageIDs];
+        self.changesHandler(changes);
+    }
+}
+
+- (CIOAdaptivePager *)pagerForTask:(CIOLiteFolderTask *)task {
+    CIOLiteClient *client = self.client;
+    NSString *accountLabel = self.accountLabel;
+    NSString *folderPath = task.folderPath;
+    NSString *delimiter = task.delimiter;
+    CIOAdaptivePager *pager = [[CIOAdaptivePager alloc] initWithRequestFactory:^CIOArrayRequest *{
+        CIOLiteFolderMessagesRequest *request = [client getMessagesForFolderWithPath:folderPath accountLabel:accountLabel];
+        request.delimiter = delimiter;
+        // paging stops at the watermark, which only works newest first
+        request.sort_order = CIOSortOrderDescending;
+        return request;
+    }];
+    // a whole folder is listed either way, skip the small first pages meant for showing rows quickly
+    if (task.firstSync || task.reconciling) {
+        pager.initialPageSize = pager.maximumPageSize;
+    }
+    return pager;
+}
+
+- (void)startPendingTasks {
+    while (self.runningTasks.count < MAX(self.maximumConcurrentFolders, (NSUInteger)1) && self.pendingTasks.count > 0) {
+        CIOLiteFolderTask *task = self.pendingTasks.firstObject;
+        [self.pendingTasks removeObjectAtIndex:0];
+        [self.runningTasks addObject:task];
+        NSUInteger generation = self.generation;
+        __weak CIOLiteFolderSync *weakSelf = self;
+        [[CIOLiteFolderSyncLimiter sharedLimiter] acquireSlot:^{
+            task.holdsSlot = YES;
+            CIOLiteFolderSync *strongSelf = weakSelf;
+            if (strongSelf == nil || strongSelf.generation != generation) {
+                [task releaseSlot];
+                return;
+            }
+            [strongSelf fetchNextPageOfTask:task];
+        }];
+    }
+}
+
+- (void)fetchNextPageOfTask:(CIOLiteFolderTask *)task {
+    NSUInteger generation = self.generation;
+    __weak CIOLiteFolderSync *weakSelf = self;
+    self.requestCount++;
+    [task.pager fetchNextPageWithSuccess:^(NSArray *page) {
+        CIOLiteFolderSync *strongSelf = weakSelf;
+        if (strongSelf == nil || strongSelf.generation != generation) {
+            [task releaseSlot];
+            return;
+        }
+        strongSelf.fetchedMessageCount += page.count;
+        BOOL wantsMore = [task addPage:page];
+        [strongSelf reportProgress];
+        if (wantsMore && task.pager.hasMorePages) {
+            [strongSelf fetchNextPageOfTask:task];
+        } else {
+            [strongSelf didFetchMessagesOfTask:task];
+        }
+    } failure:^(NSError *error) {
+        CIOLiteFolderSync *strongSelf = weakSelf;
+        if (strongSelf == nil || strongSelf.generation != generation) {
+            [task releaseSlot];
+            return;
+        }
+        [strongSelf finishTask:task error:error];
+    }];
+}
+
+- (void)didFetchMessagesOfTask:(CIOLiteFolderTask *)task {
+    BOOL countsMatch = task.messageCount == (NSInteger)(task.knownIDs.count + task.addedIDs.count);
+    if (!task.firstSync && !task.reconciling && !countsMatch) {
+        // something was deleted, or moved in below the watermark; only a full listing tells which
+        task.reconciling = YES;
+        task.listedIDs = [NSMutableSet set];
+        task.pager = [self pagerForTask:task];
+        [self fetchNextPageOfTask:task];
+        return;
+    }
+    [self finishTask:task error:nil];
+}
+
+- (void)finishTask:(CIOLiteFolderTask *)task error:(NSError *)error {
+    [task releaseSlot];
+    [self.runningTasks removeObject:task];
+    self.completedFolderCount++;
+    if (error) {
+        self.firstError = self.firstError ?: error;
+    } else {
+        NSMutableSet *deletedIDs = [NSMutableSet set];
+        if (task.reconciling) {
+            [deletedIDs unionSet:task.knownIDs];
+            [deletedIDs minusSet:task.listedIDs];
+        }
+        NSMutableSet *messageIDs = [task.knownIDs mutableCopy];
+        [messageIDs unionSet:task.addedIDs];
+        [messageIDs minusSet:deletedIDs];
+        self.watermarks[task.folderPath] = @{CIOLiteWatermarkDateKey: @(MAX(task.watermarkDate, task.newestDate)),
+                                             CIOLiteWatermarkIDsKey: messageIDs.allObjects};
+
+        if ((task.addedMessages.count > 0 || deletedIDs.count > 0) && self.changesHandler) {
+            CIOLiteFolderChanges *changes = [[CIOLiteFolderChanges alloc] init];
+            changes.folderPath = task.folderPath;
+            changes.addedMessages = [task.addedMessages copy];
+            changes.deletedMessageIDs = deletedIDs;
+            changes.reconciled = task.reconciling;
+            self.changesHandler(changes);
+        }
+    }
+    [self reportProgress];
+
+    if (self.runningTasks.count == 0 && self.pendingTasks.count == 0) {
+        [self finishWithError:self.firstError];
+    } else {
+        [self startPendingTasks];
+    }
+}
+
+- (void)finishWithError:(NSError *)error {
+    NSArray *completions = [self.completions copy];
+    [self.completions removeAllObjects];
+    self.finishedAt = [NSDate timeIntervalSinceReferenceDate];
+    self.syncing = NO;
+    for (void (^completion)(NSError *) in completions) {
+        completion(error);
+    }
+}
+
+- (void)reportProgress {
+    if (self.progressHandler) {
+        self.progressHandler(self);
+    }
+}
+
+@end
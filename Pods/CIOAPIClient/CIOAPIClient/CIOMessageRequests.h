@@ -169,6 +169,11 @@
  */
 @property (nullable, strong, nonatomic) NSString *delimiter;
 
+/**
+ *  The sort order of the returned messages, by date.
+ */
+@property (nonatomic) CIOSortOrder sort_order;
+
 /**
  *  Set to `YES` to include message bodies in the result.
  */
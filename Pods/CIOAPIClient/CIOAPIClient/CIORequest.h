@@ -30,6 +30,7 @@ typedef NS_ENUM(NSInteger, CIOAccountStatus) {
 NS_ASSUME_NONNULL_BEGIN
 
 @class CIOAPIClient;
+@class CIORequestFingerprint;
 
 /**
     A single request against the Context.IO API.
@@ -61,6 +62,16 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic) id requestBody;
 
+/**
+ *  Stable 128-bit identity of this request, see `CIORequestFingerprint` for what counts toward it. Computed from the
+ * request's current state on every access. `CIOAPIClient` uses it to send identical GETs only once.
+ */
+@property (readonly, nonatomic) CIORequestFingerprint *fingerprint;
+
+/**
+ *  YES once `cancel` has been called.
+ */
+@property (readonly, getter=isCancelled) BOOL cancelled;
 
 /**
  *  Creates a new `CIORequest` representing a single API call against the Context.IO API.
@@ -82,6 +93,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (nullable NSError *)validateResponseObject:(nullable id)response;
 
+/**
+ *  Stops the request whether it is still queued or already on the wire, and calls its failure block with
+ * `NSURLErrorCancelled`. Identical GETs waiting on the same response are not affected. Does nothing once the request
+ * has finished.
+ */
+- (void)cancel;
+
+/**
+ *  Used by `CIOAPIClient` and `CIOClientPool` to stop the request in whatever stage it is in; each stage replaces the
+ * handler of the one before. Called right away if the request has already been cancelled.
+ */
+- (void)setCancellationHandler:(nullable void (^)(void))cancellationHandler;
+
 @end
 
 /**
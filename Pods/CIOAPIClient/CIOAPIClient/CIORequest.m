@@ -7,8 +7,10 @@
 //
 
 #import "CIORequest.h"
+#import "CIORequestFingerprint.h"
 
 #import <objc/runtime.h>
+#import <pthread.h>
 
 @interface CIORequest ()
 
@@ -19,10 +21,13 @@
 @property (nonatomic) NSString *path;
 @property (nonatomic) NSString *method;
 
-
 @end
 
-@implementation CIORequest
+// Guarded by @synchronized on the request
+@implementation CIORequest {
+    BOOL _cancelled;
+    void (^_cancellationHandler)(void);
+}
 
 + (instancetype)requestWithPath:(NSString *)path method:(NSString *)method parameters:(nullable NSDictionary *)params client:(nullable CIOAPIClient *)client {
     CIORequest *request = [[self alloc] init];
@@ -78,51 +83,210 @@
     return nil;
 }
 
-#pragma mark - KVC Parameter Generation
+// Not cached: limit, offset and the other parameter properties can change until the request is sent
+- (CIORequestFingerprint *)fingerprint {
+    return [CIORequestFingerprint fingerprintWithRequest:self];
+}
 
-- (NSDictionary *)parameters {
-    NSMutableDictionary *parameters = [[self dictionaryWithValuesForKeys:[self.class propertyNames]] mutableCopy];
-    [parameters addEntriesFromDictionary:self.internalParameters];
-    for (NSString *key in [parameters copy]) {
-        if (parameters[key] == [NSNull null]) {
-            [parameters removeObjectForKey:key];
-        } else if ([parameters[key] isKindOfClass:[NSDate class]]) {
-            parameters[key] = @([(NSDate*)parameters[key] timeIntervalSince1970]);
-        } else if ([parameters[key] isKindOfClass:[NSArray class]]) {
-            parameters[key] = [(NSArray *)parameters[key] componentsJoinedByString:@","];
-        } else if ([key isEqualToString:@"sort_order"] && [parameters[key] isKindOfClass:[NSNumber class]]) {
-            CIOSortOrder order = [(NSNumber*)parameters[key] integerValue];
-            if (order == CIOSortOrderAscending) {
-                parameters[key] = @"asc";
-            } else if (order == CIOSortOrderDescending) {
-                parameters[key] = @"desc";
-            } else {
-                [parameters removeObjectForKey:key];
-            }
+#pragma mark - Cancellation
+
+- (BOOL)isCancelled {
+    @synchronized(self) {
+        return _cancelled;
+    }
+}
+
+- (void)cancel {
+    void (^cancellationHandler)(void);
+    @synchronized(self) {
+        if (_cancelled) {
+            return;
         }
+        _cancelled = YES;
+        cancellationHandler = _cancellationHandler;
+        _cancellationHandler = nil;
+    }
+    if (cancellationHandler) {
+        cancellationHandler();
     }
-    return parameters;
 }
 
-+ (NSArray *)propertyNames {
-    unsigned int count = 0;
-    objc_property_t *properties = NULL;
-    Class currentClass = self;
-    NSMutableArray *propertyNames = [NSMutableArray array];
-    while (currentClass != nil && currentClass != [CIORequest class]) {
-        @try {
-            properties = class_copyPropertyList(currentClass, &count);
-            for (int i = 0; i < count; i++) {
-                objc_property_t property = properties[i];
-                NSString *propertyName = [NSString stringWithCString:property_getName(property) encoding:NSUTF8StringEncoding];
-                [propertyNames addObject:propertyName];
+- (void)setCancellationHandler:(void (^)(void))cancellationHandler {
+    @synchronized(self) {
+        if (!_cancelled) {
+            _cancellationHandler = [cancellationHandler copy];
+            return;
+        }
+    }
+    if (cancellationHandler) {
+        cancellationHandler();
+    }
+}
+
+#pragma mark - Parameter Generation
+
+typedef struct {
+    CFStringRef name; // retained for the lifetime of the process, like the class itself
+    SEL getter;
+    IMP implementation;
+    char type;        // first character of the type encoding, 0 when the value is read with -valueForKey:
+    BOOL isSortOrder;
+} CIORequestProperty;
+
+typedef struct {
+    NSUInteger count;
+    CIORequestProperty properties[];
+} CIORequestPropertyList;
+
+// Collects the properties declared on `cls` and its superclasses below CIORequest, each of which becomes a parameter
+static CIORequestPropertyList *CIORequestPropertyListCreate(Class cls) {
+    NSUInteger total = 0;
+    for (Class currentClass = cls; currentClass != nil && currentClass != [CIORequest class];
+         currentClass = [currentClass superclass]) {
+        unsigned int count = 0;
+        free(class_copyPropertyList(currentClass, &count));
+        total += count;
+    }
+
+    CIORequestPropertyList *list = calloc(1, sizeof(CIORequestPropertyList) + total * sizeof(CIORequestProperty));
+    for (Class currentClass = cls; currentClass != nil && currentClass != [CIORequest class];
+         currentClass = [currentClass superclass]) {
+        unsigned int count = 0;
+        objc_property_t *properties = class_copyPropertyList(currentClass, &count);
+        for (unsigned int i = 0; i < count; i++) {
+            CIORequestProperty *property = &list->properties[list->count++];
+            const char *name = property_getName(properties[i]);
+            property->name = CFStringCreateWithCString(NULL, name, kCFStringEncodingUTF8);
+            property->isSortOrder = strcmp(name, "sort_order") == 0;
+
+            char *getterName = property_copyAttributeValue(properties[i], "G");
+            property->getter = sel_registerName(getterName ?: name);
+            free(getterName);
+            property->implementation = class_getMethodImplementation(cls, property->getter);
+
+            // Only types the getter can be called with directly; structs and the like still go through KVC
+            char *encoding = property_copyAttributeValue(properties[i], "T");
+            if (encoding && encoding[0] != '\0' && strchr("@BcCsSiIlLqQfd", encoding[0]) && [cls instancesRespondToSelector:property->getter]) {
+                property->type = encoding[0];
             }
-        } @finally {
-            free(properties);
+            free(encoding);
+        }
+        free(properties);
+    }
+    return list;
+}
+
+static const CIORequestPropertyList *CIORequestPropertyListForClass(Class cls) {
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static CFMutableDictionaryRef propertyLists = NULL;
+
+    pthread_mutex_lock(&lock);
+    if (propertyLists == NULL) {
+        propertyLists = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+    }
+    CIORequestPropertyList *list = (CIORequestPropertyList *)CFDictionaryGetValue(propertyLists, (__bridge void *)cls);
+    if (list == NULL) {
+        list = CIORequestPropertyListCreate(cls);
+        CFDictionarySetValue(propertyLists, (__bridge void *)cls, list);
+    }
+    pthread_mutex_unlock(&lock);
+    return list;
+}
+
+// Converts a parameter value to what is sent to the API, or nil if the parameter should be left out
+static id CIORequestParameterValue(id value, BOOL isSortOrder) {
+    if (value == nil || value == [NSNull null]) {
+        return nil;
+    } else if ([value isKindOfClass:[NSDate class]]) {
+        return @([(NSDate *)value timeIntervalSince1970]);
+    } else if ([value isKindOfClass:[NSArray class]]) {
+        return [(NSArray *)value componentsJoinedByString:@","];
+    } else if (isSortOrder && [value isKindOfClass:[NSNumber class]]) {
+        CIOSortOrder order = [(NSNumber *)value integerValue];
+        if (order == CIOSortOrderAscending) {
+            return @"asc";
+        } else if (order == CIOSortOrderDescending) {
+            return @"desc";
+        }
+        return nil;
+    }
+    return value;
+}
+
+- (NSDictionary *)parameters {
+    const CIORequestPropertyList *list = CIORequestPropertyListForClass(self.class);
+    NSMutableDictionary *parameters =
+        [NSMutableDictionary dictionaryWithCapacity:list->count + self.internalParameters.count];
+
+    for (NSUInteger i = 0; i < list->count; i++) {
+        const CIORequestProperty *property = &list->properties[i];
+        NSString *name = (__bridge NSString *)property->name;
+        SEL getter = property->getter;
+        IMP imp = property->implementation;
+        id value;
+        switch (property->type) {
+            case '@':
+                value = ((id (*)(id, SEL))imp)(self, getter);
+                break;
+            case 'B':
+                value = @(((BOOL (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'c':
+                value = @(((char (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'C':
+                value = @(((unsigned char (*)(id, SEL))imp)(self, getter));
+                break;
+            case 's':
+                value = @(((short (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'S':
+                value = @(((unsigned short (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'i':
+                value = @(((int (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'I':
+                value = @(((unsigned int (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'l':
+                value = @(((long (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'L':
+                value = @(((unsigned long (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'q':
+                value = @(((long long (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'Q':
+                value = @(((unsigned long long (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'f':
+                value = @(((float (*)(id, SEL))imp)(self, getter));
+                break;
+            case 'd':
+                value = @(((double (*)(id, SEL))imp)(self, getter));
+                break;
+            default:
+                value = [self valueForKey:name];
+                break;
+        }
+        value = CIORequestParameterValue(value, property->isSortOrder);
+        if (value) {
+            parameters[name] = value;
         }
-        currentClass = [currentClass superclass];
     }
-    return propertyNames;
+
+    // Explicit parameters win over properties of the same name
+    for (NSString *key in self.internalParameters) {
+        id value = CIORequestParameterValue(self.internalParameters[key], [key isEqualToString:@"sort_order"]);
+        if (value) {
+            parameters[key] = value;
+        } else {
+            [parameters removeObjectForKey:key];
+        }
+    }
+    return parameters;
 }
 
 @end
@@ -0,0 +1,57 @@
+//
+//  CIORequestFingerprint.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CIORequest;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  A fixed size, stable identity for a `CIORequest`: the first 128 bits of a SHA-256 over a canonical form of the request.
+ * Two requests have the same fingerprint exactly when they would hit the same endpoint with the same arguments, so the
+ * fingerprint can key in-memory caches, request de-duplication and persistent stores without comparing `parameters`
+ * dictionaries.
+ *
+ *  What counts toward identity:
+ *
+ *  - the HTTP method, uppercased
+ *  - the path, without leading or trailing slashes
+ *  - every parameter as sent (after `-[CIORequest parameters]` conversions), sorted by name, compared by the string that
+ *    goes on the wire, so `@1` and `@"1"` are the same argument
+ *  - the JSON `requestBody`, with dictionary keys sorted
+ *
+ *  The client, OAuth credentials, nonce and timestamp are never part of the fingerprint. Values are stable across
+ * launches and devices, and may be persisted.
+ */
+@interface CIORequestFingerprint : NSObject <NSCopying, NSSecureCoding>
+
+/**
+ *  Computes the fingerprint of `request` in its current state.
+ */
++ (instancetype)fingerprintWithRequest:(CIORequest *)request;
+
+/**
+ *  Restores a fingerprint from `data`, which must be the 16 bytes returned by `-data`.
+ */
++ (nullable instancetype)fingerprintWithData:(NSData *)data;
+
+/**
+ *  The 16 raw bytes of the fingerprint.
+ */
+@property (readonly, nonatomic) NSData *data;
+
+/**
+ *  The fingerprint as 32 lowercase hex digits, suitable for file names and cache keys.
+ */
+@property (readonly, nonatomic) NSString *stringValue;
+
+- (BOOL)isEqualToFingerprint:(nullable CIORequestFingerprint *)fingerprint;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,200 @@
+//
+//  CIORequestFingerprint.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIORequestFingerprint.h"
+#import "CIORequest.h"
+#import <CommonCrypto/CommonDigest.h>
+
+// Field tags keep e.g. a path from ever hashing like a parameter; every string is length prefixed so neighbouring
+// fields cannot run into each other
+typedef NS_ENUM(uint8_t, CIOFingerprintTag) {
+    CIOFingerprintTagMethod = 'M',
+    CIOFingerprintTagPath = 'P',
+    CIOFingerprintTagParameter = 'K',
+    CIOFingerprintTagBody = 'B',
+    CIOFingerprintTagString = 's',
+    CIOFingerprintTagNumber = 'n',
+    CIOFingerprintTagArray = 'a',
+    CIOFingerprintTagDictionary = 'd',
+    CIOFingerprintTagNull = '0',
+};
+
+static void CIOFingerprintUpdateTag(CC_SHA256_CTX *context, CIOFingerprintTag tag) {
+    CC_SHA256_Update(context, &tag, 1);
+}
+
+static void CIOFingerprintUpdateLength(CC_SHA256_CTX *context, uint64_t length) {
+    uint64_t bigEndian = CFSwapInt64HostToBig(length);
+    CC_SHA256_Update(context, &bigEndian, sizeof(bigEndian));
+}
+
+static void CIOFingerprintUpdateString(CC_SHA256_CTX *context, NSString *string) {
+    uint8_t stackBuffer[256];
+    NSUInteger maxLength = [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    uint8_t *buffer = maxLength > sizeof(stackBuffer) ? malloc(maxLength) : stackBuffer;
+    NSUInteger length = 0;
+    [string getBytes:buffer
+           maxLength:maxLength
+          usedLength:&length
+            encoding:NSUTF8StringEncoding
+             options:0
+               range:NSMakeRange(0, string.length)
+      remainingRange:NULL];
+    CIOFingerprintUpdateLength(context, length);
+    CC_SHA256_Update(context, buffer, (CC_LONG)length);
+    if (buffer != stackBuffer) {
+        free(buffer);
+    }
+}
+
+// Hashes a JSON compatible object tree with dictionary keys in sorted order
+static void CIOFingerprintUpdateJSON(CC_SHA256_CTX *context, id object) {
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSArray *keys = [[(NSDictionary *)object allKeys] sortedArrayUsingSelector:@selector(compare:)];
+        CIOFingerprintUpdateTag(context, CIOFingerprintTagDictionary);
+        CIOFingerprintUpdateLength(context, keys.count);
+        for (id key in keys) {
+            CIOFingerprintUpdateString(context, [key description]);
+            CIOFingerprintUpdateJSON(context, ((NSDictionary *)object)[key]);
+        }
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        CIOFingerprintUpdateTag(context, CIOFingerprintTagArray);
+        CIOFingerprintUpdateLength(context, [(NSArray *)object count]);
+        for (id element in object) {
+            CIOFingerprintUpdateJSON(context, element);
+        }
+    } else if (object == nil || object == [NSNull null]) {
+        CIOFingerprintUpdateTag(context, CIOFingerprintTagNull);
+    } else if ([object isKindOfClass:[NSNumber class]]) {
+        CIOFingerprintUpdateTag(context, CIOFingerprintTagNumber);
+        CIOFingerprintUpdateString(context, [object description]);
+    } else {
+        CIOFingerprintUpdateTag(context, CIOFingerprintTagString);
+        CIOFingerprintUpdateString(context, [object description]);
+    }
+}
+
+static NSString *CIOFingerprintNormalizedPath(NSString *path) {
+    return [path stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"/"]];
+}
+
+@interface CIORequestFingerprint ()
+{
+    uint64_t _words[2];
+}
+
+@end
+
+@implementation CIORequestFingerprint
+
++ (BOOL)supportsSecureCoding {
+    return YES;
+}
+
++ (instancetype)fingerprintWithRequest:(CIORequest *)request {
+    CC_SHA256_CTX context;
+    CC_SHA256_Init(&context);
+
+    CIOFingerprintUpdateTag(&context, CIOFingerprintTagMethod);
+    CIOFingerprintUpdateString(&context, [request.method uppercaseString]);
+    CIOFingerprintUpdateTag(&context, CIOFingerprintTagPath);
+    CIOFingerprintUpdateString(&context, CIOFingerprintNormalizedPath(request.path));
+
+    if (request.requestBody != nil) {
+        // Parameters are ignored when sending a body, so they do not count toward identity either
+        CIOFingerprintUpdateTag(&context, CIOFingerprintTagBody);
+        CIOFingerprintUpdateJSON(&context, request.requestBody);
+    } else {
+        NSDictionary *parameters = request.parameters;
+        NSArray *keys = [[parameters allKeys] sortedArrayUsingSelector:@selector(compare:)];
+        for (NSString *key in keys) {
+            CIOFingerprintUpdateTag(&context, CIOFingerprintTagParameter);
+            CIOFingerprintUpdateString(&context, key);
+            CIOFingerprintUpdateString(&context, [parameters[key] description]);
+        }
+    }
+
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, &context);
+    return [[self alloc] initWithBytes:digest];
+}
+
++ (instancetype)fingerprintWithData:(NSData *)data {
+    if (data.length != sizeof(uint64_t) * 2) {
+        return nil;
+    }
+    return [[self alloc] initWithBytes:data.bytes];
+}
+
+- (instancetype)initWithBytes:(const void *)bytes {
+    if ((self = [super init])) {
+        memcpy(_words, bytes, sizeof(_words));
+    }
+    return self;
+}
+
+- (instancetype)initWithCoder:(NSCoder *)decoder {
+    NSData *data = [decoder decodeObjectOfClass:[NSData class] forKey:@"data"];
+    if (data.length != sizeof(_words)) {
+        return nil;
+    }
+    return [self initWithBytes:data.bytes];
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeObject:self.data forKey:@"data"];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    // Immutable
+    return self;
+}
+
+#pragma mark -
+
+- (NSData *)data {
+    return [NSData dataWithBytes:_words length:sizeof(_words)];
+}
+
+- (NSString *)stringValue {
+    const uint8_t *bytes = (const uint8_t *)_words;
+    char hex[sizeof(_words) * 2];
+    static const char digits[16] = "0123456789abcdef";
+    for (size_t i = 0; i < sizeof(_words); i++) {
+        hex[i * 2] = digits[bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[bytes[i] & 0x0F];
+    }
+    return [[NSString alloc] initWithBytes:hex length:sizeof(hex) encoding:NSASCIIStringEncoding];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %@>", NSStringFromClass(self.class), self.stringValue];
+}
+
+- (NSUInteger)hash {
+    // The digest is already uniformly distributed, any slice of it is a good hash
+    return (NSUInteger)_words[0];
+}
+
+- (BOOL)isEqual:(id)object {
+    if (object == self) {
+        return YES;
+    }
+    if (![object isKindOfClass:[CIORequestFingerprint class]]) {
+        return NO;
+    }
+    return [self isEqualToFingerprint:object];
+}
+
+- (BOOL)isEqualToFingerprint:(CIORequestFingerprint *)fingerprint {
+    if (fingerprint == nil) {
+        return NO;
+    }
+    return _words[0] == fingerprint->_words[0] && _words[1] == fingerprint->_words[1];
+}
+
+@end
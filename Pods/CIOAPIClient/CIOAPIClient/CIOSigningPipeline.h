@@ -0,0 +1,99 @@
+//
+//  CIOSigningPipeline.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CIOAPIClient;
+@class CIORequest;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface NSURLRequest (CIOSignatureExpiration)
+
+/**
+ *  The time after which the OAuth signature of a request produced by `CIOSigningPipeline` should no longer be sent, or
+ * `nil` for requests signed elsewhere.
+ */
+@property (nullable, readonly, nonatomic) NSDate *cio_signatureExpirationDate;
+
+@end
+
+/**
+ *  `CIOSigningPipeline` executes queued requests of a `CIOAPIClient` with signing taken off the sending path. Requests are
+ * signed ahead of time on a pool of worker threads while earlier requests are still in flight, so large batches (for
+ * example flag updates on hundreds of messages) are no longer limited by signing on a single thread.
+ *
+ *  Signing only runs a bounded distance ahead of the requests on the wire. Every signed request carries an expiration
+ * date, and a request whose signature has expired by the time a connection frees up for it is signed again before it is
+ * sent. A GET identical to one the client already has in flight isn't signed at all; it completes with the response of
+ * that request.
+ *
+ *  Callbacks are called on the main queue, like those of `CIOAPIClient`. Changes to the settings below apply from the next
+ * enqueued request on.
+ */
+@interface CIOSigningPipeline : NSObject
+
+@property (readonly, nonatomic) CIOAPIClient *client;
+
+/**
+ *  Maximum number of requests on the wire at once. Defaults to 4, the per host limit of `NSURLSession`.
+ */
+@property (nonatomic) NSUInteger maxConcurrentRequests;
+
+/**
+ *  Number of threads signing requests. Defaults to the number of active processors.
+ */
+@property (nonatomic) NSUInteger maxConcurrentSigners;
+
+/**
+ *  How long a signature stays valid before the request is signed again. Defaults to 120 seconds, well inside the window
+ * OAuth servers accept timestamps in.
+ */
+@property (nonatomic) NSTimeInterval signatureLifetime;
+
+/**
+ *  Number of requests that had to be signed again because they waited longer than `signatureLifetime`.
+ */
+@property (readonly) NSUInteger resignedRequestCount;
+
+- (instancetype)initWithClient:(CIOAPIClient *)client NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Queue a request. Requests are sent roughly in the order they are enqueued.
+ *
+ *  @param request request to execute, any `CIORequest` created by the pipeline's client
+ *  @param success called with the parsed response object
+ *  @param failure called if the request fails or is cancelled
+ */
+- (void)enqueueRequest:(CIORequest *)request
+               success:(nullable void (^)(id responseObject))success
+               failure:(nullable void (^)(NSError *error))failure;
+
+/**
+ *  Queue a batch of requests and get notified when all of them have finished.
+ *
+ *  @param requests   array of `CIORequest`s to execute
+ *  @param success    called for each request that succeeds
+ *  @param failure    called for each request that fails or is cancelled
+ *  @param completion called once after every request in the batch has called `success` or `failure`
+ */
+- (void)executeRequests:(NSArray *)requests
+                success:(nullable void (^)(CIORequest *request, id responseObject))success
+                failure:(nullable void (^)(CIORequest *request, NSError *error))failure
+             completion:(nullable void (^)())completion;
+
+/**
+ *  Fails every request that has not been sent yet with `NSURLErrorCancelled`. Requests already on the wire complete
+ * normally.
+ */
+- (void)cancelAllRequests;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,232 @@
+//
+//  CIOSigningPipeline.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOSigningPipeline.h"
+#import "CIOAPIClientHeader.h"
+
+static NSString *const CIOSignatureExpirationDateKey = @"io.context.signature.expiration";
+
+@implementation NSURLRequest (CIOSignatureExpiration)
+
+- (NSDate *)cio_signatureExpirationDate {
+    return [NSURLProtocol propertyForKey:CIOSignatureExpirationDateKey inRequest:self];
+}
+
+@end
+
+#pragma mark -
+
+@interface CIOSigningPipelineEntry : NSObject
+
+@property (nonatomic) CIORequest *request;
+@property (nullable, nonatomic, copy) void (^successBlock)(id responseObject);
+@property (nullable, nonatomic, copy) void (^failureBlock)(NSError *error);
+@property (nullable, nonatomic) NSURLRequest *signedRequest;
+@property (nonatomic) NSTimeInterval signatureLifetime;
+@property (nonatomic) BOOL cancelled;
+
+@end
+
+@implementation CIOSigningPipelineEntry
+
+@end
+
+#pragma mark -
+
+@interface CIOSigningPipeline ()
+
+@property (readwrite, nonatomic) CIOAPIClient *client;
+@property (readwrite) NSUInteger resignedRequestCount;
+@property (nonatomic) NSOperationQueue *signingQueue;
+// All of the following must only be read/written on stateQueue.
+@property (nonatomic) dispatch_queue_t stateQueue;
+@property (nonatomic) NSMutableArray *waitingEntries;
+@property (nonatomic) NSMutableArray *signedEntries;
+@property (nonatomic) NSMutableSet *signingEntries;
+@property (nonatomic) NSUInteger inFlightCount;
+// Copies of the public settings as of the latest enqueue, the setters are called on the caller's thread
+@property (nonatomic) NSUInteger stateMaxConcurrentRequests;
+@property (nonatomic) NSUInteger stateMaxConcurrentSigners;
+
+@end
+
+@implementation CIOSigningPipeline
+
+- (instancetype)init {
+    [NSException raise:NSInternalInconsistencyException
+                format:@"%@ must be constructed with a client.", NSStringFromClass(self.class)];
+    return nil;
+}
+
+- (instancetype)initWithClient:(CIOAPIClient *)client {
+    if ((self = [super init])) {
+        self.client = client;
+        self.signingQueue = [NSOperationQueue new];
+        self.signingQueue.name = @"io.context.signing";
+        self.maxConcurrentSigners = [[NSProcessInfo processInfo] activeProcessorCount];
+        self.maxConcurrentRequests = 4;
+        self.signatureLifetime = 120;
+        self.stateQueue = dispatch_queue_create("io.context.signing.state", DISPATCH_QUEUE_SERIAL);
+        self.waitingEntries = [NSMutableArray array];
+        self.signedEntries = [NSMutableArray array];
+        self.signingEntries = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (NSUInteger)maxConcurrentSigners {
+    return (NSUInteger)self.signingQueue.maxConcurrentOperationCount;
+}
+
+- (void)setMaxConcurrentSigners:(NSUInteger)maxConcurrentSigners {
+    self.signingQueue.maxConcurrentOperationCount = (NSInteger)MAX(maxConcurrentSigners, (NSUInteger)1);
+}
+
+#pragma mark -
+
+- (void)enqueueRequest:(CIORequest *)request
+               success:(void (^)(id))success
+               failure:(void (^)(NSError *))failure {
+    CIOSigningPipelineEntry *entry = [CIOSigningPipelineEntry new];
+    entry.request = request;
+    entry.successBlock = success;
+    entry.failureBlock = failure;
+    entry.signatureLifetime = self.signatureLifetime;
+    NSUInteger maxConcurrentRequests = self.maxConcurrentRequests;
+    NSUInteger maxConcurrentSigners = self.maxConcurrentSigners;
+    dispatch_async(self.stateQueue, ^{
+        self.stateMaxConcurrentRequests = maxConcurrentRequests;
+        self.stateMaxConcurrentSigners = maxConcurrentSigners;
+        [self.waitingEntries addObject:entry];
+        [self _pump];
+    });
+}
+
+- (void)executeRequests:(NSArray *)requests
+                success:(void (^)(CIORequest *, id))success
+                failure:(void (^)(CIORequest *, NSError *))failure
+             completion:(void (^)())completion {
+    dispatch_group_t group = dispatch_group_create();
+    for (CIORequest *request in requests) {
+        dispatch_group_enter(group);
+        [self enqueueRequest:request success:^(id responseObject) {
+            if (success) {
+                success(request, responseObject);
+            }
+            dispatch_group_leave(group);
+        } failure:^(NSError *error) {
+            if (failure) {
+                failure(request, error);
+            }
+            dispatch_group_leave(group);
+        }];
+    }
+    if (completion) {
+        dispatch_group_notify(group, dispatch_get_main_queue(), completion);
+    }
+}
+
+- (void)cancelAllRequests {
+    dispatch_async(self.stateQueue, ^{
+        NSMutableArray *cancelled = [NSMutableArray arrayWithArray:self.waitingEntries];
+        [cancelled addObjectsFromArray:self.signedEntries];
+        [self.waitingEntries removeAllObjects];
+        [self.signedEntries removeAllObjects];
+        // Entries still being signed are dropped when their signature comes back
+        for (CIOSigningPipelineEntry *entry in self.signingEntries) {
+            entry.cancelled = YES;
+            [cancelled addObject:entry];
+        }
+        NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            for (CIOSigningPipelineEntry *entry in cancelled) {
+                if (entry.failureBlock) {
+                    entry.failureBlock(error);
+                }
+            }
+        });
+    });
+}
+
+#pragma mark - Pipeline
+
+// Sends signed requests while connections are free, then tops up the signers. Signing stays at most a few requests
+// ahead of sending, so signatures do not age in the queue and a long batch does not hold thousands of signed requests.
+- (void)_pump {
+    while (self.inFlightCount < self.stateMaxConcurrentRequests && self.signedEntries.count > 0) {
+        CIOSigningPipelineEntry *entry = self.signedEntries[0];
+        [self.signedEntries removeObjectAtIndex:0];
+        NSDate *expirationDate = entry.signedRequest.cio_signatureExpirationDate;
+        if (expirationDate && [expirationDate timeIntervalSinceNow] <= 0) {
+            self.resignedRequestCount++;
+            [self _sign:entry];
+            continue;
+        }
+        [self _send:entry];
+    }
+
+    NSUInteger signAhead = self.stateMaxConcurrentRequests + self.stateMaxConcurrentSigners;
+    while (self.waitingEntries.count > 0 && self.signingEntries.count < self.stateMaxConcurrentSigners &&
+           self.signingEntries.count + self.signedEntries.count < signAhead) {
+        CIOSigningPipelineEntry *entry = self.waitingEntries[0];
+        [self.waitingEntries removeObjectAtIndex:0];
+        // An identical GET is already on the wire; its response completes this one too, without signing it
+        if ([self.client joinInFlightRequest:entry.request success:entry.successBlock failure:entry.failureBlock]) {
+            continue;
+        }
+        [self _sign:entry];
+    }
+}
+
+- (void)_sign:(CIOSigningPipelineEntry *)entry {
+    [self.signingEntries addObject:entry];
+    NSTimeInterval lifetime = entry.signatureLifetime;
+    NSBlockOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
+        // nil if the request can't be signed; it is still sent, so the client fails it with an error
+        NSMutableURLRequest *signedRequest = [[self.client requestForCIORequest:entry.request] mutableCopy];
+        if (signedRequest) {
+            [NSURLProtocol setProperty:[NSDate dateWithTimeIntervalSinceNow:lifetime]
+                                forKey:CIOSignatureExpirationDateKey
+                             inRequest:signedRequest];
+        }
+        dispatch_async(self.stateQueue, ^{
+            [self.signingEntries removeObject:entry];
+            if (!entry.cancelled) {
+                entry.signedRequest = signedRequest;
+                [self.signedEntries addObject:entry];
+            }
+            [self _pump];
+        });
+    }];
+    [self.signingQueue addOperation:operation];
+}
+
+- (void)_send:(CIOSigningPipelineEntry *)entry {
+    self.inFlightCount++;
+    void (^finished)() = ^{
+        dispatch_async(self.stateQueue, ^{
+            self.inFlightCount--;
+            [self _pump];
+        });
+    };
+    [self.client executeSignedRequest:entry.signedRequest
+                           forRequest:entry.request
+                              success:^(id responseObject) {
+                                  if (entry.successBlock) {
+                                      entry.successBlock(responseObject);
+                                  }
+                                  finished();
+                              }
+                              failure:^(NSError *error) {
+                                  if (entry.failureBlock) {
+                                      entry.failureBlock(error);
+                                  }
+                                  finished();
+                              }];
+}
+
+@end
@@ -0,0 +1,82 @@
+//
+//  CIOTransport.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef void (^CIOTransportDataCompletionBlock)(NSData *_Nullable data, NSURLResponse *_Nullable response,
+                                                NSError *_Nullable error);
+
+typedef void (^CIOTransportProgressBlock)(int64_t bytesRead, int64_t totalBytesRead, int64_t totalBytesExpectedToRead);
+
+/**
+ *  A request handed out by a `CIOTransport`. Nothing is sent until `resume` is called.
+ */
+@protocol CIOTransportTask <NSObject>
+
+- (void)resume;
+
+/**
+ *  Stops the request. Its completion handler is called with an `NSURLErrorCancelled` error unless it has already run.
+ */
+- (void)cancel;
+
+@end
+
+/**
+ *  Moves HTTP requests for `CIOAPISession`. Implementations must be safe to call from any thread and call completion
+ * and progress handlers on a background queue; the session takes care of getting back to the main queue.
+ */
+@protocol CIOTransport <NSObject>
+
+/**
+ *  Most connections the transport opens to a single host.
+ */
+@property (readonly) NSUInteger maximumConnectionsPerHost;
+
+/**
+ *  Creates a task that loads `request` into memory.
+ */
+- (id<CIOTransportTask>)dataTaskWithRequest:(NSURLRequest *)request
+                          completionHandler:(CIOTransportDataCompletionBlock)completionHandler;
+
+/**
+ *  Creates a task that saves the body of the response to `request` at `fileURL`. The download fails if a file already
+ * exists there.
+ */
+- (id<CIOTransportTask>)downloadTaskWithRequest:(NSURLRequest *)request
+                                      toFileURL:(NSURL *)fileURL
+                                       progress:(nullable CIOTransportProgressBlock)progressBlock
+                              completionHandler:(void (^)(NSError *_Nullable error))completionHandler;
+
+@end
+
+/**
+ *  `NSURLSessionTask` is used as is by `CIOURLSessionTransport`.
+ */
+@interface NSURLSessionTask (CIOTransportTask) <CIOTransportTask>
+
+@end
+
+/**
+ *  The default transport on Apple platforms, backed by an `NSURLSession` with the default configuration.
+ */
+@interface CIOURLSessionTransport : NSObject <CIOTransport>
+
+@property (readonly, nonatomic) NSURLSession *urlSession;
+
+- (instancetype)initWithConfiguration:(NSURLSessionConfiguration *)configuration NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  A transport using `+[NSURLSessionConfiguration defaultSessionConfiguration]`.
+ */
+- (instancetype)init;
+
+@end
+
+NS_ASSUME_NONNULL_END
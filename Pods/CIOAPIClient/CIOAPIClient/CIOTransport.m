@@ -0,0 +1,125 @@
+//
+//  CIOTransport.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOTransport.h"
+
+@implementation NSURLSessionTask (CIOTransportTask)
+
+@end
+
+#pragma mark -
+
+@interface CIODownloadTask : NSObject
+
+@property (nullable, nonatomic) NSURL *saveToURL;
+@property (nullable, nonatomic, copy) CIOTransportProgressBlock progressBlock;
+@property (nullable, nonatomic, copy) void (^completionBlock)(NSError *_Nullable error);
+@property (nonatomic) BOOL completed;
+
+@end
+
+@implementation CIODownloadTask
+
+@end
+
+#pragma mark -
+
+@interface CIOURLSessionTransport () <NSURLSessionDownloadDelegate>
+
+@property (readwrite, nonatomic) NSURLSession *urlSession;
+// Mapping from Task ID to CIODownloadTask. Guarded by @synchronized on itself.
+@property (nonatomic) NSMutableDictionary *downloadTaskIDToCIOTask;
+
+@end
+
+@implementation CIOURLSessionTransport
+
+- (instancetype)init {
+    return [self initWithConfiguration:[NSURLSessionConfiguration defaultSessionConfiguration]];
+}
+
+- (instancetype)initWithConfiguration:(NSURLSessionConfiguration *)configuration {
+    if ((self = [super init])) {
+        self.urlSession = [NSURLSession sessionWithConfiguration:configuration delegate:self delegateQueue:nil];
+        self.downloadTaskIDToCIOTask = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSUInteger)maximumConnectionsPerHost {
+    return (NSUInteger)self.urlSession.configuration.HTTPMaximumConnectionsPerHost;
+}
+
+- (id<CIOTransportTask>)dataTaskWithRequest:(NSURLRequest *)request
+                          completionHandler:(CIOTransportDataCompletionBlock)completionHandler {
+    return [self.urlSession dataTaskWithRequest:request completionHandler:completionHandler];
+}
+
+- (id<CIOTransportTask>)downloadTaskWithRequest:(NSURLRequest *)request
+                                      toFileURL:(NSURL *)fileURL
+                                       progress:(CIOTransportProgressBlock)progressBlock
+                              completionHandler:(void (^)(NSError *))completionHandler {
+    NSURLSessionDownloadTask *downloadTask = [self.urlSession downloadTaskWithRequest:request];
+    CIODownloadTask *cioTask = [CIODownloadTask new];
+    cioTask.saveToURL = fileURL;
+    cioTask.completionBlock = completionHandler;
+    cioTask.progressBlock = progressBlock;
+    @synchronized(self.downloadTaskIDToCIOTask) {
+        self.downloadTaskIDToCIOTask[@(downloadTask.taskIdentifier)] = cioTask;
+    }
+    return downloadTask;
+}
+
+- (CIODownloadTask *)cioTaskForTask:(NSURLSessionTask *)task remove:(BOOL)remove {
+    @synchronized(self.downloadTaskIDToCIOTask) {
+        CIODownloadTask *cioTask = self.downloadTaskIDToCIOTask[@(task.taskIdentifier)];
+        if (remove) {
+            [self.downloadTaskIDToCIOTask removeObjectForKey:@(task.taskIdentifier)];
+        }
+        return cioTask;
+    }
+}
+
+#pragma mark - NSURLSessionTaskDelegate
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
+    CIODownloadTask *cioTask = [self cioTaskForTask:task remove:YES];
+    if (cioTask && !cioTask.completed && cioTask.completionBlock) {
+        cioTask.completionBlock(error);
+    }
+}
+
+#pragma mark - NSURLSessionDownloadDelegate
+
+- (void)URLSession:(NSURLSession *)session
+                 downloadTask:(NSURLSessionDownloadTask *)downloadTask
+                 didWriteData:(int64_t)bytesWritten
+            totalBytesWritten:(int64_t)totalBytesWritten
+    totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite {
+    CIODownloadTask *cioTask = [self cioTaskForTask:downloadTask remove:NO];
+    if (cioTask.progressBlock) {
+        cioTask.progressBlock(bytesWritten, totalBytesWritten, totalBytesExpectedToWrite);
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session
+                 downloadTask:(NSURLSessionDownloadTask *)downloadTask
+    didFinishDownloadingToURL:(NSURL *)location {
+    CIODownloadTask *cioTask = [self cioTaskForTask:downloadTask remove:NO];
+    if (cioTask.saveToURL) {
+        NSError *error = nil;
+        [[NSFileManager defaultManager] moveItemAtURL:location toURL:cioTask.saveToURL error:&error];
+        if (error) {
+            cioTask.completed = YES;
+            if (cioTask.completionBlock) {
+                cioTask.completionBlock(error);
+            }
+        }
+    }
+}
+
+@end
@@ -0,0 +1,96 @@
+//
+//  CIOWebhookReceiver.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Path the receiver accepts WebHook callbacks on. Append it to the URL the receiver is reachable at to get the
+ * `callbackURL` for `-[CIOLiteClient createWebhookWithCallbackURL:failureURL:]`.
+ */
+extern NSString *const CIOWebhookReceiverCallbackPath;
+
+/**
+ *  Path the receiver accepts failure notifications on, see `CIOWebhookReceiverCallbackPath`.
+ */
+extern NSString *const CIOWebhookReceiverFailurePath;
+
+/**
+ *  `CIOWebhookReceiver` is a small embeddable HTTP listener for Context.IO WebHooks, so an app or server can be told about
+ * new messages instead of polling for them.
+ *
+ *  Every POST is verified before it is handed on: its `signature` must be the HMAC-SHA256 of `timestamp` and `token`
+ * keyed with the consumer secret, its `timestamp` must be within `maximumAge` of now, and a `token` seen before is
+ * acknowledged but not delivered again. Anything else is answered with an error status and dropped.
+ *
+ *  The receiver speaks plain HTTP/1.1 with one request per connection. Put it behind a TLS terminating proxy or tunnel
+ * when it is reachable from outside the device or host.
+ */
+@interface CIOWebhookReceiver : NSObject
+
+/**
+ *  The port the receiver listens on, 0 while it is stopped.
+ */
+@property (readonly, nonatomic) uint16_t port;
+
+/**
+ *  How far a payload's `timestamp` may be from now, in seconds. Defaults to 300.
+ */
+@property (nonatomic) NSTimeInterval maximumAge;
+
+/**
+ *  Largest request body accepted, in bytes. Defaults to 1 MB; message bodies are only included if the WebHook was
+ * created with `include_body`.
+ */
+@property (nonatomic) NSUInteger maximumBodyLength;
+
+/**
+ *  Most connections open at once. Connections accepted past it are answered 503 and closed straight away, so a flood
+ * of idle connections can't use up the process's file descriptors. Defaults to 32.
+ */
+@property (nonatomic) NSUInteger maximumConnections;
+
+/**
+ *  Called on the main queue with each verified callback payload. The new message is under its `message_data` key.
+ */
+@property (nullable, nonatomic, copy) void (^callbackHandler)(NSDictionary *payload);
+
+/**
+ *  Called on the main queue with each verified failure notification. The WebHook is inactive until it is set to active
+ * again with `-[CIOLiteClient setWebhookID:toActive:]`.
+ */
+@property (nullable, nonatomic, copy) void (^failureHandler)(NSDictionary *payload);
+
+- (instancetype)initWithConsumerSecret:(NSString *)consumerSecret NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Starts listening on all interfaces.
+ *
+ *  @param port  port to listen on, or 0 for any free port, see `port`
+ *  @param error set if the port could not be opened
+ *
+ *  @return NO if the receiver could not start
+ */
+- (BOOL)startOnPort:(uint16_t)port error:(NSError **)error;
+
+/**
+ *  Stops listening and closes open connections. Payloads already verified are still delivered.
+ */
+- (void)stop;
+
+/**
+ *  The signature Context.IO sends with a payload: the hex encoded HMAC-SHA256 of `timestamp` followed by `token`,
+ * keyed with the consumer secret.
+ */
++ (NSString *)signatureForTimestamp:(long long)timestamp token:(NSString *)token consumerSecret:(NSString *)consumerSecret;
+
+@end
+
+NS_ASSUME_NONNULL_END
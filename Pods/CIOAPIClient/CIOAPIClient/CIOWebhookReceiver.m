@@ -0,0 +1,369 @@
+//
+//  CIOWebhookReceiver.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOWebhookReceiver.h"
+#import <CommonCrypto/CommonHMAC.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <netinet/in.h>
+#import <sys/socket.h>
+#import <unistd.h>
+
+NSString *const CIOWebhookReceiverCallbackPath = @"/webhooks/callback";
+NSString *const CIOWebhookReceiverFailurePath = @"/webhooks/failure";
+
+enum {
+    CIOWebhookListenBacklog = 16,
+    CIOWebhookMaximumHeaderLength = 8192,
+    CIOWebhookReadLength = 16384,
+};
+
+static const NSTimeInterval CIOWebhookDefaultMaximumAge = 300;
+static const NSUInteger CIOWebhookDefaultMaximumBodyLength = 1024 * 1024;
+static const NSUInteger CIOWebhookDefaultMaximumConnections = 32;
+// Connections that haven't sent a whole request by then are closed, so idle ones can't pile up
+static const NSTimeInterval CIOWebhookConnectionTimeout = 10;
+
+#ifdef MSG_NOSIGNAL
+static const int CIOWebhookSendFlags = MSG_NOSIGNAL;
+#else
+static const int CIOWebhookSendFlags = 0;
+#endif
+
+static NSString *CIOWebhookReasonPhrase(NSInteger status) {
+    switch (status) {
+        case 200: return @"OK";
+        case 400: return @"Bad Request";
+        case 401: return @"Unauthorized";
+        case 404: return @"Not Found";
+        case 405: return @"Method Not Allowed";
+        case 411: return @"Length Required";
+        case 413: return @"Payload Too Large";
+        case 431: return @"Request Header Fields Too Large";
+        case 503: return @"Service Unavailable";
+        default: return @"Error";
+    }
+}
+
+// Compares every character so the time taken says nothing about how much of a forged signature was right
+static BOOL CIOWebhookSignaturesEqual(NSString *signature, NSString *otherSignature) {
+    NSData *bytes = [signature dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *otherBytes = [otherSignature dataUsingEncoding:NSUTF8StringEncoding];
+    if (bytes.length != otherBytes.length) {
+        return NO;
+    }
+    const uint8_t *a = bytes.bytes;
+    const uint8_t *b = otherBytes.bytes;
+    uint8_t difference = 0;
+    for (NSUInteger i = 0; i < bytes.length; i++) {
+        difference |= a[i] ^ b[i];
+    }
+    return difference == 0;
+}
+
+// An accepted socket and what it has sent so far
+@interface CIOWebhookConnection : NSObject
+
+@property (nonatomic) int fd;
+@property (nonatomic) dispatch_source_t source;
+@property (nonatomic) NSMutableData *buffer;
+
+@end
+
+@implementation CIOWebhookConnection
+
+@end
+
+@interface CIOWebhookReceiver ()
+
+@property (readwrite, nonatomic) uint16_t port;
+@property (nonatomic, copy) NSString *consumerSecret;
+// Sockets are read and requests verified here
+@property (nonatomic) dispatch_queue_t queue;
+@property (nullable, nonatomic) dispatch_source_t listenSource;
+@property (nonatomic) NSMutableSet *connections;
+// token -> timestamp of payloads already delivered. Anything older than maximumAge is rejected anyway.
+@property (nonatomic) NSMutableDictionary *deliveredTokens;
+
+@end
+
+@implementation CIOWebhookReceiver
+
+- (instancetype)initWithConsumerSecret:(NSString *)consumerSecret {
+    if ((self = [super init])) {
+        _consumerSecret = [consumerSecret copy];
+        _maximumAge = CIOWebhookDefaultMaximumAge;
+        _maximumBodyLength = CIOWebhookDefaultMaximumBodyLength;
+        _maximumConnections = CIOWebhookDefaultMaximumConnections;
+        _queue = dispatch_queue_create("io.context.webhookreceiver", DISPATCH_QUEUE_SERIAL);
+        _connections = [NSMutableSet set];
+        _deliveredTokens = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self cancelSources];
+}
+
+- (BOOL)startOnPort:(uint16_t)port error:(NSError **)error {
+    [self stop];
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    socklen_t addressLength = sizeof(address);
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, CIOWebhookListenBacklog) != 0 ||
+        getsockname(fd, (struct sockaddr *)&address, &addressLength) != 0 || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+        int code = errno;
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (error) {
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:code userInfo:nil];
+        }
+        return NO;
+    }
+
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)fd, 0, self.queue);
+    __weak CIOWebhookReceiver *weakSelf = self;
+    dispatch_source_set_event_handler(source, ^{
+        [weakSelf acceptConnectionsOnSocket:fd];
+    });
+    dispatch_source_set_cancel_handler(source, ^{
+        close(fd);
+    });
+    dispatch_sync(self.queue, ^{
+        self.listenSource = source;
+    });
+    self.port = ntohs(address.sin_port);
+    dispatch_resume(source);
+    return YES;
+}
+
+- (void)stop {
+    dispatch_sync(self.queue, ^{
+        [self cancelSources];
+    });
+    self.port = 0;
+}
+
+- (void)cancelSources {
+    if (self.listenSource) {
+        dispatch_source_cancel(self.listenSource);
+        self.listenSource = nil;
+    }
+    for (CIOWebhookConnection *connection in self.connections) {
+        dispatch_source_cancel(connection.source);
+    }
+    [self.connections removeAllObjects];
+}
+
+#pragma mark - Connections
+
+- (void)acceptConnectionsOnSocket:(int)listenFD {
+    __weak CIOWebhookReceiver *weakSelf = self;
+    int fd;
+    while ((fd = accept(listenFD, NULL, NULL)) >= 0) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+        int noSignal = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+        // left in the backlog they would wake this handler again right away, turn them down instead
+        if (self.connections.count >= self.maximumConnections) {
+            [self respondWithStatus:503 onSocket:fd];
+            close(fd);
+            continue;
+        }
+        CIOWebhookConnection *connection = [[CIOWebhookConnection alloc] init];
+        connection.fd = fd;
+        connection.buffer = [NSMutableData data];
+        connection.source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)fd, 0, self.queue);
+        __weak CIOWebhookConnection *weakConnection = connection;
+        dispatch_source_set_event_handler(connection.source, ^{
+            [weakSelf readFromConnection:weakConnection];
+        });
+        dispatch_source_set_cancel_handler(connection.source, ^{
+            close(fd);
+        });
+        [self.connections addObject:connection];
+        dispatch_resume(connection.source);
+
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(CIOWebhookConnectionTimeout * NSEC_PER_SEC)), self.queue, ^{
+            [weakSelf closeConnection:weakConnection];
+        });
+    }
+}
+
+- (void)readFromConnection:(CIOWebhookConnection *)connection {
+    if (!connection) {
+        return;
+    }
+    uint8_t bytes[CIOWebhookReadLength];
+    BOOL ended = NO;
+    for (;;) {
+        ssize_t count = read(connection.fd, bytes, sizeof(bytes));
+        if (count > 0) {
+            [connection.buffer appendBytes:bytes length:(NSUInteger)count];
+            // no need to keep reading what will be refused anyway
+            if (connection.buffer.length > CIOWebhookMaximumHeaderLength + self.maximumBodyLength) {
+                break;
+            }
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+            break;
+        }
+        if (count < 0) {
+            [self closeConnection:connection];
+            return;
+        }
+        // end of file: the sender may have half-closed after a complete request, which still gets its answer
+        ended = YES;
+        break;
+    }
+
+    NSInteger status = [self statusForRequest:connection.buffer];
+    if (status != 0) {
+        [self respondWithStatus:status onSocket:connection.fd];
+    }
+    // closed once answered, or when the sender closed before finishing its request
+    if (status != 0 || ended) {
+        [self closeConnection:connection];
+    }
+}
+
+- (void)respondWithStatus:(NSInteger)status onSocket:(int)fd {
+    NSString *response = [NSString stringWithFormat:@"HTTP/1.1 %ld %@\r\nContent-Length: 0\r\nConnection: close\r\n\r\n",
+                          (long)status, CIOWebhookReasonPhrase(status)];
+    NSData *data = [response dataUsingEncoding:NSASCIIStringEncoding];
+    // a status line always fits in the empty send buffer of a fresh connection
+    send(fd, data.bytes, data.length, CIOWebhookSendFlags);
+}
+
+- (void)closeConnection:(CIOWebhookConnection *)connection {
+    if (connection && [self.connections containsObject:connection]) {
+        dispatch_source_cancel(connection.source);
+        [self.connections removeObject:connection];
+    }
+}
+
+#pragma mark - Requests
+
+// Returns the status to answer request with, or 0 while it is incomplete
+- (NSInteger)statusForRequest:(NSData *)request {
+    NSData *separator = [@"\r\n\r\n" dataUsingEncoding:NSASCIIStringEncoding];
+    NSRange headerEnd = [request rangeOfData:separator options:0 range:NSMakeRange(0, request.length)];
+    if (headerEnd.location == NSNotFound) {
+        return request.length > CIOWebhookMaximumHeaderLength ? 431 : 0;
+    }
+    NSString *header = [[NSString alloc] initWithData:[request subdataWithRange:NSMakeRange(0, headerEnd.location)]
+                                             encoding:NSISOLatin1StringEncoding];
+    NSArray *lines = [header componentsSeparatedByString:@"\r\n"];
+    NSArray *requestLine = [lines.firstObject componentsSeparatedByString:@" "];
+    if (requestLine.count != 3) {
+        return 400;
+    }
+    if (![requestLine[0] isEqualToString:@"POST"]) {
+        return 405;
+    }
+
+    long long contentLength = -1;
+    for (NSString *line in [lines subarrayWithRange:NSMakeRange(1, lines.count - 1)]) {
+        NSRange colon = [line rangeOfString:@":"];
+        if (colon.location != NSNotFound &&
+            [[line substringToIndex:colon.location] caseInsensitiveCompare:@"Content-Length"] == NSOrderedSame) {
+            contentLength = [[line substringFromIndex:NSMaxRange(colon)] longLongValue];
+        }
+    }
+    if (contentLength < 0) {
+        return 411;
+    }
+    if ((unsigned long long)contentLength > self.maximumBodyLength) {
+        return 413;
+    }
+    NSUInteger bodyStart = NSMaxRange(headerEnd);
+    if (request.length < bodyStart + (NSUInteger)contentLength) {
+        return 0;
+    }
+
+    NSString *path = [requestLine[1] componentsSeparatedByString:@"?"].firstObject;
+    BOOL failure = [path isEqualToString:CIOWebhookReceiverFailurePath];
+    if (!failure && ![path isEqualToString:CIOWebhookReceiverCallbackPath]) {
+        return 404;
+    }
+    NSData *body = [request subdataWithRange:NSMakeRange(bodyStart, (NSUInteger)contentLength)];
+    NSDictionary *payload = [NSJSONSerialization JSONObjectWithData:body options:0 error:NULL];
+    if (![payload isKindOfClass:[NSDictionary class]]) {
+        return 400;
+    }
+    if (![self verifyPayload:payload]) {
+        return 401;
+    }
+    // a retry of a payload already delivered, acknowledge it so it stops
+    if (![self recordDeliveryOfPayload:payload]) {
+        return 200;
+    }
+
+    void (^handler)(NSDictionary *) = failure ? self.failureHandler : self.callbackHandler;
+    if (handler) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            handler(payload);
+        });
+    }
+    return 200;
+}
+
+- (BOOL)verifyPayload:(NSDictionary *)payload {
+    id token = payload[@"token"];
+    id signature = payload[@"signature"];
+    id timestamp = payload[@"timestamp"];
+    if (![token isKindOfClass:[NSString class]] || ![signature isKindOfClass:[NSString class]] ||
+        !([timestamp isKindOfClass:[NSNumber class]] || [timestamp isKindOfClass:[NSString class]])) {
+        return NO;
+    }
+    long long seconds = [timestamp longLongValue];
+    if (fabs([[NSDate date] timeIntervalSince1970] - (NSTimeInterval)seconds) > self.maximumAge) {
+        return NO;
+    }
+    NSString *expected = [CIOWebhookReceiver signatureForTimestamp:seconds token:token consumerSecret:self.consumerSecret];
+    return CIOWebhookSignaturesEqual(expected, [signature lowercaseString]);
+}
+
+// Returns NO if the payload's token was delivered before
+- (BOOL)recordDeliveryOfPayload:(NSDictionary *)payload {
+    NSTimeInterval oldest = [[NSDate date] timeIntervalSince1970] - self.maximumAge;
+    for (NSString *token in self.deliveredTokens.allKeys) {
+        if ([self.deliveredTokens[token] doubleValue] < oldest) {
+            [self.deliveredTokens removeObjectForKey:token];
+        }
+    }
+    NSString *token = payload[@"token"];
+    if (self.deliveredTokens[token]) {
+        return NO;
+    }
+    self.deliveredTokens[token] = @([payload[@"timestamp"] longLongValue]);
+    return YES;
+}
+
++ (NSString *)signatureForTimestamp:(long long)timestamp token:(NSString *)token consumerSecret:(NSString *)consumerSecret {
+    NSData *key = [consumerSecret dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *message = [[NSString stringWithFormat:@"%lld%@", timestamp, token] dataUsingEncoding:NSUTF8StringEncoding];
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    CCHmac(kCCHmacAlgSHA256, key.bytes, key.length, message.bytes, message.length, digest);
+    NSMutableString *signature = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (NSUInteger i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [signature appendFormat:@"%02x", digest[i]];
+    }
+    return signature;
+}
+
+@end
@@ -0,0 +1,56 @@
+//
+//  CIOWebhookSender.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  `CIOWebhookSender` posts WebHook payloads signed the way Context.IO signs them. It stands in for Context.IO to exercise
+ * a `CIOWebhookReceiver`, or whatever else handles the callbacks, without a live WebHook: in tests, on the simulator,
+ * or while a device is offline.
+ */
+@interface CIOWebhookSender : NSObject
+
+/**
+ *  Sent as `webhook_id` in every payload. Defaults to "local".
+ */
+@property (nonatomic, copy) NSString *webhookID;
+
+/**
+ *  Sent as `account_id` in every payload, if set.
+ */
+@property (nullable, nonatomic, copy) NSString *accountID;
+
+- (instancetype)initWithConsumerSecret:(NSString *)consumerSecret NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  A callback payload for `messageData`, with a fresh token, the current timestamp and their signature.
+ */
+- (NSDictionary *)payloadWithMessageData:(NSDictionary *)messageData;
+
+/**
+ *  POSTs `payload` as JSON to `URL`.
+ *
+ *  @param completion called on the main queue with the HTTP status, or with an error if nothing was received
+ */
+- (void)postPayload:(NSDictionary *)payload
+              toURL:(NSURL *)URL
+         completion:(nullable void (^)(NSInteger statusCode, NSError *_Nullable error))completion;
+
+/**
+ *  Signs a callback payload for `messageData` and POSTs it to `URL`, see `postPayload:toURL:completion:`.
+ */
+- (void)postMessageData:(NSDictionary *)messageData
+                  toURL:(NSURL *)URL
+             completion:(nullable void (^)(NSInteger statusCode, NSError *_Nullable error))completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
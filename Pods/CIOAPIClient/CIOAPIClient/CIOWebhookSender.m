@@ -0,0 +1,70 @@
+//
+//  CIOWebhookSender.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "CIOWebhookSender.h"
+#import "CIOWebhookReceiver.h"
+
+@interface CIOWebhookSender ()
+
+@property (nonatomic, copy) NSString *consumerSecret;
+@property (nonatomic) NSURLSession *session;
+
+@end
+
+@implementation CIOWebhookSender
+
+- (instancetype)initWithConsumerSecret:(NSString *)consumerSecret {
+    if ((self = [super init])) {
+        _consumerSecret = [consumerSecret copy];
+        _webhookID = @"local";
+        _session = [NSURLSession sessionWithConfiguration:[NSURLSessionConfiguration ephemeralSessionConfiguration]];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_session finishTasksAndInvalidate];
+}
+
+- (NSDictionary *)payloadWithMessageData:(NSDictionary *)messageData {
+    long long timestamp = (long long)[[NSDate date] timeIntervalSince1970];
+    NSString *token = [[NSUUID UUID].UUIDString lowercaseString];
+    NSMutableDictionary *payload = [NSMutableDictionary dictionary];
+    payload[@"webhook_id"] = self.webhookID;
+    payload[@"account_id"] = self.accountID;
+    payload[@"timestamp"] = @(timestamp);
+    payload[@"token"] = token;
+    payload[@"signature"] = [CIOWebhookReceiver signatureForTimestamp:timestamp token:token consumerSecret:self.consumerSecret];
+    payload[@"message_data"] = messageData;
+    return payload;
+}
+
+- (void)postPayload:(NSDictionary *)payload
+              toURL:(NSURL *)URL
+         completion:(void (^)(NSInteger, NSError *))completion {
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:URL];
+    request.HTTPMethod = @"POST";
+    [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
+    request.HTTPBody = [NSJSONSerialization dataWithJSONObject:payload options:0 error:NULL];
+    NSURLSessionDataTask *task = [self.session dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        NSInteger statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? ((NSHTTPURLResponse *)response).statusCode : 0;
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(statusCode, error);
+            });
+        }
+    }];
+    [task resume];
+}
+
+- (void)postMessageData:(NSDictionary *)messageData
+                  toURL:(NSURL *)URL
+             completion:(void (^)(NSInteger, NSError *))completion {
+    [self postPayload:[self payloadWithMessageData:messageData] toURL:URL completion:completion];
+}
+
+@end
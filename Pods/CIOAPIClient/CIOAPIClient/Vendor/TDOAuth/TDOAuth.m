@@ -30,22 +30,19 @@
 */
 
 #import "TDOAuth.h"
-#import <CommonCrypto/CommonHMAC.h>
+#import "TDOAuthSigner.h"
+#import "TDOAuthCanonicalizer.h"
+#import "TDOAuthPercentEncoding.h"
+#import "TDOAuthNonce.h"
 #import "OMGUserAgent.h"
 
-#define TDPCEN(s) \
-    ((__bridge_transfer NSString *)CFURLCreateStringByAddingPercentEscapes(NULL, (__bridge CFStringRef)[s description], NULL, CFSTR("!*'();:@&=+$,/?%#[]"), kCFStringEncodingUTF8))
-
-#define TDChomp(s) { \
-    const NSUInteger length = [s length]; \
-    if (length > 0) \
-        [s deleteCharactersInRange:NSMakeRange(length - 1, 1)]; \
-}
+#define TDPCEN(s) TDOAuthPercentEncodeString([s description])
 
 #ifndef TDOAuthURLRequestTimeout
 #define TDOAuthURLRequestTimeout 30.0
 #endif
 
+// Written by whoever calibrates against server time while other threads sign, so always access atomically
 static int TDOAuthUTCTimeOffset = 0;
 /* TDOAUTH_USE_STATIC_VALUES_FOR_AUTOMATIC_TESTING is defined in the XCode project. */
 
@@ -53,22 +50,16 @@ static NSString* nonce() {
 #ifdef TDOAUTH_USE_STATIC_VALUES_FOR_AUTOMATIC_TESTING
     return @"static-nonce-for-testing";
 #else
-    CFUUIDRef uuid = CFUUIDCreate(NULL);
-    CFStringRef s = CFUUIDCreateString(NULL, uuid);
-    CFRelease(uuid);
-    return (__bridge_transfer NSString *)s;
+    return TDOAuthGenerateNonce();
 #endif
 }
 
 static NSString* timestamp() {
-    time_t t;
 #ifdef TDOAUTH_USE_STATIC_VALUES_FOR_AUTOMATIC_TESTING
-    t = 1456789012;
+    return [NSString stringWithFormat:@"%ld", 1456789012L + [TDOAuth utcTimeOffset]];
 #else
-    time(&t);
+    return TDOAuthGenerateTimestamp([TDOAuth utcTimeOffset]);
 #endif
-    mktime(gmtime(&t));
-    return [NSString stringWithFormat:@"%ld", t + TDOAuthUTCTimeOffset];
 }
 
 
@@ -77,9 +68,10 @@ static NSString* timestamp() {
 {
     NSURL *url;
     NSString *signature_secret;
-    TDOAuthSignatureMethod signature_method;
+    TDOAuthSigner *signer; // shared HMAC key schedule for signature_secret
     NSDictionary *oauthParams; // these are pre-percent encoded
-    NSDictionary *params;     // these are pre-percent encoded
+    NSString *signature; // computed once in setParameters:, while the per-thread canonicalizer still holds our parameters
+    NSString *scheme;
     NSString *method;
     NSString *hostAndPathWithoutQuery; // we keep this because NSURL drops trailing slashes and the port number
 }
@@ -99,7 +91,6 @@ static NSString* timestamp() {
         self = nil;
         return self;
     }
-    signature_method = signatureMethod;
 
     oauthParams = [NSDictionary dictionaryWithObjectsAndKeys:
                   consumerKey,  @"oauth_consumer_key",
@@ -111,47 +102,32 @@ static NSString* timestamp() {
                   // LEAVE accessToken last or you'll break XAuth attempts
                   nil];
     signature_secret = [NSString stringWithFormat:@"%@&%@", consumerSecret, tokenSecret ?: @""];
+    signer = [TDOAuthSigner signerWithSecret:signature_secret signatureMethod:signatureMethod];
     return self;
 }
 
-- (NSString *)signature_base {
-    NSMutableDictionary *sigParams = [params mutableCopy];
-    [sigParams addEntriesFromDictionary:oauthParams];
-
-    NSMutableString *p3 = [NSMutableString stringWithCapacity:256];
-    NSArray *keys = [[sigParams allKeys] sortedArrayUsingSelector:@selector(compare:)];
-    for (NSString *key in keys)
-    {
-        //[p3 appendString:TDPCEN(key)];
-        [p3 appendString:key];
-        [p3 appendString:@"="];
-        [p3 appendString:[sigParams[key] description]];
-        [p3 appendString:@"&"];
+// Appends the oauth_* parameters to params and streams the signature base into the HMAC. params is this thread's
+// shared canonicalizer, so this has to run before anything else on the thread can reset it.
+- (NSString *)signatureWithParameters:(TDOAuthCanonicalizer *)params {
+    for (NSString *key in oauthParams) {
+        [params addEncodedKey:key value:[oauthParams[key] description]];
     }
-    TDChomp(p3);
 
-    return [NSString stringWithFormat:@"%@&%@%%3A%%2F%%2F%@&%@",
-            method,
-            url.scheme.lowercaseString,
-            TDPCEN(hostAndPathWithoutQuery),
-            TDPCEN(p3)];
-}
-
-- (NSString *)signature {
-    NSData *sigbase = [[self signature_base] dataUsingEncoding:NSUTF8StringEncoding];
-    NSData *secret = [signature_secret dataUsingEncoding:NSUTF8StringEncoding];
-
-    NSMutableData *digest;
-    NSString *result;
-    if (signature_method == TDOAuthSignatureMethodHmacSha256) {
-        digest = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
-        CCHmac(kCCHmacAlgSHA256, secret.bytes, secret.length, sigbase.bytes, sigbase.length, digest.mutableBytes);
-    } else { // assume TDOAuthSignatureMethodHmacSha1
-        digest = [NSMutableData dataWithLength:CC_SHA1_DIGEST_LENGTH];
-        CCHmac(kCCHmacAlgSHA1, secret.bytes, secret.length, sigbase.bytes, sigbase.length, digest.mutableBytes);
-    }
-    result = [digest base64EncodedStringWithOptions:NSDataBase64Encoding76CharacterLineLength];
-    return result;
+    // METHOD&scheme%3A%2F%2Fhost%2Fpath&sorted%3Dparams, streamed into the HMAC without building the string
+    NSData *methodData = [method dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *schemeData = [scheme.lowercaseString dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *hostAndPathData = [hostAndPathWithoutQuery dataUsingEncoding:NSUTF8StringEncoding];
+
+    CCHmacContext context;
+    [signer beginSignature:&context];
+    CCHmacUpdate(&context, methodData.bytes, methodData.length);
+    CCHmacUpdate(&context, "&", 1);
+    CCHmacUpdate(&context, schemeData.bytes, schemeData.length);
+    CCHmacUpdate(&context, "%3A%2F%2F", 9);
+    TDOAuthHmacUpdateEncoded(&context, hostAndPathData.bytes, hostAndPathData.length);
+    CCHmacUpdate(&context, "&", 1);
+    [params updateSignature:&context];
+    return [signer finishSignature:&context];
 }
 
 
@@ -166,7 +142,7 @@ static NSString* timestamp() {
         [header appendString:@"\", "];
     }
     [header appendString:@"oauth_signature=\""];
-    [header appendString:TDPCEN(self.signature)];
+    [header appendString:TDPCEN(signature)];
     [header appendString:@"\""];
     return header;
 }
@@ -192,22 +168,17 @@ static NSString* timestamp() {
     return rq;
 }
 
-// unencodedParameters are encoded and assigned to self->params, returns encoded queryString
+// unencodedParameters are encoded once, signed along with oauthParams, returns encoded queryString. method, scheme and
+// hostAndPathWithoutQuery must be set. The canonicalizer isn't kept: it belongs to the thread, not to this request.
 - (id)setParameters:(NSDictionary *)unencodedParameters {
-    NSMutableString *queryString = [NSMutableString string];
-    NSMutableDictionary *encodedParameters = [NSMutableDictionary new];
+    TDOAuthCanonicalizer *params = [TDOAuthCanonicalizer canonicalizerForCurrentThread];
     for (NSString *key in unencodedParameters.allKeys)
     {
-        NSString *enkey = TDPCEN(key);
-        NSString *envalue = TDPCEN(unencodedParameters[key]);
-        encodedParameters[enkey] = envalue;
-        [queryString appendString:enkey];
-        [queryString appendString:@"="];
-        [queryString appendString:envalue];
-        [queryString appendString:@"&"];
+        [params addUnencodedKey:key value:unencodedParameters[key]];
     }
-    TDChomp(queryString);
-    params = [encodedParameters copy];
+    NSMutableString *queryString = [params queryString];
+    signature = [self signatureWithParameters:params];
+    [params reset];
     return queryString;
 }
 
@@ -264,6 +235,7 @@ static NSString* timestamp() {
     NSString *encodedPathWithoutQuery = [unencodedPathWithoutQuery stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
 
     oauth->method = method;
+    oauth->scheme = scheme;
     oauth->hostAndPathWithoutQuery = [host.lowercaseString stringByAppendingString:encodedPathWithoutQuery];
 
     NSMutableURLRequest *rq;
@@ -371,12 +343,12 @@ static NSString* timestamp() {
 
 +(int)utcTimeOffset
 {
-    return TDOAuthUTCTimeOffset;
+    return __atomic_load_n(&TDOAuthUTCTimeOffset, __ATOMIC_RELAXED);
 }
 
 +(void)setUtcTimeOffset:(int)offset
 {
-    TDOAuthUTCTimeOffset = offset;
+    __atomic_store_n(&TDOAuthUTCTimeOffset, offset, __ATOMIC_RELAXED);
 }
 
 @end
@@ -0,0 +1,62 @@
+//
+//  TDOAuthCanonicalizer.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <CommonCrypto/CommonHMAC.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `TDOAuthCanonicalizer` collects percent encoded request parameters into a single byte buffer and produces both the
+ query string / form body and the parameter part of the OAuth signature base string from it.
+
+ Each key and value is encoded exactly once when it is added. The signature base is never materialized: entries are
+ sorted with a byte-wise comparator and streamed straight into an HMAC context, escaping `%`, `=` and `&` on the fly.
+
+ Instances are not thread safe. `canonicalizerForCurrentThread` returns a per-thread instance whose storage is reused
+ by every request signed on that thread.
+ */
+@interface TDOAuthCanonicalizer : NSObject
+
+/**
+ Returns this thread's canonicalizer, emptied and ready for a new request.
+ */
++ (instancetype)canonicalizerForCurrentThread;
+
+/**
+ Removes all parameters but keeps the allocated storage.
+ */
+- (void)reset;
+
+/**
+ Percent encodes `key` and the `description` of `value` and appends the pair.
+ */
+- (void)addUnencodedKey:(NSString *)key value:(id)value;
+
+/**
+ Appends a pair whose key and value are already percent encoded (e.g. the `oauth_*` parameters).
+ */
+- (void)addEncodedKey:(NSString *)key value:(NSString *)value;
+
+/**
+ `key=value&...` for all pairs in insertion order, suitable for a URL query or a form body.
+ */
+- (NSMutableString *)queryString;
+
+/**
+ Sorts the pairs and feeds `key%3Dvalue%26...` into `context`, i.e. the third component of the signature base string.
+ */
+- (void)updateSignature:(CCHmacContext *)context;
+
+@end
+
+/**
+ Feeds `length` bytes to `context`, percent encoding every byte outside the RFC 3986 unreserved set.
+ */
+FOUNDATION_EXPORT void TDOAuthHmacUpdateEncoded(CCHmacContext *context, const char *bytes, size_t length);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,201 @@
+//
+//  TDOAuthCanonicalizer.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "TDOAuthCanonicalizer.h"
+#import "TDOAuthPercentEncoding.h"
+#import <pthread.h>
+
+// Offsets rather than pointers, the buffer may move while parameters are still being added
+typedef struct {
+    size_t keyOffset;
+    size_t keyLength;
+    size_t valueOffset;
+    size_t valueLength;
+} TDOAuthParameter;
+
+typedef struct {
+    const char *key;
+    size_t keyLength;
+    const char *value;
+    size_t valueLength;
+} TDOAuthSortedParameter;
+
+void TDOAuthHmacUpdateEncoded(CCHmacContext *context, const char *bytes, size_t length) {
+    char chunk[TDOAuthPercentEncodedMaxLength(64)];
+    const size_t stride = 64;
+    for (size_t offset = 0; offset < length; offset += stride) {
+        size_t n = MIN(stride, length - offset);
+        size_t encoded = TDOAuthPercentEncode((const uint8_t *)bytes + offset, n, chunk);
+        CCHmacUpdate(context, chunk, encoded);
+    }
+}
+
+static int TDOAuthCompareBytes(const char *a, size_t aLength, const char *b, size_t bLength) {
+    int result = memcmp(a, b, MIN(aLength, bLength));
+    if (result != 0) {
+        return result;
+    }
+    return (aLength < bLength) ? -1 : (aLength > bLength);
+}
+
+static int TDOAuthCompareParameters(const void *lhs, const void *rhs) {
+    const TDOAuthSortedParameter *a = lhs;
+    const TDOAuthSortedParameter *b = rhs;
+    int result = TDOAuthCompareBytes(a->key, a->keyLength, b->key, b->keyLength);
+    if (result == 0) {
+        result = TDOAuthCompareBytes(a->value, a->valueLength, b->value, b->valueLength);
+    }
+    return result;
+}
+
+static void *TDOAuthReserve(void *pointer, size_t *capacity, size_t needed, size_t elementSize) {
+    if (needed <= *capacity) {
+        return pointer;
+    }
+    size_t newCapacity = MAX(*capacity * 2, MAX(needed, (size_t)16));
+    void *grown = realloc(pointer, newCapacity * elementSize);
+    if (grown == NULL) {
+        [NSException raise:NSMallocException format:@"TDOAuthCanonicalizer could not grow to %zu bytes", newCapacity * elementSize];
+    }
+    *capacity = newCapacity;
+    return grown;
+}
+
+static pthread_key_t TDOAuthCanonicalizerThreadKey;
+
+static void TDOAuthCanonicalizerThreadRelease(void *canonicalizer) {
+    CFRelease(canonicalizer);
+}
+
+@implementation TDOAuthCanonicalizer
+{
+    char *buffer;             // encoded keys and values back to back
+    size_t length;
+    size_t capacity;
+    char *scratch;            // raw UTF-8 of the string being encoded, then the joined query string
+    size_t scratchCapacity;
+    TDOAuthParameter *parameters;
+    TDOAuthSortedParameter *sorted;
+    size_t count;
+    size_t parameterCapacity;
+    size_t sortedCapacity;
+}
+
++ (instancetype)canonicalizerForCurrentThread {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&TDOAuthCanonicalizerThreadKey, TDOAuthCanonicalizerThreadRelease);
+    });
+    TDOAuthCanonicalizer *canonicalizer = (__bridge TDOAuthCanonicalizer *)pthread_getspecific(TDOAuthCanonicalizerThreadKey);
+    if (canonicalizer == nil) {
+        canonicalizer = [self new];
+        pthread_setspecific(TDOAuthCanonicalizerThreadKey, CFBridgingRetain(canonicalizer));
+    }
+    [canonicalizer reset];
+    return canonicalizer;
+}
+
+- (void)dealloc {
+    free(buffer);
+    free(scratch);
+    free(parameters);
+    free(sorted);
+}
+
+- (void)reset {
+    length = 0;
+    count = 0;
+}
+
+#pragma mark -
+
+// Appends the UTF-8 bytes of `string`, percent encoded when `encode` is set. Returns the offset of the appended bytes.
+- (size_t)appendString:(NSString *)string encode:(BOOL)encode length:(size_t *)appendedLength {
+    NSUInteger maxLength = [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    scratch = TDOAuthReserve(scratch, &scratchCapacity, maxLength + 1, 1);
+    NSUInteger rawLength = 0;
+    [string getBytes:scratch
+           maxLength:maxLength
+          usedLength:&rawLength
+            encoding:NSUTF8StringEncoding
+             options:0
+               range:NSMakeRange(0, string.length)
+      remainingRange:NULL];
+
+    size_t offset = length;
+    if (encode) {
+        buffer = TDOAuthReserve(buffer, &capacity, length + TDOAuthPercentEncodedMaxLength(rawLength), 1);
+        *appendedLength = TDOAuthPercentEncode((const uint8_t *)scratch, rawLength, buffer + length);
+    } else {
+        buffer = TDOAuthReserve(buffer, &capacity, length + rawLength, 1);
+        memcpy(buffer + length, scratch, rawLength);
+        *appendedLength = rawLength;
+    }
+    length += *appendedLength;
+    return offset;
+}
+
+- (void)addKey:(NSString *)key value:(NSString *)value encode:(BOOL)encode {
+    parameters = TDOAuthReserve(parameters, &parameterCapacity, count + 1, sizeof(TDOAuthParameter));
+    TDOAuthParameter *parameter = &parameters[count];
+    parameter->keyOffset = [self appendString:key encode:encode length:&parameter->keyLength];
+    parameter->valueOffset = [self appendString:value encode:encode length:&parameter->valueLength];
+    count++;
+}
+
+- (void)addUnencodedKey:(NSString *)key value:(id)value {
+    [self addKey:[key description] value:[value description] encode:YES];
+}
+
+- (void)addEncodedKey:(NSString *)key value:(NSString *)value {
+    [self addKey:key value:value encode:NO];
+}
+
+#pragma mark -
+
+- (NSMutableString *)queryString {
+    if (count == 0) {
+        return [NSMutableString string];
+    }
+    // every pair contributes its bytes plus '=' and a '&' separator
+    scratch = TDOAuthReserve(scratch, &scratchCapacity, length + count * 2, 1);
+    char *out = scratch;
+    for (size_t i = 0; i < count; i++) {
+        const TDOAuthParameter *parameter = &parameters[i];
+        if (i > 0) {
+            *out++ = '&';
+        }
+        memcpy(out, buffer + parameter->keyOffset, parameter->keyLength);
+        out += parameter->keyLength;
+        *out++ = '=';
+        memcpy(out, buffer + parameter->valueOffset, parameter->valueLength);
+        out += parameter->valueLength;
+    }
+    return [[NSMutableString alloc] initWithBytes:scratch length:(NSUInteger)(out - scratch) encoding:NSASCIIStringEncoding];
+}
+
+- (void)updateSignature:(CCHmacContext *)context {
+    sorted = TDOAuthReserve(sorted, &sortedCapacity, count, sizeof(TDOAuthSortedParameter));
+    for (size_t i = 0; i < count; i++) {
+        sorted[i].key = buffer + parameters[i].keyOffset;
+        sorted[i].keyLength = parameters[i].keyLength;
+        sorted[i].value = buffer + parameters[i].valueOffset;
+        sorted[i].valueLength = parameters[i].valueLength;
+    }
+    qsort(sorted, count, sizeof(TDOAuthSortedParameter), TDOAuthCompareParameters);
+
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            CCHmacUpdate(context, "%26", 3);
+        }
+        TDOAuthHmacUpdateEncoded(context, sorted[i].key, sorted[i].keyLength);
+        CCHmacUpdate(context, "%3D", 3);
+        TDOAuthHmacUpdateEncoded(context, sorted[i].value, sorted[i].valueLength);
+    }
+}
+
+@end
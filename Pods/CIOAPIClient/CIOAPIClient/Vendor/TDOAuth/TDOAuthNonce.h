@@ -0,0 +1,26 @@
+//
+//  TDOAuthNonce.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Returns a fresh `oauth_nonce`: 18 bytes from the OS CSPRNG encoded as 24 URL-safe base64 characters, all of which are
+ in the RFC 3986 unreserved set and need no further escaping.
+
+ Random bytes are drawn in bulk into a per-thread pool, so concurrent signing threads never share state or take a lock.
+ */
+FOUNDATION_EXPORT NSString *TDOAuthGenerateNonce(void);
+
+/**
+ Returns the `oauth_timestamp` for the current second shifted by `offset` seconds. The formatted string is cached per
+ thread and reused until the second or the offset changes.
+ */
+FOUNDATION_EXPORT NSString *TDOAuthGenerateTimestamp(long offset);
+
+NS_ASSUME_NONNULL_END
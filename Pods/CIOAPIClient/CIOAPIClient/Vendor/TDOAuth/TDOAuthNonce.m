@@ -0,0 +1,123 @@
+//
+//  TDOAuthNonce.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "TDOAuthNonce.h"
+#import <pthread.h>
+#import <time.h>
+#if defined(__APPLE__)
+#import <Security/SecRandom.h>
+#else
+#import <unistd.h>
+#endif
+
+enum {
+    TDOAuthEntropyPoolSize = 4096,  // one refill covers ~227 nonces
+    TDOAuthNonceBytes = 18,
+    TDOAuthNonceLength = 24,        // TDOAuthNonceBytes * 4 / 3
+};
+
+static const char TDOAuthNonceAlphabet[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+typedef struct {
+    uint8_t pool[TDOAuthEntropyPoolSize];
+    size_t poolOffset;            // bytes of pool already handed out
+    time_t timestampSecond;
+    long timestampOffset;
+    CFStringRef timestamp;        // retained, formatted for timestampSecond + timestampOffset
+} TDOAuthThreadState;
+
+static pthread_key_t TDOAuthThreadStateKey;
+
+static void TDOAuthThreadStateDestroy(void *value) {
+    TDOAuthThreadState *state = value;
+    if (state->timestamp) {
+        CFRelease(state->timestamp);
+    }
+    // Wipe leftover entropy so it does not linger in freed memory
+    memset(state->pool, 0, sizeof(state->pool));
+    free(state);
+}
+
+static void TDOAuthFillEntropy(uint8_t *bytes, size_t length) {
+#if defined(__APPLE__)
+    if (SecRandomCopyBytes(kSecRandomDefault, length, bytes) == 0) {
+        return;
+    }
+#else
+    // getentropy is limited to 256 bytes per call
+    size_t filled = 0;
+    while (filled < length) {
+        size_t chunk = MIN((size_t)256, length - filled);
+        if (getentropy(bytes + filled, chunk) != 0) {
+            break;
+        }
+        filled += chunk;
+    }
+    if (filled == length) {
+        return;
+    }
+#endif
+    // The kernel source should never fail; if it does, fall back rather than send a predictable nonce
+    arc4random_buf(bytes, length);
+}
+
+static TDOAuthThreadState *TDOAuthCurrentThreadState(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&TDOAuthThreadStateKey, TDOAuthThreadStateDestroy);
+    });
+    TDOAuthThreadState *state = pthread_getspecific(TDOAuthThreadStateKey);
+    if (state == NULL) {
+        state = calloc(1, sizeof(TDOAuthThreadState));
+        state->poolOffset = TDOAuthEntropyPoolSize; // empty, filled on first use
+        state->timestampSecond = -1;
+        pthread_setspecific(TDOAuthThreadStateKey, state);
+    }
+    return state;
+}
+
+NSString *TDOAuthGenerateNonce(void) {
+    TDOAuthThreadState *state = TDOAuthCurrentThreadState();
+    if (state->poolOffset + TDOAuthNonceBytes > TDOAuthEntropyPoolSize) {
+        TDOAuthFillEntropy(state->pool, TDOAuthEntropyPoolSize);
+        state->poolOffset = 0;
+    }
+    uint8_t *bytes = state->pool + state->poolOffset;
+    state->poolOffset += TDOAuthNonceBytes;
+
+    char nonce[TDOAuthNonceLength];
+    char *out = nonce;
+    for (size_t i = 0; i < TDOAuthNonceBytes; i += 3) {
+        uint32_t triple = ((uint32_t)bytes[i] << 16) | ((uint32_t)bytes[i + 1] << 8) | bytes[i + 2];
+        *out++ = TDOAuthNonceAlphabet[(triple >> 18) & 0x3F];
+        *out++ = TDOAuthNonceAlphabet[(triple >> 12) & 0x3F];
+        *out++ = TDOAuthNonceAlphabet[(triple >> 6) & 0x3F];
+        *out++ = TDOAuthNonceAlphabet[triple & 0x3F];
+    }
+    // Never reuse pool bytes once they have been turned into a nonce
+    memset(bytes, 0, TDOAuthNonceBytes);
+
+    return (__bridge_transfer NSString *)CFStringCreateWithBytes(NULL, (const UInt8 *)nonce, TDOAuthNonceLength,
+                                                                 kCFStringEncodingASCII, false);
+}
+
+NSString *TDOAuthGenerateTimestamp(long offset) {
+    TDOAuthThreadState *state = TDOAuthCurrentThreadState();
+    time_t now = time(NULL);
+    if (state->timestamp == NULL || state->timestampSecond != now || state->timestampOffset != offset) {
+        char digits[24];
+        int length = snprintf(digits, sizeof(digits), "%ld", (long)now + offset);
+        CFStringRef timestamp = CFStringCreateWithBytes(NULL, (const UInt8 *)digits, length, kCFStringEncodingASCII, false);
+        if (state->timestamp) {
+            CFRelease(state->timestamp);
+        }
+        state->timestamp = timestamp;
+        state->timestampSecond = now;
+        state->timestampOffset = offset;
+    }
+    return (__bridge NSString *)state->timestamp;
+}
@@ -0,0 +1,34 @@
+//
+//  TDOAuthPercentEncoding.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Upper bound of the encoded size of `length` input bytes. Size output buffers passed to `TDOAuthPercentEncode` with it.
+ */
+#define TDOAuthPercentEncodedMaxLength(length) ((length) * 3)
+
+/**
+ Percent encodes `length` bytes into `out` following RFC 3986 / OAuth 1.0a section 3.6: every byte outside
+ `ALPHA / DIGIT / "-" / "." / "_" / "~"` becomes `%XX` with uppercase hex digits.
+
+ `out` is provided by the caller and must hold at least `TDOAuthPercentEncodedMaxLength(length)` bytes. Runs of
+ unreserved bytes are detected 16 bytes at a time with NEON or SSE2 and copied through unchanged; everything else goes
+ through a 256 entry lookup table.
+
+ @return the number of bytes written to `out`
+ */
+FOUNDATION_EXPORT size_t TDOAuthPercentEncode(const uint8_t *bytes, size_t length, char *out);
+
+/**
+ Percent encodes the UTF-8 representation of `string`. Returns `string` itself when nothing needs escaping.
+ */
+FOUNDATION_EXPORT NSString *TDOAuthPercentEncodeString(NSString *string);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,160 @@
+//
+//  TDOAuthPercentEncoding.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "TDOAuthPercentEncoding.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#import <arm_neon.h>
+#define TDOAUTH_PERCENT_ENCODING_NEON 1
+#elif defined(__SSE2__)
+#import <emmintrin.h>
+#define TDOAUTH_PERCENT_ENCODING_SSE2 1
+#endif
+
+// Escaping is skipped for these bytes, which is what CFURLCreateStringByAddingPercentEscapes produced for the legal
+// URL characters "!*'();:@&=+$,/?%#[]" that TDOAuth used to pass in.
+static const uint8_t TDOAuthUnreserved[256] = {
+    ['A' ... 'Z'] = 1,
+    ['a' ... 'z'] = 1,
+    ['0' ... '9'] = 1,
+    ['-'] = 1, ['.'] = 1, ['_'] = 1, ['~'] = 1,
+};
+
+static const char TDOAuthHexDigits[16] = "0123456789ABCDEF";
+
+static const size_t TDOAuthBlockSize = 16;
+
+// Returns non-zero when all 16 bytes at `bytes` are unreserved.
+static inline int TDOAuthBlockIsUnreserved(const uint8_t *bytes) {
+#if TDOAUTH_PERCENT_ENCODING_NEON
+    uint8x16_t v = vld1q_u8(bytes);
+    // '-' ... '9' is one range apart from '/', the remaining classes are single ranges or single bytes
+    uint8x16_t digits = vcleq_u8(vsubq_u8(v, vdupq_n_u8('-')), vdupq_n_u8('9' - '-'));
+    digits = vbicq_u8(digits, vceqq_u8(v, vdupq_n_u8('/')));
+    uint8x16_t upper = vcleq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8('Z' - 'A'));
+    uint8x16_t lower = vcleq_u8(vsubq_u8(v, vdupq_n_u8('a')), vdupq_n_u8('z' - 'a'));
+    uint8x16_t marks = vorrq_u8(vceqq_u8(v, vdupq_n_u8('_')), vceqq_u8(v, vdupq_n_u8('~')));
+    uint8x16_t ok = vorrq_u8(vorrq_u8(digits, upper), vorrq_u8(lower, marks));
+#if defined(__aarch64__)
+    return vminvq_u8(ok) == 0xFF;
+#else
+    uint8x8_t folded = vand_u8(vget_low_u8(ok), vget_high_u8(ok));
+    folded = vpmin_u8(folded, folded);
+    folded = vpmin_u8(folded, folded);
+    folded = vpmin_u8(folded, folded);
+    return vget_lane_u8(folded, 0) == 0xFF;
+#endif
+#elif TDOAUTH_PERCENT_ENCODING_SSE2
+    __m128i v = _mm_loadu_si128((const __m128i *)bytes);
+#define TDOAUTH_IN_RANGE(lo, hi) \
+    _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8((char)(lo))), v), \
+                  _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8((char)(hi))), v))
+    __m128i digits = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), TDOAUTH_IN_RANGE('-', '9'));
+    __m128i upper = TDOAUTH_IN_RANGE('A', 'Z');
+    __m128i lower = TDOAUTH_IN_RANGE('a', 'z');
+#undef TDOAUTH_IN_RANGE
+    __m128i marks = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~')));
+    __m128i ok = _mm_or_si128(_mm_or_si128(digits, upper), _mm_or_si128(lower, marks));
+    return _mm_movemask_epi8(ok) == 0xFFFF;
+#else
+    for (size_t i = 0; i < TDOAuthBlockSize; i++) {
+        if (!TDOAuthUnreserved[bytes[i]]) {
+            return 0;
+        }
+    }
+    return 1;
+#endif
+}
+
+static inline char *TDOAuthEncodeScalar(const uint8_t *bytes, size_t length, char *out) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = bytes[i];
+        if (TDOAuthUnreserved[c]) {
+            *out++ = (char)c;
+        } else {
+            out[0] = '%';
+            out[1] = TDOAuthHexDigits[c >> 4];
+            out[2] = TDOAuthHexDigits[c & 0x0F];
+            out += 3;
+        }
+    }
+    return out;
+}
+
+size_t TDOAuthPercentEncode(const uint8_t *bytes, size_t length, char *out) {
+    char *start = out;
+    size_t i = 0;
+    // Two blocks per iteration; parameter values are mostly long unreserved runs (ids, timestamps, words)
+    while (i + 2 * TDOAuthBlockSize <= length) {
+        if (TDOAuthBlockIsUnreserved(bytes + i) && TDOAuthBlockIsUnreserved(bytes + i + TDOAuthBlockSize)) {
+            memcpy(out, bytes + i, 2 * TDOAuthBlockSize);
+            out += 2 * TDOAuthBlockSize;
+        } else {
+            out = TDOAuthEncodeScalar(bytes + i, 2 * TDOAuthBlockSize, out);
+        }
+        i += 2 * TDOAuthBlockSize;
+    }
+    if (i + TDOAuthBlockSize <= length) {
+        if (TDOAuthBlockIsUnreserved(bytes + i)) {
+            memcpy(out, bytes + i, TDOAuthBlockSize);
+            out += TDOAuthBlockSize;
+        } else {
+            out = TDOAuthEncodeScalar(bytes + i, TDOAuthBlockSize, out);
+        }
+        i += TDOAuthBlockSize;
+    }
+    out = TDOAuthEncodeScalar(bytes + i, length - i, out);
+    return (size_t)(out - start);
+}
+
+NSString *TDOAuthPercentEncodeString(NSString *string) {
+    // Most parameters are short; only fall back to the heap for long subjects and search terms
+    uint8_t rawStack[256];
+    char encodedStack[TDOAuthPercentEncodedMaxLength(sizeof(rawStack))];
+
+    const uint8_t *raw = (const uint8_t *)CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    size_t rawLength;
+    uint8_t *rawHeap = NULL;
+    if (raw) {
+        // Only ASCII contents come back as a UTF-8 pointer, so there is one byte per UTF-16 unit. Not strlen: the
+        // string may contain NULs.
+        rawLength = (size_t)CFStringGetLength((__bridge CFStringRef)string);
+    } else {
+        NSUInteger maxLength = [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+        uint8_t *rawBuffer = rawStack;
+        if (maxLength > sizeof(rawStack)) {
+            rawBuffer = rawHeap = malloc(maxLength);
+        }
+        NSUInteger usedLength = 0;
+        [string getBytes:rawBuffer
+               maxLength:maxLength
+              usedLength:&usedLength
+                encoding:NSUTF8StringEncoding
+                 options:0
+                   range:NSMakeRange(0, string.length)
+          remainingRange:NULL];
+        raw = rawBuffer;
+        rawLength = usedLength;
+    }
+
+    char *encoded = encodedStack;
+    char *encodedHeap = NULL;
+    if (TDOAuthPercentEncodedMaxLength(rawLength) > sizeof(encodedStack)) {
+        encoded = encodedHeap = malloc(TDOAuthPercentEncodedMaxLength(rawLength));
+    }
+    size_t encodedLength = TDOAuthPercentEncode(raw, rawLength, encoded);
+
+    NSString *result;
+    if (encodedLength == rawLength) {
+        result = [string copy];
+    } else {
+        result = [[NSString alloc] initWithBytes:encoded length:encodedLength encoding:NSASCIIStringEncoding];
+    }
+    free(rawHeap);
+    free(encodedHeap);
+    return result;
+}
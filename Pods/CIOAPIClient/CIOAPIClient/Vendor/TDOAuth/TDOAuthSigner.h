@@ -0,0 +1,56 @@
+//
+//  TDOAuthSigner.h
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <CommonCrypto/CommonHMAC.h>
+#import "TDOAuth.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `TDOAuthSigner` holds the HMAC key schedule for a single consumer secret / token secret pair.
+
+ `CCHmacInit` hashes the padded key into the inner and outer digest states before any message data is seen. Those
+ states only depend on the secret, so a signer computes them once and every signature starts from a copy of the keyed
+ context instead of re-deriving it. Signers are shared through a small process-wide cache keyed by signature method and
+ secret; they are immutable after creation and safe to use from any thread.
+ */
+@interface TDOAuthSigner : NSObject
+
+/**
+ Returns the cached signer for a signing key, creating it on first use.
+
+ @param secret The OAuth signing key, i.e. the consumer secret and token secret joined with `&`.
+ @param signatureMethod HMAC-SHA1 or HMAC-SHA256.
+ */
++ (nullable instancetype)signerWithSecret:(NSString *)secret signatureMethod:(TDOAuthSignatureMethod)signatureMethod;
+
+/**
+ Drops every cached key schedule. Call this when credentials are cleared.
+ */
++ (void)purgeCache;
+
+@property (readonly, nonatomic) TDOAuthSignatureMethod signatureMethod;
+
+/**
+ Copies the pre-keyed HMAC state into `context` so the caller can feed message bytes with `CCHmacUpdate`.
+ */
+- (void)beginSignature:(CCHmacContext *)context;
+
+/**
+ Finalizes a context started with `beginSignature:` and returns the base64 encoded digest.
+ */
+- (NSString *)finishSignature:(CCHmacContext *)context;
+
+/**
+ Signs `length` bytes in one call and returns the base64 encoded digest.
+ */
+- (NSString *)signatureForBytes:(const void *)bytes length:(size_t)length;
+
+@end
+
+NS_ASSUME_NONNULL_END
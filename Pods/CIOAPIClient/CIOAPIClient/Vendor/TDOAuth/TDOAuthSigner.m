@@ -0,0 +1,105 @@
+//
+//  TDOAuthSigner.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import "TDOAuthSigner.h"
+#import <pthread.h>
+
+// Credential pairs are rarely more than a handful per process; the bound only protects against callers that rotate
+// secrets on every request.
+static const NSUInteger TDOAuthSignerCacheLimit = 64;
+
+static pthread_mutex_t TDOAuthSignerCacheLock = PTHREAD_MUTEX_INITIALIZER;
+// Signature method -> (secret -> signer)
+static NSMutableDictionary *TDOAuthSignerCache = nil;
+
+@implementation TDOAuthSigner
+{
+    CCHmacContext keyedContext; // HMAC state after CCHmacInit, never updated afterwards
+    size_t digestLength;
+}
+
+- (instancetype)initWithSecret:(NSString *)secret signatureMethod:(TDOAuthSignatureMethod)signatureMethod {
+    CCHmacAlgorithm algorithm;
+    if (signatureMethod == TDOAuthSignatureMethodHmacSha256) {
+        algorithm = kCCHmacAlgSHA256;
+        digestLength = CC_SHA256_DIGEST_LENGTH;
+    } else if (signatureMethod == TDOAuthSignatureMethodHmacSha1) {
+        algorithm = kCCHmacAlgSHA1;
+        digestLength = CC_SHA1_DIGEST_LENGTH;
+    } else {
+        return nil;
+    }
+    if ((self = [super init])) {
+        _signatureMethod = signatureMethod;
+        NSData *key = [secret dataUsingEncoding:NSUTF8StringEncoding];
+        CCHmacInit(&keyedContext, algorithm, key.bytes, key.length);
+    }
+    return self;
+}
+
++ (instancetype)signerWithSecret:(NSString *)secret signatureMethod:(TDOAuthSignatureMethod)signatureMethod {
+    NSNumber *methodKey = @(signatureMethod);
+
+    pthread_mutex_lock(&TDOAuthSignerCacheLock);
+    TDOAuthSigner *signer = TDOAuthSignerCache[methodKey][secret];
+    pthread_mutex_unlock(&TDOAuthSignerCacheLock);
+    if (signer) {
+        return signer;
+    }
+
+    // Build outside the lock; if two threads race the first one to insert wins and both return an equivalent signer.
+    signer = [[self alloc] initWithSecret:secret signatureMethod:signatureMethod];
+    if (!signer) {
+        return nil;
+    }
+    pthread_mutex_lock(&TDOAuthSignerCacheLock);
+    if (TDOAuthSignerCache == nil) {
+        TDOAuthSignerCache = [NSMutableDictionary dictionary];
+    }
+    NSMutableDictionary *signers = TDOAuthSignerCache[methodKey];
+    if (signers == nil) {
+        signers = [NSMutableDictionary dictionary];
+        TDOAuthSignerCache[methodKey] = signers;
+    } else if (signers.count >= TDOAuthSignerCacheLimit) {
+        [signers removeAllObjects];
+    }
+    TDOAuthSigner *existing = signers[secret];
+    if (existing) {
+        signer = existing;
+    } else {
+        signers[[secret copy]] = signer;
+    }
+    pthread_mutex_unlock(&TDOAuthSignerCacheLock);
+    return signer;
+}
+
++ (void)purgeCache {
+    pthread_mutex_lock(&TDOAuthSignerCacheLock);
+    [TDOAuthSignerCache removeAllObjects];
+    pthread_mutex_unlock(&TDOAuthSignerCacheLock);
+}
+
+- (void)beginSignature:(CCHmacContext *)context {
+    // CCHmacContext is a flat struct, so a plain copy duplicates the keyed inner/outer digest state.
+    memcpy(context, &keyedContext, sizeof(CCHmacContext));
+}
+
+- (NSString *)finishSignature:(CCHmacContext *)context {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CCHmacFinal(context, digest);
+    NSData *digestData = [NSData dataWithBytes:digest length:digestLength];
+    return [digestData base64EncodedStringWithOptions:NSDataBase64Encoding76CharacterLineLength];
+}
+
+- (NSString *)signatureForBytes:(const void *)bytes length:(size_t)length {
+    CCHmacContext context;
+    [self beginSignature:&context];
+    CCHmacUpdate(&context, bytes, length);
+    return [self finishSignature:&context];
+}
+
+@end
@@ -0,0 +1,136 @@
+//
+//  CIOCurlTransportSmokeTest.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+//  XCTest isn't available on Linux, so the libcurl transport is checked by this small program against a local HTTP
+//  server. Exits non-zero on the first failure.
+//
+
+#import <Foundation/Foundation.h>
+#import "CIOCurlTransport.h"
+
+#import <arpa/inet.h>
+#import <netinet/in.h>
+#import <sys/socket.h>
+#import <unistd.h>
+
+#define CIOCheck(condition, ...) do { \
+    if (!(condition)) { \
+        NSLog(@"FAIL %s:%d: %@", __FILE__, __LINE__, [NSString stringWithFormat:__VA_ARGS__]); \
+        exit(1); \
+    } \
+} while (0)
+
+static const int64_t CIOSmokeTimeout = 10 * NSEC_PER_SEC;
+
+// Accepts one connection on a loopback port and answers it with `response`, or never answers if it is nil
+static uint16_t CIOServeOnce(NSString *response) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    CIOCheck(bind(listener, (struct sockaddr *)&address, length) == 0 && listen(listener, 1) == 0, @"listen");
+    getsockname(listener, (struct sockaddr *)&address, &length);
+    NSData *data = [response dataUsingEncoding:NSUTF8StringEncoding];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        int connection = accept(listener, NULL, NULL);
+        char request[4096];
+        ssize_t received = read(connection, request, sizeof(request));
+        (void)received;
+        if (data) {
+            ssize_t sent = write(connection, data.bytes, data.length);
+            (void)sent;
+            close(connection);
+        }
+        close(listener);
+    });
+    return ntohs(address.sin_port);
+}
+
+static NSURLRequest *CIOLocalRequest(uint16_t port) {
+    NSString *URLString = [NSString stringWithFormat:@"http://127.0.0.1:%u/", (unsigned)port];
+    return [NSURLRequest requestWithURL:[NSURL URLWithString:URLString]];
+}
+
+static void CIOTestHeaderNames(void) {
+    uint16_t port = CIOServeOnce(@"HTTP/1.1 200 OK\r\n"
+                                 @"content-type: application/json\r\n"
+                                 @"x-context-io-request: a\r\n"
+                                 @"X-CONTEXT-IO-REQUEST: b\r\n"
+                                 @"content-length: 2\r\n"
+                                 @"connection: close\r\n"
+                                 @"\r\n"
+                                 @"{}");
+    CIOCurlTransport *transport = [CIOCurlTransport new];
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    __block NSHTTPURLResponse *response = nil;
+    __block NSData *body = nil;
+    [[transport dataTaskWithRequest:CIOLocalRequest(port)
+                  completionHandler:^(NSData *data, NSURLResponse *urlResponse, NSError *error) {
+                      CIOCheck(error == nil, @"request failed: %@", error);
+                      response = (NSHTTPURLResponse *)urlResponse;
+                      body = data;
+                      dispatch_semaphore_signal(done);
+                  }] resume];
+    CIOCheck(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, CIOSmokeTimeout)) == 0, @"timed out");
+    CIOCheck(response.statusCode == 200, @"status %ld", (long)response.statusCode);
+    CIOCheck([response.allHeaderFields[@"Content-Type"] isEqualToString:@"application/json"], @"%@", response.allHeaderFields);
+    CIOCheck([response.allHeaderFields[@"X-Context-Io-Request"] isEqualToString:@"a, b"], @"%@", response.allHeaderFields);
+    CIOCheck([body isEqualToData:[@"{}" dataUsingEncoding:NSUTF8StringEncoding]], @"body %@", body);
+}
+
+static void CIOTestConnectionRefused(void) {
+    // Bound but never listening, so connecting is refused
+    int unused = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bind(unused, (struct sockaddr *)&address, length);
+    getsockname(unused, (struct sockaddr *)&address, &length);
+
+    CIOCurlTransport *transport = [CIOCurlTransport new];
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    __block NSError *failure = nil;
+    [[transport dataTaskWithRequest:CIOLocalRequest(ntohs(address.sin_port))
+                  completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+                      failure = error;
+                      dispatch_semaphore_signal(done);
+                  }] resume];
+    CIOCheck(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, CIOSmokeTimeout)) == 0, @"timed out");
+    CIOCheck(failure.code == NSURLErrorCannotConnectToHost, @"%@", failure);
+    close(unused);
+}
+
+static void CIOTestReleaseCancelsAndFrees(void) {
+    uint16_t port = CIOServeOnce(nil);
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    __block NSError *failure = nil;
+    __weak CIOCurlTransport *weakTransport = nil;
+    @autoreleasepool {
+        CIOCurlTransport *transport = [CIOCurlTransport new];
+        weakTransport = transport;
+        [[transport dataTaskWithRequest:CIOLocalRequest(port)
+                      completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+                          failure = error;
+                          dispatch_semaphore_signal(done);
+                      }] resume];
+        usleep(100000);
+    }
+    CIOCheck(weakTransport == nil, @"transport outlived its last reference");
+    CIOCheck(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, CIOSmokeTimeout)) == 0, @"not cancelled");
+    CIOCheck(failure.code == NSURLErrorCancelled, @"%@", failure);
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        CIOTestHeaderNames();
+        CIOTestConnectionRefused();
+        CIOTestReleaseCancelsAndFrees();
+        NSLog(@"CIOCurlTransport smoke test passed");
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+//
+//  CIOWebhookRoundTripTests.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "CIOWebhookReceiver.h"
+#import "CIOWebhookSender.h"
+
+#import <arpa/inet.h>
+#import <netinet/in.h>
+#import <sys/socket.h>
+#import <unistd.h>
+
+static NSString *const CIOTestConsumerSecret = @"secret";
+static const NSTimeInterval CIOTestTimeout = 10;
+
+@interface CIOWebhookRoundTripTests : XCTestCase
+
+@property (nonatomic) CIOWebhookReceiver *receiver;
+@property (nonatomic) CIOWebhookSender *sender;
+@property (nonatomic) NSURL *callbackURL;
+
+@end
+
+@implementation CIOWebhookRoundTripTests
+
+- (void)setUp {
+    [super setUp];
+    self.receiver = [[CIOWebhookReceiver alloc] initWithConsumerSecret:CIOTestConsumerSecret];
+    NSError *error;
+    XCTAssertTrue([self.receiver startOnPort:0 error:&error], @"%@", error);
+    self.sender = [[CIOWebhookSender alloc] initWithConsumerSecret:CIOTestConsumerSecret];
+    NSString *URLString = [NSString stringWithFormat:@"http://127.0.0.1:%u%@", (unsigned)self.receiver.port,
+                           CIOWebhookReceiverCallbackPath];
+    self.callbackURL = [NSURL URLWithString:URLString];
+}
+
+- (void)tearDown {
+    [self.receiver stop];
+    [super tearDown];
+}
+
+// Posts payload and waits for the status it is answered with
+- (NSInteger)statusForPostingPayload:(NSDictionary *)payload sender:(CIOWebhookSender *)sender {
+    XCTestExpectation *answered = [self expectationWithDescription:@"answered"];
+    __block NSInteger status = 0;
+    [sender postPayload:payload toURL:self.callbackURL completion:^(NSInteger statusCode, NSError *error) {
+        XCTAssertNil(error);
+        status = statusCode;
+        [answered fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:CIOTestTimeout handler:nil];
+    return status;
+}
+
+- (void)testSignedPayloadIsDeliveredOnce {
+    NSMutableArray *delivered = [NSMutableArray array];
+    self.receiver.callbackHandler = ^(NSDictionary *payload) {
+        XCTAssertTrue([NSThread isMainThread]);
+        [delivered addObject:payload];
+    };
+    NSDictionary *payload = [self.sender payloadWithMessageData:@{@"message_id": @"<1@example.com>", @"subject": @"Lunch"}];
+
+    XCTAssertEqual([self statusForPostingPayload:payload sender:self.sender], 200);
+    // a retry of the same token is acknowledged but not handed on again
+    XCTAssertEqual([self statusForPostingPayload:payload sender:self.sender], 200);
+
+    XCTAssertEqual(delivered.count, 1u);
+    XCTAssertEqualObjects(delivered.firstObject[@"message_data"][@"message_id"], @"<1@example.com>");
+    XCTAssertEqualObjects(delivered.firstObject[@"token"], payload[@"token"]);
+}
+
+- (void)testPayloadSignedWithAnotherSecretIsRejected {
+    __block BOOL delivered = NO;
+    self.receiver.callbackHandler = ^(NSDictionary *payload) {
+        delivered = YES;
+    };
+    CIOWebhookSender *forger = [[CIOWebhookSender alloc] initWithConsumerSecret:@"not the secret"];
+    NSDictionary *payload = [forger payloadWithMessageData:@{@"message_id": @"<2@example.com>"}];
+
+    XCTAssertEqual([self statusForPostingPayload:payload sender:forger], 401);
+    XCTAssertFalse(delivered);
+}
+
+// A socket connected to the receiver over loopback
+- (int)connectToReceiver {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(self.receiver.port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    XCTAssertEqual(connect(fd, (struct sockaddr *)&address, sizeof(address)), 0);
+    struct timeval timeout = {(time_t)CIOTestTimeout, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+- (void)testRequestFollowedByHalfCloseIsAnswered {
+    XCTestExpectation *deliveredExpectation = [self expectationWithDescription:@"delivered"];
+    self.receiver.callbackHandler = ^(NSDictionary *payload) {
+        [deliveredExpectation fulfill];
+    };
+    NSDictionary *payload = [self.sender payloadWithMessageData:@{@"message_id": @"<3@example.com>"}];
+    NSData *body = [NSJSONSerialization dataWithJSONObject:payload options:0 error:NULL];
+    NSString *header = [NSString stringWithFormat:@"POST %@ HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: application/json\r\n"
+                        @"Content-Length: %lu\r\n\r\n", CIOWebhookReceiverCallbackPath, (unsigned long)body.length];
+    NSMutableData *request = [[header dataUsingEncoding:NSASCIIStringEncoding] mutableCopy];
+    [request appendData:body];
+
+    // the whole request, then no more writes
+    int fd = [self connectToReceiver];
+    XCTAssertEqual(write(fd, request.bytes, request.length), (ssize_t)request.length);
+    shutdown(fd, SHUT_WR);
+    char response[64] = {0};
+    ssize_t received = read(fd, response, sizeof(response) - 1);
+    XCTAssertGreaterThan(received, 0);
+    XCTAssertTrue(strncmp(response, "HTTP/1.1 200 ", 13) == 0, @"%s", response);
+    close(fd);
+    [self waitForExpectationsWithTimeout:CIOTestTimeout handler:nil];
+}
+
+- (void)testConnectionsPastTheLimitAreTurnedDown {
+    self.receiver.maximumConnections = 1;
+    // holds the only slot without ever sending a request
+    int idle = [self connectToReceiver];
+    usleep(200000);
+
+    // turned down before it sends anything, so the answer is read straight off the socket
+    int turnedDown = [self connectToReceiver];
+    char response[64] = {0};
+    ssize_t received = read(turnedDown, response, sizeof(response) - 1);
+    XCTAssertGreaterThan(received, 0);
+    XCTAssertTrue(strncmp(response, "HTTP/1.1 503 ", 13) == 0, @"%s", response);
+    close(turnedDown);
+    close(idle);
+}
+
+@end
@@ -0,0 +1,140 @@
+//
+//  TDOAuthPercentEncodingTests.m
+//  CIOAPIClient
+//
+//  Copyright (c) 2015 Context.io. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "TDOAuthPercentEncoding.h"
+
+// The encoder TDPCEN used before TDOAuthPercentEncodeString replaced it
+static NSString *TDOAuthLegacyPercentEncode(NSString *string) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+    return (__bridge_transfer NSString *)CFURLCreateStringByAddingPercentEscapes(NULL, (__bridge CFStringRef)string, NULL, CFSTR("!*'();:@&=+$,/?%#[]"), kCFStringEncodingUTF8);
+#pragma clang diagnostic pop
+}
+
+// Scalar reference for the byte level encoder, straight from RFC 3986 section 2.3
+static NSString *TDOAuthReferencePercentEncode(const uint8_t *bytes, size_t length) {
+    NSMutableString *encoded = [NSMutableString stringWithCapacity:length * 3];
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = bytes[i];
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+            c == '-' || c == '.' || c == '_' || c == '~') {
+            [encoded appendFormat:@"%c", c];
+        } else {
+            [encoded appendFormat:@"%%%02X", c];
+        }
+    }
+    return encoded;
+}
+
+// Alphabet weighted towards the block boundaries of the fast path: long unreserved runs broken by the odd escape
+static NSString *TDOAuthRandomString(NSUInteger length) {
+    static NSString *const unreserved = @"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._~";
+    static NSString *const reserved = @" !\"#$%&'()*+,/:;<=>?@[\\]^`{|}éüß€中文";
+    NSMutableString *string = [NSMutableString stringWithCapacity:length];
+    for (NSUInteger i = 0; i < length; i++) {
+        if (arc4random_uniform(8) == 0) {
+            unichar c = [reserved characterAtIndex:arc4random_uniform((uint32_t)reserved.length)];
+            [string appendFormat:@"%C", c];
+        } else if (arc4random_uniform(64) == 0) {
+            [string appendString:@"\U0001F4E7"];
+        } else {
+            unichar c = [unreserved characterAtIndex:arc4random_uniform((uint32_t)unreserved.length)];
+            [string appendFormat:@"%C", c];
+        }
+    }
+    return string;
+}
+
+@interface TDOAuthPercentEncodingTests : XCTestCase
+
+@end
+
+@implementation TDOAuthPercentEncodingTests
+
+- (void)testMatchesLegacyEncoderOnRandomStrings {
+    for (NSUInteger i = 0; i < 20000; i++) {
+        NSString *string = TDOAuthRandomString(arc4random_uniform(160));
+        XCTAssertEqualObjects(TDOAuthPercentEncodeString(string), TDOAuthLegacyPercentEncode(string), @"%@", string);
+    }
+}
+
+- (void)testMatchesReferenceOnEveryByte {
+    // Every length around the 16 and 32 byte blocks, with each byte value at each position
+    uint8_t bytes[70];
+    char out[TDOAuthPercentEncodedMaxLength(sizeof(bytes))];
+    for (size_t length = 1; length <= sizeof(bytes); length++) {
+        for (unsigned value = 0; value < 256; value++) {
+            memset(bytes, 'a', length);
+            bytes[(value * 7) % length] = (uint8_t)value;
+            size_t encodedLength = TDOAuthPercentEncode(bytes, length, out);
+            NSString *encoded = [[NSString alloc] initWithBytes:out length:encodedLength encoding:NSASCIIStringEncoding];
+            XCTAssertEqualObjects(encoded, TDOAuthReferencePercentEncode(bytes, length), @"length %zu byte %u", length, value);
+        }
+    }
+}
+
+- (void)testMatchesReferenceOnRandomBytes {
+    uint8_t bytes[512];
+    char out[TDOAuthPercentEncodedMaxLength(sizeof(bytes))];
+    for (NSUInteger i = 0; i < 20000; i++) {
+        size_t length = arc4random_uniform(sizeof(bytes) + 1);
+        arc4random_buf(bytes, length);
+        for (size_t j = 0; j < length; j++) {
+            // mostly unreserved so the vector path is taken as well
+            if (arc4random_uniform(4) != 0) {
+                bytes[j] = (uint8_t)('a' + bytes[j] % 26);
+            }
+        }
+        size_t encodedLength = TDOAuthPercentEncode(bytes, length, out);
+        NSString *encoded = [[NSString alloc] initWithBytes:out length:encodedLength encoding:NSASCIIStringEncoding];
+        XCTAssertEqualObjects(encoded, TDOAuthReferencePercentEncode(bytes, length));
+    }
+}
+
+- (void)testEncodesEmbeddedNul {
+    NSString *string = [NSString stringWithFormat:@"a%Cb", (unichar)0];
+    XCTAssertEqualObjects(TDOAuthPercentEncodeString(string), @"a%00b");
+    XCTAssertEqualObjects(TDOAuthPercentEncodeString(@""), @"");
+}
+
+#pragma mark - Benchmarks
+
+// A long search term or subject, the worst case TDPCEN sees
+static NSArray *TDOAuthBenchmarkStrings(void) {
+    NSMutableArray *strings = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 200; i++) {
+        [strings addObject:[NSString stringWithFormat:@"Re: Fwd: quarterly planning %lu - agenda, notes & follow-ups for the team offsite (draft %lu)",
+                            (unsigned long)i, (unsigned long)i * 31]];
+        [strings addObject:TDOAuthRandomString(2048)];
+    }
+    return strings;
+}
+
+- (void)testLegacyEncoderPerformance {
+    NSArray *strings = TDOAuthBenchmarkStrings();
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 20; i++) {
+            for (NSString *string in strings) {
+                TDOAuthLegacyPercentEncode(string);
+            }
+        }
+    }];
+}
+
+- (void)testEncoderPerformance {
+    NSArray *strings = TDOAuthBenchmarkStrings();
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 20; i++) {
+            for (NSString *string in strings) {
+                TDOAuthPercentEncodeString(string);
+            }
+        }
+    }];
+}
+
+@end
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOAdaptivePager.h
\ No newline at end of file
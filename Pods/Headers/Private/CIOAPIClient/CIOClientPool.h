@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOClientPool.h
\ No newline at end of file
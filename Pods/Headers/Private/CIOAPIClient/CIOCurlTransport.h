@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOCurlTransport.h
\ No newline at end of file
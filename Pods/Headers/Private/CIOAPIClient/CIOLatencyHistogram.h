@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOLatencyHistogram.h
\ No newline at end of file
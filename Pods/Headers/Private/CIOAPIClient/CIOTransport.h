@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOTransport.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOWebhookReceiver.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/Vendor/TDOAuth/TDOAuthCanonicalizer.h
\ No newline at end of file
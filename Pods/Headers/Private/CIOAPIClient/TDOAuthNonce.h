@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/Vendor/TDOAuth/TDOAuthNonce.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/Vendor/TDOAuth/TDOAuthPercentEncoding.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/Vendor/TDOAuth/TDOAuthSigner.h
\ No newline at end of file
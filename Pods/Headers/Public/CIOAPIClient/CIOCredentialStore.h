@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOCredentialStore.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOLiteFolderSync.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIORequestFingerprint.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOSigningPipeline.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../CIOAPIClient/CIOAPIClient/CIOWebhookSender.h
\ No newline at end of file